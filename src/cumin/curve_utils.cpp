@@ -299,6 +299,78 @@ bool elevated_positive(const std::vector<Vec3d> &base,
   return true;
 };
 
+namespace {
+// cubic with Bernstein coefficients b on [lo, hi]. Returns t such that it is
+// certified positive on [lo, t], by de Casteljau subdivision.
+double positive_prefix(const std::array<double, 4> &b, double lo, double hi,
+                       int depth) {
+  if (*std::min_element(b.begin(), b.end()) > 0) return hi;
+  if (b[0] <= 0 || depth == 0) return lo;
+  std::array<double, 4> left, right;
+  auto b01 = (b[0] + b[1]) / 2, b12 = (b[1] + b[2]) / 2,
+       b23 = (b[2] + b[3]) / 2;
+  auto b012 = (b01 + b12) / 2, b123 = (b12 + b23) / 2;
+  auto b0123 = (b012 + b123) / 2;
+  left = {b[0], b01, b012, b0123};
+  right = {b0123, b123, b23, b[3]};
+  auto mid = (lo + hi) / 2;
+  auto t = positive_prefix(left, lo, mid, depth - 1);
+  if (t < mid) return t;
+  return positive_prefix(right, mid, hi, depth - 1);
+}
+}  // namespace
+
+double elevated_positive_alpha(const std::vector<Vec3d> &base,
+                               const std::vector<Vec3d> &top,
+                               const std::vector<Vec3i> &nbF,
+                               const std::vector<RowMatd> &cp0,
+                               const std::vector<RowMatd> &cp1) {
+  auto &helper = prism::curve::magic_matrices();
+  auto &tri15lag_from_tri10bern = helper.elev_lag_from_bern;
+  auto &dxyz = helper.volume_data.vec_dxyz;
+  auto tri4_cod = codecs_gen_id(helper.tri_order + 1, 2);
+  auto tet4_cod = codecs_gen_id(helper.tri_order + 1, 3);
+  auto alpha = 1.;
+  for (int i = 0; i < nbF.size(); i++) {
+    auto mf = nbF[i];
+    RowMatd f_base(3, 3), f_top(3, 3);
+    for (int j = 0; j < 3; j++) {
+      f_base.row(j) = base[mf[j]];
+      f_top.row(j) = top[mf[j]];
+    }
+    auto degenerate = base[mf[0]] == top[mf[0]];
+    // the tetra nodes are affine in the control points.
+    auto tens0 = surface_to_decomposed_tetra(
+        f_base, tri15lag_from_tri10bern * cp0[i], f_top, degenerate,
+        mf[1] > mf[2], tri4_cod, tet4_cod);
+    auto tens1 = surface_to_decomposed_tetra(
+        f_base, tri15lag_from_tri10bern * cp1[i], f_top, degenerate,
+        mf[1] > mf[2], tri4_cod, tet4_cod);
+    for (auto &d : dxyz) {
+      for (auto t = 0; t < tens0.size(); t++) {
+        Eigen::Matrix3d A = d * tens0[t];
+        Eigen::Matrix3d B = d * (tens1[t] - tens0[t]);
+        // det(A + alpha B) = c0 + c1 alpha + c2 alpha^2 + c3 alpha^3, by
+        // multilinearity in the rows.
+        auto mixed = [&A, &B](int mask) {
+          Eigen::Matrix3d M;
+          for (auto r = 0; r < 3; r++)
+            M.row(r) = (mask & (1 << r)) ? B.row(r) : A.row(r);
+          return M.determinant();
+        };
+        auto c0 = mixed(0), c1 = mixed(1) + mixed(2) + mixed(4),
+             c2 = mixed(3) + mixed(5) + mixed(6), c3 = mixed(7);
+        std::array<double, 4> b = {c0, c0 + c1 / 3,
+                                   c0 + 2 * c1 / 3 + c2 / 3,
+                                   c0 + c1 + c2 + c3};
+        alpha = std::min(alpha, positive_prefix(b, 0., 1., 10));
+        if (alpha <= 0) return 0.;
+      }
+    }
+  }
+  return alpha;
+}
+
 RowMatd sample_hit(const std::vector<Vec3d> &base,
                    const std::vector<Vec3d> &top, const std::vector<Vec3i> &F,
                    const std::vector<int> &sp_fid,
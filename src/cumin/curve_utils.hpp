@@ -146,6 +146,15 @@ bool elevated_positive(
     const std::vector<Vec3i> &F,
     bool recurse_check, const std::vector<RowMatd> &local_cp);
 
+// largest alpha in [0,1] (up to 2^-10) such that the sampled Jacobians of
+// (1-alpha)*cp0 + alpha*cp1 are certified positive, bounded from the
+// Bernstein coefficients of the cubic determinants. 0 if cp0 is not positive.
+double elevated_positive_alpha(const std::vector<Vec3d> &base,
+                               const std::vector<Vec3d> &top,
+                               const std::vector<Vec3i> &F,
+                               const std::vector<RowMatd> &cp0,
+                               const std::vector<RowMatd> &cp1);
+
 constexpr auto load_cp = [](std::string filename) {
   std::vector<RowMatd> complete_cp;
   H5Easy::File file(filename, H5Easy::File::ReadOnly);
@@ -15,6 +15,7 @@
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
+#include <Eigen/Geometry>
 #include <any>
 #include <cumin/bernstein_eval.hpp>
 #include <highfive/H5Easy.hpp>
@@ -31,49 +32,61 @@
 #include <prism/polyshell_utils.hpp>
 
 
+// derivatives of all the faces at all the samples, with one product per
+// direction. The control points are stacked as [X | Y | Z] (n x 3F), so each
+// coordinate of the result is a (samples x F) block, and the per sample
+// formulas below run on whole arrays. Sample i of face c is at i + r * c.
+struct SampleDerivatives {
+  SampleDerivatives(const std::vector<RowMatd> &local_cp,
+                    const std::array<RowMatd, 2> &duv_lv5) {
+    auto fnum = local_cp.size();
+    auto n = duv_lv5[0].cols();
+    Eigen::MatrixXd stacked(n, 3 * fnum);
+    for (int c = 0; c < fnum; c++)
+      for (int d = 0; d < 3; d++) stacked.col(d * fnum + c) = local_cp[c].col(d);
+    Eigen::MatrixXd du_all = duv_lv5[0] * stacked, dv_all = duv_lv5[1] * stacked;
+    for (int d = 0; d < 3; d++) {
+      du[d] = du_all.middleCols(d * fnum, fnum).array();
+      dv[d] = dv_all.middleCols(d * fnum, fnum).array();
+    }
+  }
+  std::array<Eigen::ArrayXXd, 3> du, dv;
+};
+
 auto compute_normals(const std::vector<RowMatd> &local_cp,
                      const std::array<RowMatd, 2> &duv_lv5) -> RowMatd {
   assert(duv_lv5[0].cols() == local_cp[0].rows());
-  RowMatd cross = RowMatd::Zero(duv_lv5[0].rows() * local_cp.size(), 3);
-  // spdlog::info("normal compute size: {} {}", cross.rows(), cross.cols());
-  using MatdX3 = Eigen::Matrix<double, -1, 3, Eigen::RowMajor>;
-  int fnum = local_cp.size();
-  auto r = duv_lv5[0].rows();
-  for (int c = 0; c < local_cp.size(); c++) { // cp  10 x 3d, du 45sample x 10
-    auto &cp = local_cp[c];
-    MatdX3 du = duv_lv5[0] * cp;
-    MatdX3 dv = duv_lv5[1] * cp;
-    for (int i = 0; i < r; i++) { // repeat 45
-      cross.row(r * c + i) = du.row(i).cross(dv.row(i));
-      cross.row(r * c + i) /= cross.row(r * c + i).norm();
-    }
-  }
-  return std::move(cross);
+  SampleDerivatives s(local_cp, duv_lv5);
+  auto &du = s.du, &dv = s.dv;
+  std::array<Eigen::ArrayXXd, 3> cross{du[1] * dv[2] - du[2] * dv[1],
+                                       du[2] * dv[0] - du[0] * dv[2],
+                                       du[0] * dv[1] - du[1] * dv[0]};
+  Eigen::ArrayXXd len =
+      (cross[0].square() + cross[1].square() + cross[2].square()).sqrt();
+  RowMatd normals(len.size(), 3);
+  for (int d = 0; d < 3; d++)
+    normals.col(d) = Eigen::Map<const Eigen::VectorXd>(
+        Eigen::ArrayXXd(cross[d] / len).data(), len.size());
+  return normals;
 };
 
 void compute_amips(const std::vector<RowMatd> &local_cp,
                    const std::array<RowMatd, 2> &duv_lv5, RowMatd &amips) {
   assert(duv_lv5[0].cols() == local_cp[0].rows());
-  amips.setZero(local_cp.size(), duv_lv5[0].rows());
-  auto &du = duv_lv5[0], &dv = duv_lv5[1];
-  int fnum = local_cp.size();
-  auto r = duv_lv5[0].rows();
-  using MatdX3 = Eigen::Matrix<double, -1, 3, Eigen::RowMajor>;
-  for (int c = 0; c < local_cp.size(); c++) {
-    auto &cp = local_cp[c];
-    MatdX3 du = duv_lv5[0] * cp;
-    MatdX3 dv = duv_lv5[1] * cp;
-    for (int i = 0; i < r; i++) { // repeat 45
-      auto e1 = du.row(i);
-      auto e2 = dv.row(i);
-      auto e1_len = e1.norm();
-      auto e2_x = e1.dot(e2) / e1_len;
-      auto e2_y = (e2 - e2_x * e1 / e1_len).norm();
-      amips(c, i) = (std::pow(e1_len, 2) + std::pow(e2_x - e2_y / sqrt(3), 2) +
-                     std::pow(e2_y, 2) * (4 / 3.)) /
-                    (e1_len * 2 * e2_y / std::sqrt(3));
-    }
-  }
+  SampleDerivatives s(local_cp, duv_lv5);
+  auto &du = s.du, &dv = s.dv;
+  Eigen::ArrayXXd e1_len =
+      (du[0].square() + du[1].square() + du[2].square()).sqrt();
+  Eigen::ArrayXXd e2_x = (du[0] * dv[0] + du[1] * dv[1] + du[2] * dv[2]) / e1_len;
+  Eigen::ArrayXXd e2_y = Eigen::ArrayXXd::Zero(e1_len.rows(), e1_len.cols());
+  for (int d = 0; d < 3; d++)
+    e2_y += (dv[d] - e2_x * du[d] / e1_len).square();
+  e2_y = e2_y.sqrt();
+  amips = ((e1_len.square() + (e2_x - e2_y / sqrt(3)).square() +
+            e2_y.square() * (4 / 3.)) /
+           (e1_len * 2 * e2_y / std::sqrt(3)))
+              .matrix()
+              .transpose();
 };
 
 auto inverse_uv_transformer(Vec3d &uv, int poly_id, int oppo,
@@ -232,7 +245,7 @@ constexpr auto valid_curving =
        const auto& option, std::vector<RowMatd> &local_cp) -> bool {
   auto &base = pc.base, &top = pc.top, &mid = pc.mid;
   auto &F = pc.F;
-  prism::geogram::AABB &reftree = *pc.ref.aabb;
+  const prism::geogram::AABB &reftree = *pc.ref.aabb;
 
   auto &[inpV, inpF, refVN, refHN, refVF] = refData;
   const auto &[tri3_cod, tri4_cod, tet4_cod] = mat_helpers;
@@ -300,9 +313,7 @@ constexpr auto valid_curving =
       return false;
     }
     spdlog::debug("Fit: Pass out residual");
-    double alpha = 1.0;
-    for (int trial = 0; trial < 20; trial++, alpha *= 0.8) {  // line search
-      spdlog::trace("shrinking with alpha {}", alpha);
+    auto blend = [&](double alpha) {
       for (int i = 0; i < nbF.size(); i++) {
         for (int j = 0; j < targ_cp[i].rows(); j++) {
           if (targ_cp[i].row(j) == linear_cp[i].row(j)) continue;
@@ -310,32 +321,49 @@ constexpr auto valid_curving =
               targ_cp[i].row(j) * alpha + linear_cp[i].row(j) * (1 - alpha);
         }
       }
-      if (!residual_test(targ_cp)) return false;
-      if (prism::curve::elevated_positive(
-              base, top, nbF,
-              option.curve_recurse_check, local_cp)) {
-        spdlog::debug("Fit: Passed");
-        if (option.curve_normal_bound > -1.) {
-          RowMatd est_normals = compute_normals(local_cp, tri3_duv_lv5);
-          assert(tri3_duv_lv5[0].cols() == tri3_cod.rows());
-          int num_samples = tri3_duv_lv5[0].rows();
-          assert(allnode_map.cols() == num_samples);
-          for (int i = 0; i < allnode_map.rows(); i++) {
-            for (int j = 0; j < allnode_map.cols(); j++) {
-              if (est_normals.row(i * num_samples + j)
-                      .dot(ray_hit_n.row(allnode_map(i, j))) <
-                  option.curve_normal_bound) {
-                spdlog::debug("normal rejection: {}",
-                              est_normals.row(i * num_samples + j)
-                                  .dot(ray_hit_n.row(allnode_map(i, j))));
-                return false;
-              }
-            }
+      return prism::curve::elevated_positive(
+          base, top, nbF, option.curve_recurse_check, local_cp);
+    };
+    // the sampled Jacobians are cubic in alpha, so the largest valid alpha is
+    // bounded directly. Bisect below it only if the full check disagrees.
+    double alpha = prism::curve::elevated_positive_alpha(base, top, nbF,
+                                                         linear_cp, targ_cp);
+    spdlog::trace("alpha bound {}", alpha);
+    if (alpha <= 0) return false;
+    if (!blend(alpha)) {
+      auto lo = 0., hi = alpha;
+      for (int trial = 0; trial < 6; trial++) {
+        auto mid = (lo + hi) / 2;
+        if (blend(mid))
+          lo = mid;
+        else
+          hi = mid;
+      }
+      if (lo == 0.) return false;
+      alpha = lo;
+      blend(alpha);
+    }
+    spdlog::debug("Fit: Passed with alpha {}", alpha);
+    if (!residual_test(local_cp)) return false;
+    if (option.curve_normal_bound > -1.) {
+      RowMatd est_normals = compute_normals(local_cp, tri3_duv_lv5);
+      assert(tri3_duv_lv5[0].cols() == tri3_cod.rows());
+      int num_samples = tri3_duv_lv5[0].rows();
+      assert(allnode_map.cols() == num_samples);
+      for (int i = 0; i < allnode_map.rows(); i++) {
+        for (int j = 0; j < allnode_map.cols(); j++) {
+          if (est_normals.row(i * num_samples + j)
+                  .dot(ray_hit_n.row(allnode_map(i, j))) <
+              option.curve_normal_bound) {
+            spdlog::debug("normal rejection: {}",
+                          est_normals.row(i * num_samples + j)
+                              .dot(ray_hit_n.row(allnode_map(i, j))));
+            return false;
           }
         }
-        return true;
       }
     }
+    return true;
   } else { // stay linear.
     local_cp = prism::curve::initialize_cp(mid, nbF, tri3_cod);
     if (!residual_test(local_cp)) {
@@ -455,54 +483,85 @@ prism::curve::curve_func_handles(std::vector<RowMatd> &complete_cp,
           }
         }
 
-      auto cnt = 0;
-      for (auto ppi = 0; ppi < poisson_points_ref.size(); ppi++) {
-        auto pp = poisson_points_ref[ppi];
-        bool point_checked = false;
-        // iterate over all new shells.
+      // the shell of each moved triangle (zig construction if needed) is
+      // built once, with a bounding box: each point scans the boxes of all
+      // the moved shells and only projects into the ones containing it.
+      struct MovedShell {
+        int oppo_vid = -1;
+        std::vector<Vec3d> base, mid, top;
+        std::vector<Vec3i> zig_tris;
+        std::vector<int> zig_shifts;
+        std::vector<double> lens;
+        Eigen::AlignedBox3d box;
+      };
+      std::vector<MovedShell> shells(moved_tris.size());
+      for (auto si = 0; si < moved_tris.size(); si++) {
+        auto &f = moved_tris[si];
+        auto &sh = shells[si];
+        auto rej_id = -1;
+        auto segs = std::vector<int>();
+        if (enable_polyshell)
+          std::tie(sh.oppo_vid, rej_id, segs) =
+              prism::local_validity::identify_zig(pc.meta_edges, f);
+        assert(sh.oppo_vid != -10 &&
+               "this should always go after distort check.");
+        if (sh.oppo_vid >= 0) {
+          // zig shell case;
+          auto oppo_vid = sh.oppo_vid;
+          auto [v0, v1, v2] = std::tie(f[oppo_vid], f[(oppo_vid + 1) % 3],
+                                       f[(oppo_vid + 2) % 3]);
+          std::tie(sh.base, sh.mid, sh.top, sh.zig_tris, sh.zig_shifts) =
+              prism::local_validity::zig_constructor(pc, v0, v1, v2, segs,
+                                                     true);
+          sh.lens.resize(sh.zig_tris.size() + 1, 0.);
+          for (auto i = 0; i < sh.zig_tris.size(); i++) {
+            auto s = sh.zig_shifts[i];
+            auto l0 = sh.zig_tris[i][(4 - s) % 3],
+                 l1 = sh.zig_tris[i][(5 - s) % 3];
+            sh.lens[i + 1] = sh.lens[i] + (sh.mid[l1] - sh.mid[l0]).norm();
+          }
+          for (auto &l : sh.lens) l /= sh.lens.back();
+          for (auto &z : sh.zig_tris)
+            for (auto v : z)
+              for (auto layer : {&sh.base, &sh.mid, &sh.top})
+                sh.box.extend((*layer)[v].transpose());
+        } else {
+          for (auto v : f)
+            for (auto layer : {&pc.base, &pc.mid, &pc.top})
+              sh.box.extend((*layer)[v].transpose());
+        }
+        // projection has its own tolerance.
+        auto margin = 1e-3 * sh.box.diagonal().norm();
+        sh.box.min().array() -= margin;
+        sh.box.max().array() += margin;
+      }
+
+      // serial: the attempts calling this already run in parallel (smoothing
+      // and slide passes), and the point count per attempt is small.
+      auto far_away = false;
+      for (auto ppi = 0; ppi < poisson_points_ref.size() && !far_away; ppi++) {
+        auto &pp = poisson_points_ref[ppi];
+        // iterate over all new shells, the first containing one decides.
         for (auto si = 0; si < moved_tris.size(); si++) {
           auto &f = moved_tris[si];
+          auto &sh = shells[si];
+          if (!sh.box.contains(pp.transpose())) continue;
           auto tup = std::array<double, 3>{-1, -1, -1};
-
-          auto oppo_vid = -1, rej_id = -1;
-          auto segs = std::vector<int>();
-          if (enable_polyshell)
-            std::tie(oppo_vid, rej_id, segs) =
-                prism::local_validity::identify_zig(pc.meta_edges, f);
-          assert(oppo_vid != -10 &&
-                 "this should always go after distort check.");
-          if (oppo_vid >= 0) {
-            // zig shell case;
-            // the follow can be precomputed if needed.
-            auto [v0, v1, v2] = std::tie(f[oppo_vid], f[(oppo_vid + 1) % 3],
-                                         f[(oppo_vid + 2) % 3]);
-            auto [local_base, local_mid, local_top, zig_tris, zig_shifts] =
-                prism::local_validity::zig_constructor(pc, v0, v1, v2, segs,
-                                                       true);
-            auto lens = std::vector<double>(zig_tris.size() + 1, 0.);
-            for (auto i = 0; i < zig_tris.size(); i++) {
-              auto s = zig_shifts[i];
-              auto l0 = zig_tris[i][(4 - s) % 3], l1 = zig_tris[i][(5 - s) % 3];
-              lens[i + 1] = lens[i] + (local_mid[l1] - local_mid[l0]).norm();
-            }
-            for (auto &l : lens)
-              l /= lens.back();
-            // spdlog::info("zigtris {}", zig_tris);
-            for (auto pid = 0; pid < zig_tris.size(); pid++) {
-              auto &z = zig_tris[pid];
-              auto o_tup = inverse_project_discrete(local_base, local_mid,
-                                                    local_top, z, pp);
+          if (sh.oppo_vid >= 0) {
+            for (auto pid = 0; pid < sh.zig_tris.size(); pid++) {
+              auto &z = sh.zig_tris[pid];
+              auto o_tup =
+                  inverse_project_discrete(sh.base, sh.mid, sh.top, z, pp);
               if (o_tup) {
                 tup = o_tup.value();
                 auto uv = Vec3d(1 - tup[0] - tup[1], tup[0], tup[1]);
                 for (auto j = 0; j < 3; j++) {
                   uv[j] = std::max(std::min(uv[j], 1.), 0.);
                 }
-                auto s = (3 - zig_shifts[pid]) % 3;
+                auto s = (3 - sh.zig_shifts[pid]) % 3;
                 uv = Vec3d(uv[s], uv[(s + 1) % 3], uv[(s + 2) % 3]);
 
-                auto uv2 = uv;
-                inverse_uv_transformer(uv, pid, oppo_vid, lens);
+                inverse_uv_transformer(uv, pid, sh.oppo_vid, sh.lens);
 
                 tup[0] = uv[1];
                 tup[1] = uv[2];
@@ -512,31 +571,27 @@ prism::curve::curve_func_handles(std::vector<RowMatd> &complete_cp,
           } else {
             auto o_tup =
                 inverse_project_discrete(pc.base, pc.mid, pc.top, f, pp);
-            if (o_tup)
-              tup = o_tup.value();
+            if (o_tup) tup = o_tup.value();
           }
-          if (tup[0] == -1)
-            continue; // go to next point
-          point_checked = true;
+          if (tup[0] == -1) continue;  // go to next shell
           auto [u, v, _] = tup;
           auto bas_val = prism::curve::evaluate_bernstein(
-              Eigen::VectorXd::Constant(1, u), Eigen::VectorXd::Constant(1, v),
+              Eigen::VectorXd::Constant(1, u),
+              Eigen::VectorXd::Constant(1, v),
               Eigen::VectorXd::Constant(1, 0),
-              tri_codec_v); // tri10 x 1 array
-          // cp[si]; // 10x3
+              tri_codec_v);  // tri10 x 1 array
           Vec3d curved_pos =
               (bas_val.matrix().asDiagonal() * cp[si]).colwise().sum();
           if ((curved_pos - poisson_points_targ[ppi]).squaredNorm() >
               dist_th * dist_th) {
             spdlog::trace("pp faraway {} {}", ppi, curved_pos);
-            return false;
+            far_away = true;
           }
-          break; // pass the check for the current pp.
+          break;  // the current pp is decided.
         }
-        if (!point_checked)
-          ; // ok, the point may not be covered here.
+        // ok, the point may not be covered here.
       }
-      return true;
+      return !far_away;
     };
     bool flag = valid_curving(
         pc, old_nb, moved_tris,
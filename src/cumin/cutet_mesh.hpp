@@ -0,0 +1,269 @@
+#ifndef CUMIN_CUTET_MESH_HPP
+#define CUMIN_CUTET_MESH_HPP
+
+#include <prism/common.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace prism::curve {
+
+// Inline storage for N entries, spills to the heap only beyond.
+template <typename T, int N>
+class SmallVector {
+ public:
+  void push_back(const T &v) {
+    if (size_ < N)
+      inline_[size_] = v;
+    else {
+      if (size_ == N) heap_.assign(inline_.begin(), inline_.end());
+      heap_.push_back(v);
+    }
+    size_++;
+  }
+  void clear() {
+    size_ = 0;
+    heap_.clear();
+  }
+  T *begin() { return size_ <= N ? inline_.data() : heap_.data(); }
+  T *end() { return begin() + size_; }
+  const T *begin() const { return size_ <= N ? inline_.data() : heap_.data(); }
+  const T *end() const { return begin() + size_; }
+  T &operator[](int i) { return begin()[i]; }
+  const T &operator[](int i) const { return begin()[i]; }
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  std::array<T, N> inline_;
+  std::vector<T> heap_;
+  int size_ = 0;
+};
+
+// Vertex to tet adjacency in a single array (CSR like). Each vertex owns a
+// range with slack, and is moved to the end of the array when outgrowing it.
+// Entries keep their insertion order.
+class VertexTetAdjacency {
+ public:
+  struct Range {
+    const int *b, *e;
+    const int *begin() const { return b; }
+    const int *end() const { return e; }
+    int size() const { return int(e - b); }
+    int operator[](int i) const { return b[i]; }
+  };
+
+  template <typename Tets>
+  void build(int num_verts, const Tets &tets, int slack = 4) {
+    offset_.assign(num_verts + 1, 0);
+    count_.assign(num_verts, 0);
+    for (auto &t : tets)
+      for (auto j = 0; j < 4; j++) count_[t[j]]++;
+    for (auto v = 0; v < num_verts; v++)
+      offset_[v + 1] = offset_[v] + count_[v] + slack;
+    capacity_.resize(num_verts);
+    for (auto v = 0; v < num_verts; v++)
+      capacity_[v] = offset_[v + 1] - offset_[v];
+    offset_.pop_back();
+    data_.assign(offset_.empty() ? 0 : offset_.back() + capacity_.back(), -1);
+    std::fill(count_.begin(), count_.end(), 0);
+    for (auto i = 0; i < tets.size(); i++)
+      for (auto j = 0; j < 4; j++) {
+        auto v = tets[i][j];
+        data_[offset_[v] + count_[v]++] = i;
+      }
+  }
+  Range operator[](int v) const {
+    auto b = data_.data() + offset_[v];
+    return {b, b + count_[v]};
+  }
+  int num_verts() const { return int(count_.size()); }
+  void resize(int num_verts) {
+    offset_.resize(num_verts, int(data_.size()));
+    count_.resize(num_verts, 0);
+    capacity_.resize(num_verts, 0);
+  }
+  void push_back(int v, int t) {
+    reserve(v, count_[v] + 1);
+    data_[offset_[v] + count_[v]++] = t;
+  }
+  void erase(int v, int t) {
+    auto b = data_.begin() + offset_[v], e = b + count_[v];
+    auto it = std::find(b, e, t);
+    assert(it != e);
+    std::copy(it + 1, e, it);
+    count_[v]--;
+  }
+  template <typename It>
+  void assign(int v, It first, It last) {
+    reserve(v, int(std::distance(first, last)));
+    count_[v] = int(std::copy(first, last, data_.begin() + offset_[v]) -
+                    (data_.begin() + offset_[v]));
+  }
+
+ private:
+  void reserve(int v, int n) {
+    if (n <= capacity_[v]) return;
+    auto cap = std::max(2 * capacity_[v], n + 4);
+    auto old = offset_[v];
+    offset_[v] = int(data_.size());
+    data_.resize(data_.size() + cap, -1);
+    std::copy(data_.begin() + old, data_.begin() + old + count_[v],
+              data_.begin() + offset_[v]);
+    capacity_[v] = cap;
+  }
+  std::vector<int> data_, offset_, count_, capacity_;
+};
+
+// High order tetrahedra of a fixed order, nodes inline per tet. The passes
+// convert from (lagr, p4T) once, edit in place with removal flags, and
+// export compacted.
+template <int Order>
+struct CuTetMesh {
+  static constexpr int num_nodes = (Order + 1) * (Order + 2) * (Order + 3) / 6;
+  using Tet = std::array<int, num_nodes>;
+  using Shell = SmallVector<int, 16>;
+
+  std::vector<Vec3d> vertices;  // all nodes, vertices first.
+  std::vector<Tet> tets;
+  std::vector<bool> v_is_removed, t_is_removed;
+  VertexTetAdjacency conn_tets;
+
+  CuTetMesh(const RowMatd &lagr, const RowMati &p4T) {
+    if (p4T.cols() != num_nodes)
+      throw std::runtime_error("tet order mismatch");
+    vertices.resize(lagr.rows());
+    tets.resize(p4T.rows());
+    for (int i = 0; i < lagr.rows(); i++) vertices[i] = lagr.row(i);
+    for (int i = 0; i < p4T.rows(); i++)
+      for (int j = 0; j < num_nodes; j++) tets[i][j] = p4T(i, j);
+    v_is_removed.resize(vertices.size(), false);
+    t_is_removed.resize(tets.size(), false);
+    conn_tets.build(vertices.size(), tets);
+  }
+
+  void export_to(RowMatd &lagr, RowMati &p4T) const {
+    RowMatd lagr_new(
+        std::count(v_is_removed.begin(), v_is_removed.end(), false), 3);
+    RowMati p4T_new(
+        std::count(t_is_removed.begin(), t_is_removed.end(), false),
+        num_nodes);
+    std::vector<int> map_v_ids(vertices.size(), -1);
+    int cnt = 0;
+    for (int i = 0; i < vertices.size(); i++) {
+      if (v_is_removed[i]) continue;
+      lagr_new.row(cnt) = vertices[i];
+      map_v_ids[i] = cnt;
+      cnt++;
+    }
+    int cnt_t = 0;
+    for (int i = 0; i < tets.size(); i++) {
+      if (t_is_removed[i]) continue;
+      assert(tets[i][0] != -1);
+      for (int j = 0; j < num_nodes; j++)
+        p4T_new(cnt_t, j) = map_v_ids[tets[i][j]];
+      cnt_t++;
+    }
+    lagr = std::move(lagr_new);
+    p4T = std::move(p4T_new);
+  }
+
+  // new nodes may be appended by the local edits.
+  void resize_vertices(int n) {
+    vertices.resize(n);
+    v_is_removed.resize(n, false);
+    conn_tets.resize(n);
+  }
+
+  Eigen::Vector4i linear(int t) const {
+    return Eigen::Vector4i(tets[t][0], tets[t][1], tets[t][2], tets[t][3]);
+  }
+
+  bool contains(int t, int v) const {
+    for (auto j = 0; j < 4; j++)
+      if (tets[t][j] == v) return true;
+    return false;
+  }
+
+  // tets around an edge, in increasing order.
+  void edge_shell(int v0, int v1, Shell &shell) const {
+    shell.clear();
+    for (auto t : conn_tets[v0])
+      if (contains(t, v1)) shell.push_back(t);
+    std::sort(shell.begin(), shell.end());
+  }
+
+  // sorted unique edges of the linear tets.
+  std::vector<std::array<int, 2>> edges() const {
+    std::vector<std::array<int, 2>> edges;
+    edges.reserve(tets.size() * 6);
+    for (int i = 0; i < tets.size(); i++) {
+      if (t_is_removed[i]) continue;
+      const auto &t = tets[i];
+      for (int j = 0; j < 3; j++) {
+        std::array<int, 2> e = {{t[0], t[j + 1]}};
+        if (e[0] > e[1]) std::swap(e[0], e[1]);
+        edges.push_back(e);
+        e = {{t[j + 1], t[(j + 1) % 3 + 1]}};
+        if (e[0] > e[1]) std::swap(e[0], e[1]);
+        edges.push_back(e);
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    return edges;
+  }
+};
+
+// Map from node id to V, with O(1) access through a slot array over all the
+// nodes. Reused across attempts, clear() only resets the touched slots.
+template <typename V>
+class NodeMap {
+ public:
+  V *find(int n) {
+    return (n < slot_.size() && slot_[n] >= 0) ? &entries_[slot_[n]].second
+                                               : nullptr;
+  }
+  V &operator[](int n) {
+    if (n >= slot_.size()) slot_.resize(n + 1, -1);
+    if (slot_[n] < 0) {
+      slot_[n] = int(entries_.size());
+      entries_.emplace_back(n, V());
+    }
+    return entries_[slot_[n]].second;
+  }
+  void clear() {
+    for (auto &e : entries_) slot_[e.first] = -1;
+    entries_.clear();
+  }
+  auto begin() { return entries_.begin(); }
+  auto end() { return entries_.end(); }
+
+ private:
+  std::vector<int> slot_;
+  std::vector<std::pair<int, V>> entries_;
+};
+
+// calls func(std::integral_constant<int, Order>) for the order of the p4T
+// columns.
+template <typename Func>
+auto dispatch_tet_order(int n_node, Func &&func) {
+  switch (n_node) {
+    case 10:
+      return func(std::integral_constant<int, 2>());
+    case 20:
+      return func(std::integral_constant<int, 3>());
+    case 35:
+      return func(std::integral_constant<int, 4>());
+    case 56:
+      return func(std::integral_constant<int, 5>());
+  }
+  throw std::runtime_error("tet order mismatch");
+}
+}  // namespace prism::curve
+
+#endif
@@ -1,17 +1,21 @@
 #include "high_order_optimization.hpp"
 
 #include <igl/boundary_facets.h>
+#include <igl/parallel_for.h>
 #include <igl/tet_tet_adjacency.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
 #include <highfive/H5Easy.hpp>
 #include <prism/common.hpp>
-#include <queue>
+#include <prism/local_operations/mesh_coloring.hpp>
+#include <numeric>
 #include <optional>
+#include <queue>
 
 #include "curve_common.hpp"
 #include "curve_utils.hpp"
+#include "cutet_mesh.hpp"
 #include "inversion_check.hpp"
 
 auto verts_inside_volume = [](auto &p4T) {
@@ -167,80 +171,251 @@ bool InversionCheck(const RowMatd &lagr, const RowMati &p4T,
                     const RowMati &codec_fixed, const RowMati &codec9_fixed,
                     const RowMatd &bern_from_lagr_o4,
                     const RowMatd &bern_from_lagr_o9) {
-  auto n_node = bern_from_lagr_o4.rows();
-  RowMatX3d nodes35(n_node, 3);
-  for (int i = 0; i < p4T.rows(); i++) {
-    for (int j = 0; j < n_node; j++) {
-      nodes35.row(j) = lagr.row(p4T(i, j));
-    }
-    if (!prism::curve::tetrahedron_inversion_check(
-            nodes35, codec_fixed, codec9_fixed, bern_from_lagr_o4,
-            bern_from_lagr_o9)) {
-      spdlog::critical("Tet id = {} | p4T rows = {}", i, p4T.rows());
-      return false;
-    }
+  auto flags = prism::curve::tetrahedra_inversion_check(
+      lagr, p4T, codec_fixed, codec9_fixed, bern_from_lagr_o4,
+      bern_from_lagr_o9);
+  auto it = std::find(flags.begin(), flags.end(), false);
+  if (it != flags.end()) {
+    spdlog::critical("Tet id = {} | p4T rows = {}", it - flags.begin(),
+                     p4T.rows());
+    return false;
   }
   return true;
 }
 
 Eigen::VectorXd energy_evaluation(RowMatd &lagr, RowMati &p4T,
                                   const std::vector<RowMatd> &vec_dxyz) {
-  auto elem_size = p4T.cols();
-  auto total_val = 0.;
+  // as `tetrahedra_inversion_check`, the nodes of a panel of tets are gathered
+  // so that the Jacobians at all the samples are one GEMM with the stacked
+  // derivatives. Same value as `mips_energy`, up to the summation order.
+  constexpr int block = 64;
+  auto num_nodes = p4T.cols();
+  int num_samples = vec_dxyz.size();
+  Eigen::MatrixXd deriv(3 * num_samples, num_nodes);
+  for (auto s = 0; s < num_samples; s++)
+    deriv.middleRows(3 * s, 3) = vec_dxyz[s];
   Eigen::VectorXd energies(p4T.rows());
-  energies.setZero();
-  for (auto i = 0; i < p4T.rows(); i++) {
-    auto t = i;
-    RowMatX3d nodes35(elem_size, 3);
-    for (auto j = 0; j < elem_size; j++) {
-      nodes35.row(j) = lagr.row(p4T(t, j));
-    }
-    auto [val, grad] = mips_energy(nodes35, vec_dxyz, false);
-    energies[i] = val;  /// vec_dxyz.size();
-  }
+  auto num_panels = (p4T.rows() + block - 1) / block;
+  igl::parallel_for(
+      num_panels,
+      [&](int b) {
+        auto begin = b * block;
+        auto size = std::min<int>(block, p4T.rows() - begin);
+        Eigen::MatrixXd panel(num_nodes, 3 * size);
+        for (auto t = 0; t < size; t++)
+          for (auto j = 0; j < num_nodes; j++)
+            panel.block<1, 3>(j, 3 * t) = lagr.row(p4T(begin + t, j));
+        Eigen::MatrixXd jacs = deriv * panel;
+        for (auto t = 0; t < size; t++) {
+          auto mips = 0.;
+          auto s = 0;
+          for (; s < num_samples; s++) {
+            Eigen::Matrix3d jac = jacs.block<3, 3>(3 * s, 3 * t);
+            if (jac.determinant() <= 0) break;
+            mips += jac.squaredNorm() * jac.inverse().squaredNorm();
+          }
+          energies[begin + t] = s < num_samples ? 1e100 : mips / num_samples;
+        }
+      },
+      size_t(1));
   return energies;
 }
 
-void one_ring_vertex_coloring(const int n_v, const std::set<int> &inside_verts,
-                              const std::vector<std::vector<int>> &VT,
-                              const RowMati &p4T, std::vector<int> &colors) {
-  colors.resize(n_v);
-  std::fill(colors.begin(), colors.end(), -1);
-  std::vector<bool> available(n_v, true);
+void EnergyCache::reset(const RowMatd &lagr, const RowMati &p4T) {
+  auto &vec_dxyz = prism::curve::magic_matrices().volume_data.vec_dxyz;
+  auto elem_size = p4T.cols();
+  energy_.resize(p4T.rows());
+  igl::parallel_for(
+      p4T.rows(),
+      [&](int i) {
+        RowMatX3d nodes(elem_size, 3);
+        for (auto j = 0; j < elem_size; j++) nodes.row(j) = lagr.row(p4T(i, j));
+        energy_[i] = std::get<0>(mips_energy(nodes, vec_dxyz, false));
+      },
+      1000);
+  sum_ = std::accumulate(energy_.begin(), energy_.end(), 0.);
+  count_ = energy_.size();
+  rescan();
+}
 
-  std::vector<int> ring;
-  std::set<int>::const_iterator it = inside_verts.begin();
-  colors[*it] = 0;
-  ++it;
+void EnergyCache::set(int t, double e) {
+  if (t >= energy_.size())
+    energy_.resize(t + 1, std::numeric_limits<double>::quiet_NaN());
+  remove(t);
+  energy_[t] = e;
+  sum_ += e;
+  count_++;
+  if (count_ == 1) min_ = max_ = e;
+  min_ = std::min(min_, e);
+  max_ = std::max(max_, e);
+}
 
-  for (; it != inside_verts.end(); ++it) {
-    const int v = *it;
+void EnergyCache::remove(int t) {
+  auto old = energy_[t];
+  if (std::isnan(old)) return;
+  energy_[t] = std::numeric_limits<double>::quiet_NaN();
+  sum_ -= old;
+  count_--;
+  if (old <= min_ || old >= max_) stale_ = true;  // rescan when asked.
+}
 
-    ring.clear();
-    for (const auto &t : VT[v]) {
-      for (int j = 0; j < 4; ++j) ring.push_back(p4T(t, j));
-    }
-    std::sort(ring.begin(), ring.end());
-    ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+void EnergyCache::compact(const std::vector<bool> &t_is_removed) {
+  energy_.resize(t_is_removed.size(),
+                 std::numeric_limits<double>::quiet_NaN());
+  auto cnt = 0;
+  for (auto i = 0; i < energy_.size(); i++) {
+    if (t_is_removed[i]) continue;
+    assert(!std::isnan(energy_[i]));
+    energy_[cnt++] = energy_[i];
+  }
+  energy_.resize(cnt);
+  assert(cnt == count_);
+}
 
-    for (const auto n : ring) {
-      if (colors[n] != -1) available[colors[n]] = false;
-    }
+void EnergyCache::rescan() const {
+  min_ = std::numeric_limits<double>::infinity();
+  max_ = -min_;
+  for (auto e : energy_) {
+    if (std::isnan(e)) continue;
+    min_ = std::min(min_, e);
+    max_ = std::max(max_, e);
+  }
+  stale_ = false;
+}
 
-    int first_available_col;
-    for (first_available_col = 0; first_available_col < available.size();
-         first_available_col++) {
-      if (available[first_available_col]) break;
-    }
+double EnergyCache::minCoeff() const {
+  if (stale_) rescan();
+  return min_;
+}
 
-    assert(available[first_available_col]);
+double EnergyCache::maxCoeff() const {
+  if (stale_) rescan();
+  return max_;
+}
 
-    colors[v] = first_available_col;
+Eigen::VectorXd EnergyCache::values() const {
+  Eigen::VectorXd v(count_);
+  auto cnt = 0;
+  for (auto e : energy_)
+    if (!std::isnan(e)) v[cnt++] = e;
+  return v;
+}
 
-    for (const auto n : ring) {
-      if (colors[n] != -1) available[colors[n]] = true;
-    }
-  }
+double EnergyCache::verify(const RowMatd &lagr, const RowMati &p4T) const {
+  EnergyCache full(lagr, p4T);
+  if (full.energy_.size() != count_)
+    return std::numeric_limits<double>::infinity();
+  auto cached = values();
+  auto diff = 0.;
+  for (auto i = 0; i < cached.size(); i++)
+    diff = std::max(diff, std::abs(cached[i] - full.energy_[i]) /
+                              std::max(1., std::abs(full.energy_[i])));
+  return diff;
+}
+
+QualityStatistics quality_statistics(const RowMatd &lagr, const RowMati &p4T,
+                                     int num_bins, int num_worst) {
+  auto &helper = prism::curve::magic_matrices();
+  auto &vec_dxyz = helper.volume_data.vec_dxyz;
+  auto &vd = helper.volume_data;
+  auto elem_size = p4T.cols();
+  assert(elem_size == vd.vol_bern_from_lagr.rows());
+  QualityStatistics stats;
+  stats.mips.setZero(p4T.rows());
+  stats.min_jac.setZero(p4T.rows());
+  stats.jac_ratio.setZero(p4T.rows());
+  stats.certified.resize(p4T.rows(), 0);
+
+  auto tet_nodes = [&lagr, &p4T, elem_size](int t) {
+    RowMatX3d nodes35(elem_size, 3);
+    for (auto j = 0; j < elem_size; j++) nodes35.row(j) = lagr.row(p4T(t, j));
+    return nodes35;
+  };
+  auto certified = prism::curve::tetrahedra_inversion_check(
+      lagr, p4T, vd.vol_codec, vd.vol_jac_codec, vd.vol_bern_from_lagr,
+      vd.vol_jac_bern_from_lagr);
+  igl::parallel_for(
+      p4T.rows(),
+      [&](auto t) {
+        auto nodes35 = tet_nodes(t);
+        auto min_det = std::numeric_limits<double>::infinity();
+        auto max_det = -min_det;
+        for (auto &d : vec_dxyz) {
+          Eigen::Matrix3d jac = d * nodes35;
+          auto det = jac.determinant();
+          min_det = std::min(min_det, det);
+          max_det = std::max(max_det, det);
+        }
+        stats.min_jac[t] = min_det;
+        stats.jac_ratio[t] = max_det > 0 ? min_det / max_det : -1.;
+        stats.mips[t] = std::get<0>(mips_energy(nodes35, vec_dxyz, false));
+        stats.certified[t] = certified[t];
+      },
+      1000);
+
+  auto histogram = [num_bins](const Eigen::VectorXd &val, double lo,
+                              double hi, bool log_scale) {
+    QualityStatistics::Histogram h;
+    h.counts.resize(num_bins, 0);
+    for (auto i = 0; i <= num_bins; i++) {
+      auto x = double(i) / num_bins;
+      h.edges.push_back(log_scale ? lo * std::pow(hi / lo, x)
+                                  : lo + (hi - lo) * x);
+    }
+    for (auto i = 0; i < val.size(); i++) {
+      auto b = std::upper_bound(h.edges.begin() + 1, h.edges.end() - 1,
+                                val[i]) -
+               (h.edges.begin() + 1);
+      h.counts[b]++;
+    }
+    return h;
+  };
+  // MIPS is bounded below by 9, the invalid ones (1e100) go to the last bin.
+  auto max_mips = 9.;
+  for (auto i = 0; i < stats.mips.size(); i++)
+    if (stats.mips[i] < 1e100) max_mips = std::max(max_mips, stats.mips[i]);
+  stats.mips_hist = histogram(stats.mips, 9., std::max(max_mips, 9. + 1e-8),
+                              true);
+  stats.ratio_hist = histogram(stats.jac_ratio, 0., 1., false);
+
+  auto worst = [num_worst](const Eigen::VectorXd &val, bool larger_worse) {
+    std::vector<int> ids(val.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    auto n = std::min<int>(num_worst, ids.size());
+    std::partial_sort(ids.begin(), ids.begin() + n, ids.end(),
+                      [&val, larger_worse](int a, int b) {
+                        return larger_worse ? val[a] > val[b]
+                                            : val[a] < val[b];
+                      });
+    ids.resize(n);
+    return ids;
+  };
+  stats.worst_mips = worst(stats.mips, true);
+  stats.worst_ratio = worst(stats.jac_ratio, false);
+  return stats;
+}
+
+void one_ring_vertex_coloring(const int n_v, const std::set<int> &inside_verts,
+                              const std::vector<std::vector<int>> &VT,
+                              const RowMati &p4T, std::vector<int> &colors) {
+  std::vector<bool> inside(n_v, false);
+  for (auto v : inside_verts) inside[v] = true;
+  std::vector<std::vector<int>> adj(n_v);
+  std::vector<int> ids(inside_verts.begin(), inside_verts.end());
+  igl::parallel_for(
+      ids.size(),
+      [&](auto i) {
+        auto v = ids[i];
+        auto &ring = adj[v];
+        for (const auto &t : VT[v]) {
+          for (int j = 0; j < 4; ++j)
+            if (p4T(t, j) != v && inside[p4T(t, j)]) ring.push_back(p4T(t, j));
+        }
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+      },
+      size_t(1000));
+  prism::local::graph_coloring(adj, inside, colors);
 }
 
 void one_ring_vertex_sets(const int n_v, const std::set<int> &inside_verts,
@@ -299,6 +474,12 @@ struct cmp_l {
 // lagr is unique here per nodes. not the duplicated version.
 void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
                         int threadNum) {
+  EnergyCache energy(lagr, p4T);
+  vertex_star_smooth(lagr, p4T, total_iteration, threadNum, energy);
+}
+
+void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
+                        int threadNum, EnergyCache &energy) {
   auto &helper = prism::curve::magic_matrices();
   auto &codec_fixed = helper.volume_data.vol_codec;
   auto &vec_dxyz = helper.volume_data.vec_dxyz;
@@ -336,7 +517,9 @@ void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
     return true;
   };
 
-  auto one_ring_smoother = [&](int v) {
+  // the new energies of the star, applied to the cache after each set.
+  using EnergyUpdate = std::vector<std::pair<int, double>>;
+  auto one_ring_smoother = [&](int v, EnergyUpdate &update) {
     auto &nodes = VN[v];  // free variable nodes around vertex v
     auto &tetras = VT[v];
     // marker
@@ -356,9 +539,12 @@ void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
 
     auto free_num = nodes.size();
 
+    // per tet values of the last evaluation, and of the accepted point.
+    std::vector<double> tet_vals(tetras.size()), accepted_vals;
     auto closure = [free_num = nodes.size(), &tetras, &p4T, &lagr, elem_size,
                     &vec_dxyz, &marker, &codec_fixed, &codec9_fixed,
-                    &bern_from_lagr_o9](const auto &x, auto with_grad) {
+                    &bern_from_lagr_o9,
+                    &tet_vals](const auto &x, auto with_grad) {
       RowMatX3d free_nodes_grad = RowMatX3d::Zero(free_num, 3);
       auto total_val = 0.;
       for (auto i = 0; i < tetras.size(); i++) {
@@ -373,6 +559,7 @@ void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
         }
 
         auto [val, grad] = mips_energy(nodes35, vec_dxyz, with_grad);
+        tet_vals[i] = val;
         total_val += val;
         if (with_grad)
           for (auto j = 0; j < elem_size; j++)
@@ -387,8 +574,9 @@ void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
     int returnCode;
     for (auto i = 0; i < 10; i++) {
       returnCode = gradient_descent(closure, free_vars, 50, newnode);
-      if (returnCode == 1) {  // on success
+      if (returnCode == 1) {  // on success, last evaluated at newnode
         free_vars = newnode;
+        accepted_vals = tet_vals;
       } else {  // either we failed to find a newnode, or the change of energy
                 // is too small
         if (i == 0) {
@@ -410,13 +598,14 @@ void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
     for (auto nid = 0; nid < nodes.size(); nid++) {  // official assign
       lagr.row(nodes[nid]) = newvars.row(nid);
     }
+    for (auto i = 0; i < tetras.size(); i++)
+      update.emplace_back(tetras[i], accepted_vals[i]);
     return true;
   };  // one_ring_smoother
 
   auto ser_energy = [&](auto name) {
-    auto energy = energy_evaluation(lagr, p4T, vec_dxyz);
     auto file = H5Easy::File(name, H5Easy::File::Overwrite);
-    H5Easy::dump(file, "energy", energy);
+    H5Easy::dump(file, "energy", energy.values());
     H5Easy::dump(file, "lagr", lagr);
     H5Easy::dump(file, "cells", p4T);
   };
@@ -426,7 +615,6 @@ void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
   std::vector<int> serial_set;
   int threshold = threadNum * 2;
   if (inside_verts.empty()) {
-    auto energy = energy_evaluation(lagr, p4T, vec_dxyz);
     spdlog::info("Smoothing skipped {}/{}| Energy {} | vCnt={}",
                  total_iteration, total_iteration, e_stat(energy),
                  inside_verts.size());
@@ -434,38 +622,70 @@ void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int total_iteration,
   }
   one_ring_vertex_sets(lagr.rows(), inside_verts, VT, p4T, threshold,
                        concurrent_sets, serial_set);
+  std::vector<EnergyUpdate> updates;
+  auto apply_updates = [&]() {
+    for (auto &update : updates) {
+      for (auto [t, e] : update) energy.set(t, e);
+      update.clear();
+    }
+  };
   for (int it = 0; it < total_iteration; it++) {
     for (const auto &s : concurrent_sets) {
+      updates.resize(std::max(updates.size(), s.size()));
       igl::parallel_for(
-          s.size(), [&](size_t i) { one_ring_smoother(s[i]); }, 1);
+          s.size(), [&](size_t i) { one_ring_smoother(s[i], updates[i]); },
+          1);
+      apply_updates();
     }
 
-    for (size_t v_id : serial_set) one_ring_smoother(v_id);
+    updates.resize(std::max<size_t>(updates.size(), 1));
+    for (size_t v_id : serial_set) {
+      one_ring_smoother(v_id, updates[0]);
+      apply_updates();
+    }
 
-    auto energy = energy_evaluation(lagr, p4T, vec_dxyz);
     spdlog::info("Smoothing it={}/{}  | Energy {} | vCnt={}", it + 1,
                  total_iteration, e_stat(energy), inside_verts.size());
   }
   // ser_energy("after.h5");  // save to file
 }
 
+// sorted vertex multiset of the node with codec `cod` in a linear tet, shared
+// by the tets around the node.
+template <int Order, typename Tet, typename Cod>
+std::array<int, Order> node_key(const Tet &tet, const Cod &cod) {
+  std::array<int, Order> key;
+  auto cnt = 0;
+  for (auto j = 0; j < 4; j++) {
+    for (auto k = 0; k < cod[j]; k++) {
+      key[cnt++] = tet[j];
+    }
+  }
+  std::sort(key.begin(), key.end());
+  return key;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // A generic implementation of tetrahedral mesh operations:
 // Input: local
 // Output: localconnect modifier map, nodemodify map.
-std::optional<
-    std::tuple<std::vector<std::tuple<int, Vec3d>>,
-               std::vector<Eigen::VectorXi>, std::map<int, std::vector<int>>>>
-local_edit(const std::vector<Vec3d> &nodes,
-           const std::vector<Eigen::VectorXi> &all_tets,
-           const std::vector<int> &old_ids, const std::vector<int> &new_ids,
-           const std::vector<Eigen::Vector4i> &new_tets,
-           const std::vector<std::vector<int>> &connect, double old_quality) {
-  using veci = Eigen::VectorXi;
+template <int Order>
+std::optional<std::tuple<std::vector<std::tuple<int, Vec3d>>,
+                         std::vector<typename CuTetMesh<Order>::Tet>,
+                         std::map<int, std::vector<int>>, std::vector<double>>>
+local_edit(const CuTetMesh<Order> &mesh, const std::vector<int> &old_ids,
+           const std::vector<int> &new_ids,
+           const std::vector<Eigen::Vector4i> &new_tets, double old_quality) {
+  using Key = std::array<int, Order>;
+  using Tet = typename CuTetMesh<Order>::Tet;
+  auto &nodes = mesh.vertices;
+  auto &all_tets = mesh.tets;
+  auto &connect = mesh.conn_tets;
 
   auto &helper = prism::curve::magic_matrices();
   auto &codec = helper.volume_data.vol_codec;
   auto &vec_dxyz = helper.volume_data.vec_dxyz;
+  assert(codec(0, 0) == Order);
   RowMati linear_tet_block(old_ids.size(), 4);
   for (auto i = 0; i < old_ids.size(); i++)
     for (auto j = 0; j < 4; j++) {
@@ -476,60 +696,45 @@ local_edit(const std::vector<Vec3d> &nodes,
 
   // record bnd_nodes;
 
-  const int order = codec(0, 0);
-  auto construct_key = [order](const auto &tet, const auto &cod) {
-    veci key(order);
-    auto cnt = 0;
-    for (auto j = 0; j < 4; j++) {
-      for (auto k = 0; k < cod[j]; k++) {
-        key[cnt++] = tet[j];
-      }
-    }
-    std::sort(key.data(), key.data() + key.size());
-    return key;
+  auto construct_key = [](const auto &tet, const auto &cod) {
+    return node_key<Order>(tet, cod);
   };
 
-  CodecMap old_codec_nodes;  //
-  CodecMap bnd_codi_map;     // map from boundary nodes to original nodes.
-  std::vector<Vec3d> bnd_pos;
+  std::map<Key, int> old_codec_nodes;  //
+  std::map<Key, int> bnd_codi_map;  // map from boundary nodes to original nodes.
   for (auto i : old_ids) {
-    // spdlog::info("Tet {}", all_tets[i].transpose());
     for (auto n = 0; n < codec.rows(); n++) {
       auto key = construct_key(all_tets[i], codec.row(n));
       auto it = old_codec_nodes.lower_bound(key);
       if (it == old_codec_nodes.end() || it->first != key) {
-        // spdlog::info("key {}", key.transpose());
         it = old_codec_nodes.emplace_hint(it, key, all_tets[i][n]);
       }
     }
   }
   for (auto i = 0; i < bnd_f.rows(); i++) {
-    //  spdlog::info("face {}", bnd_f.row(i));
     for (auto n = 0; n < codec.rows(); n++) {
       if (codec(n, 3) != 0) continue;
       auto key = construct_key(bnd_f.row(i), codec.row(n));
       auto it = bnd_codi_map.lower_bound(key);
       if (it == bnd_codi_map.end() || it->first != key) {
-        // spdlog::info("cid {}", codec.row(n));
-        // spdlog::info("bey {}", key.transpose());
         bnd_codi_map.emplace_hint(it, key, old_codec_nodes.at(key));
       }
     }
   }
 
   // compute new and record
-  // tuple(t,e, node_id, node_pos)
-  std::vector<std::tuple<int, int, int, Vec3d>> node_map;
-  std::map<Eigen::VectorXi, std::tuple<int, Vec3d>, MatLexCompi> new_nodes;
-  auto new_cutets = std::vector<veci>(new_tets.size());
+  std::map<Key, std::tuple<int, Vec3d>> new_nodes;
+  auto new_cutets = std::vector<Tet>(new_tets.size());
   auto num_nodes = nodes.size();
   // also, a map from codec_i to pos
-  auto num_ele = all_tets[0].size();
+  constexpr auto num_ele = CuTetMesh<Order>::num_nodes;
   assert(num_ele == helper.volume_data.vol_codec.rows());
+  RowMatd local_nodes(num_ele, 3);
+  std::vector<double> new_energy(new_ids.size());
   for (auto i = 0; i < new_ids.size(); i++) {
     auto tet = new_tets[i];
-    new_cutets[i] = veci::Zero(num_ele);
-    RowMatd local_nodes = RowMatd::Zero(num_ele, 3);
+    new_cutets[i].fill(0);
+    local_nodes.setZero();
     for (auto n = 0; n < num_ele; n++) {
       auto key = construct_key(tet, codec.row(n));
       auto it = bnd_codi_map.find(key);
@@ -568,6 +773,7 @@ local_edit(const std::vector<Vec3d> &nodes,
       spdlog::trace("Quality {}", i);
       return {};
     }
+    new_energy[i] = q;
   }
 
   // if all the checks pass. real updates to be applied
@@ -580,7 +786,6 @@ local_edit(const std::vector<Vec3d> &nodes,
   for (auto [key, id] : old_codec_nodes) {
     if (bnd_codi_map.find(key) == bnd_codi_map.end()) removing_nodes.insert(id);
   }
-  // node_mod_map = std::tuple(vec_rm_nodes, new_cutets);
 
   // connectivity VT
   auto relevant_vert =
@@ -614,40 +819,63 @@ local_edit(const std::vector<Vec3d> &nodes,
         n, Vec3d::Constant(std::numeric_limits<double>::quiet_NaN()));
   for (auto &[key, val] : new_nodes) node_assigner.emplace_back(val);
   return std::optional(std::tuple(std::move(node_assigner),
-                                  std::move(new_cutets), std::move(new_vt)));
+                                  std::move(new_cutets), std::move(new_vt),
+                                  std::move(new_energy)));
 };
 
-int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
+// apply the result of a successful local_edit, with the energies of the new
+// tets.
+template <int Order, typename Edit>
+void commit_local_edit(CuTetMesh<Order> &mesh, const std::vector<int> &old_tids,
+                       const std::vector<int> &new_tids, Edit &edit,
+                       EnergyCache &energy) {
+  auto &[node_assigner, new_cutets, new_vt, new_energy] = edit;
+  for (auto &[n, p] : node_assigner) {
+    if (n >= mesh.vertices.size()) mesh.resize_vertices(n + 1);
+    if (p.hasNaN()) {
+      mesh.v_is_removed[n] = true;
+    }
+    mesh.vertices[n] = p;
+  }
+  for (auto t : old_tids) {
+    mesh.tets[t].fill(-1);
+    mesh.t_is_removed[t] = true;
+    energy.remove(t);
+  }
+  for (auto i = 0; i < new_tids.size(); i++) {
+    if (new_tids[i] >= mesh.tets.size()) {  // appended by the edit.
+      mesh.tets.resize(new_tids[i] + 1);
+      mesh.t_is_removed.resize(new_tids[i] + 1, true);
+    }
+    mesh.tets[new_tids[i]] = new_cutets[i];
+    mesh.t_is_removed[new_tids[i]] = false;
+    energy.set(new_tids[i], new_energy[i]);
+  }
+  for (auto &[v, vt] : new_vt) {
+    if (vt.size() == 0) mesh.v_is_removed[v] = true;
+    std::sort(vt.begin(), vt.end());
+    mesh.conn_tets.assign(v, vt.begin(), vt.end());
+  }
+}
+
+template <int Order>
+int cutet_collapse_impl(CuTetMesh<Order> &mesh,
+                        const std::set<int> &inside_verts, double stop_energy,
+                        EnergyCache &energy) {
   auto &helper = prism::curve::magic_matrices();
-  auto &codecs_o4 = helper.volume_data.vol_codec;
   auto &vec_dxyz = helper.volume_data.vec_dxyz;
-  auto &codecs_o9 = helper.volume_data.vol_jac_codec;
-  auto &bern_from_lagr_o4 = helper.volume_data.vol_bern_from_lagr;
-  auto &bern_from_lagr_o9 = helper.volume_data.vol_jac_bern_from_lagr;
-
-  auto inside_verts = verts_inside_volume(p4T);
-
-  auto n_node = codecs_o4.rows();
-  if (n_node != p4T.cols()) {
+  constexpr auto n_node = CuTetMesh<Order>::num_nodes;
+  if (helper.volume_data.vol_codec.rows() != n_node) {
     spdlog::critical("tet order mismatch");
     throw std::runtime_error("tet order mismatch");
   }
+  auto &vertices = mesh.vertices;
+  auto &tets = mesh.tets;
+  auto &conn_tets = mesh.conn_tets;
+  auto &v_is_removed = mesh.v_is_removed;
+  auto &t_is_removed = mesh.t_is_removed;
 
-  std::vector<Vec3d> vertices(lagr.rows());
-  std::vector<Eigen::VectorXi> tets(p4T.rows());
-  for (int i = 0; i < lagr.rows(); i++) {
-    vertices[i] = lagr.row(i);
-  }
-  for (int i = 0; i < p4T.rows(); i++) {
-    tets[i] = p4T.row(i);
-  }
-
-  // conn_tets[i] = j -> i-th vertex connected with j-th tet
-  std::vector<std::vector<int>> conn_tets(vertices.size());
-  for (int i = 0; i < tets.size(); i++) {
-    for (int j = 0; j < 4; j++) conn_tets[tets[i][j]].push_back(i);
-  }
-  auto find = [](auto &arr, auto &val) {
+  auto find = [](const auto &arr, const auto &val) {
     for (auto j = 0; j < arr.size(); j++)
       if (arr[j] == val) return j;
     return -1;
@@ -657,34 +885,19 @@ int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       for (auto j = 0; j < 4; j++) {
         auto v = tets[i][j];
         if (find(conn_tets[v], i) == -1) {
-          spdlog::critical("wrong conn ({}):{}", v,
-                           fmt::join(conn_tets[v], ","));
+          spdlog::critical(
+              "wrong conn ({}):{}", v,
+              fmt::join(conn_tets[v].begin(), conn_tets[v].end(), ","));
           return false;
         }
       }
     return true;
   }());
   //
-  std::vector<bool> v_is_removed(vertices.size(), false);
-  std::vector<bool> t_is_removed(tets.size(), false);
-  //
   std::vector<bool> is_surface_vs(vertices.size(), true);
   for (int v_id : inside_verts) is_surface_vs[v_id] = false;
   //
-  std::vector<std::array<int, 2>> edges;
-  for (int i = 0; i < tets.size(); i++) {
-    const auto &t = tets[i];
-    for (int j = 0; j < 3; j++) {
-      std::array<int, 2> e = {{t[0], t[j + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-      e = {{t[j + 1], t[(j + 1) % 3 + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-    }
-  }
-  std::sort(edges.begin(), edges.end());
-  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  auto edges = mesh.edges();
 
   std::priority_queue<ElementInQueue, std::vector<ElementInQueue>, cmp_s>
       ec_queue;
@@ -698,6 +911,9 @@ int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
 
   // Collapsing starts
   auto cnt_suc = 0;
+  std::vector<int> old_tids, new_tids;
+  std::vector<Eigen::Vector4i> new_tets;
+  typename CuTetMesh<Order>::Shell shell;
   while (!ec_queue.empty()) {
     auto [e, old_weight] = ec_queue.top();
     ec_queue.pop();
@@ -710,12 +926,12 @@ int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
     // try to collapse an edge
     auto [v1_id, v2_id] = e;
     spdlog::debug("Entering {}-{}", v1_id, v2_id);
-    std::vector<int> old_tids = conn_tets[v1_id];
-    std::vector<Eigen::Vector4i> new_tets;
-    std::vector<int> new_tids = {};
+    old_tids.assign(conn_tets[v1_id].begin(), conn_tets[v1_id].end());
+    new_tets.clear();
+    new_tids.clear();
 
     for (auto t : old_tids) {
-      Eigen::Vector4i line_tet = tets[t].head(4);
+      Eigen::Vector4i line_tet = mesh.linear(t);
       auto v1_i = find(line_tet, v1_id);
       auto v2_i = find(line_tet, v2_id);
       assert(v1_i >= 0);
@@ -726,33 +942,21 @@ int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
     }
     assert(new_tids.size() < old_tids.size());
     // link condition
-    std::set<int> inter;
-    std::set_intersection(conn_tets[v1_id].begin(), conn_tets[v1_id].end(),
-                          conn_tets[v2_id].begin(), conn_tets[v2_id].end(),
-                          std::inserter(inter, inter.end()));
-    if (inter.size() != old_tids.size() - new_tids.size()) {
+    mesh.edge_shell(v1_id, v2_id, shell);
+    if (shell.size() != old_tids.size() - new_tids.size()) {
       spdlog::info("lk condition");
       continue;
     }
 
     double max_energy = stop_energy;  // max_energy of old tets
-    for (auto t_id : old_tids) {
-      RowMatX3d old_nodes35(n_node, 3);
-      for (auto j = 0; j < codecs_o4.rows(); j++) {
-        old_nodes35.row(j) = vertices[tets[t_id][j]];
-      }
-      auto [q, ign] = mips_energy(old_nodes35, vec_dxyz);
-      max_energy = std::max(max_energy, q);
-    }
+    for (auto t_id : old_tids) max_energy = std::max(max_energy, energy[t_id]);
 
-    auto is_valid = local_edit(vertices, tets, old_tids, new_tids, new_tets,
-                               conn_tets, max_energy);
+    auto is_valid = local_edit(mesh, old_tids, new_tids, new_tets, max_energy);
     if (!is_valid) continue;
     spdlog::debug("[{}] Success {} {}", cnt_suc, v1_id, v2_id);
     cnt_suc++;
-    auto &[node_assigner, new_cutets, new_vt] = is_valid.value();
-    assert([&new_vt = new_vt]() -> bool {
-      for (auto [v, vt] : new_vt) {
+    assert([&new_vt = std::get<2>(is_valid.value())]() -> bool {
+      for (auto &[v, vt] : new_vt) {
         if (vt.size() == 0) return true;
       }
       return false;
@@ -765,63 +969,35 @@ int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
     spdlog::trace("old_tids {}", fmt::join(old_tids, ","));
     spdlog::trace("new tids {}", fmt::join(new_tids, ","));
     auto n_v1_id = std::set<int>();
-    for (auto t_id: old_tids) {
+    for (auto t_id : old_tids) {
       for (int j = 0; j < 4; j++) {
-          n_v1_id.insert(tets[t_id][j]);
+        n_v1_id.insert(tets[t_id][j]);
       }
     }
-    for (auto t_id:old_tids) {
-      if (find(tets[t_id], v1_id) >= 0 && find(tets[t_id], v2_id) >= 0) { // removers.
-       for (int j = 0; j < 4; j++)
-        n_v1_id.erase(tets[t_id][j]);
+    for (auto t_id : old_tids) {
+      if (mesh.contains(t_id, v1_id) && mesh.contains(t_id, v2_id)) {
+        // removers.
+        for (int j = 0; j < 4; j++) n_v1_id.erase(tets[t_id][j]);
       }
     }
     n_v1_id.erase(v1_id);
     n_v1_id.erase(v2_id);
-    for (auto &[n, p] : node_assigner) {
-      if (n >= vertices.size()) {
-        vertices.resize(n + 1);
-        v_is_removed.resize(n + 1, false);
-      }
-      if (p.hasNaN()) {
-        v_is_removed[n] = true;
-      }
-      vertices[n] = p;
-    }
-    for (auto t : old_tids) {
-      tets[t].setConstant(-1);
-      t_is_removed[t] = true;
-    }
-    for (auto i = 0; i < new_tids.size(); i++) {
-      tets[new_tids[i]] = new_cutets[i];
-      t_is_removed[new_tids[i]] = false;
-    }
-    for (auto [v, vt] : new_vt) {
-      if (vt.size() == 0) v_is_removed[v] = true;
-      std::sort(vt.begin(), vt.end());
-      conn_tets[v] = std::move(vt);
-    }
+    commit_local_edit(mesh, old_tids, new_tids, is_valid.value(), energy);
     assert([&]() -> bool {
       for (auto i = 0; i < tets.size(); i++)
         for (auto j = 0; j < 4; j++) {
           auto v = tets[i][j];
           if (v == -1) continue;
           if (find(conn_tets[v], i) == -1) {
-            spdlog::critical("wrong conn i={}, VT(v{}):{}", i, v,
-                             fmt::join(conn_tets[v], ","));
+            spdlog::critical(
+                "wrong conn i={}, VT(v{}):{}", i, v,
+                fmt::join(conn_tets[v].begin(), conn_tets[v].end(), ","));
             return false;
           }
         }
       return true;
     }());
-    auto nb_v = std::set<int>();
-    for (auto t:conn_tets[v2_id]) {
-        for (auto j=0;j<4; j++) {
-          nb_v.insert(tets[t][j]);
-        }
-    }
-    nb_v.erase(v2_id);
-    spdlog::debug("nv1_id {}", fmt::join(n_v1_id,"."));
+    spdlog::debug("nv1_id {}", fmt::join(n_v1_id, "."));
     for (auto v_id : n_v1_id) {
       double l_2 = (vertices[v_id] - vertices[v2_id]).norm();
       if (!is_surface_vs[v_id])
@@ -832,120 +1008,75 @@ int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
     assert(v_is_removed.size() == vertices.size());
     assert(t_is_removed.size() == tets.size());
     assert(([&]() -> bool {  // check energy
-      for (auto i=0; i<tets.size(); i++) {
-        auto t = tets[i];
+      for (auto i = 0; i < tets.size(); i++) {
+        auto &t = tets[i];
         if (t_is_removed[i]) continue;
-          RowMatX3d nodes35(t.size(), 3);
-          for (auto j = 0; j < t.size(); j++) {
-            nodes35.row(j) = vertices[t[j]];
-          }
-          auto [val, ign] = mips_energy(nodes35, vec_dxyz, false);
-          if (std::isnan(val)) {
-            spdlog::critical("PostNAN!!!");
-            throw std::runtime_error("PostNAN!!!");
-          }
-          if (val > 1e8) {
-            spdlog::critical("large energy");
-            throw std::runtime_error("large energy");
-          }
+        RowMatX3d nodes35(t.size(), 3);
+        for (auto j = 0; j < t.size(); j++) {
+          nodes35.row(j) = vertices[t[j]];
+        }
+        auto [val, ign] = mips_energy(nodes35, vec_dxyz, false);
+        if (std::isnan(val)) {
+          spdlog::critical("PostNAN!!!");
+          throw std::runtime_error("PostNAN!!!");
+        }
+        if (val > 1e8) {
+          spdlog::critical("large energy");
+          throw std::runtime_error("large energy");
+        }
       }
       return true;
     }()));
   }
+  return cnt_suc;
+}
 
-  RowMatd lagr_new(std::count(v_is_removed.begin(), v_is_removed.end(), false),
-                   3);
-  RowMati p4T_new(std::count(t_is_removed.begin(), t_is_removed.end(), false),
-                  n_node);
-  std::vector<int> map_v_ids(vertices.size(), -1);
-  int cnt = 0;
-  for (int i = 0; i < vertices.size(); i++) {
-    if (v_is_removed[i]) continue;
-    lagr_new.row(cnt) = vertices[i];
-    map_v_ids[i] = cnt;
-    cnt++;
-  }
-  int cnt_t = 0;
-  for (int i = 0; i < tets.size(); i++) {
-    if (t_is_removed[i]) continue;
-    assert(tets[i][0] != -1);
-    for (int j = 0; j < tets[i].size(); j++) {
-      p4T_new(cnt_t, j) = map_v_ids[tets[i][j]];
-    }
-    cnt_t++;
-  }
+int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy) {
+  EnergyCache energy(lagr, p4T);
+  return cutet_collapse(lagr, p4T, stop_energy, energy);
+}
 
-  lagr = lagr_new;
-  p4T = p4T_new;
-  auto energy = energy_evaluation(lagr, p4T, vec_dxyz);
+int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy,
+                   EnergyCache &energy) {
+  auto inside_verts = verts_inside_volume(p4T);
+  auto cnt_suc = dispatch_tet_order(p4T.cols(), [&](auto order) {
+    CuTetMesh<decltype(order)::value> mesh(lagr, p4T);
+    auto cnt = cutet_collapse_impl(mesh, inside_verts, stop_energy, energy);
+    mesh.export_to(lagr, p4T);
+    energy.compact(mesh.t_is_removed);
+    return cnt;
+  });
   spdlog::info("{} edges collapsed | Energy {}", cnt_suc, e_stat(energy));
   return cnt_suc;
 }
 
-int cutet_swap(RowMatd &lagr, RowMati &p4T, double stop_energy) {
-  auto set_intersection = [](const std::vector<int> &s11,
-                             const std::vector<int> &s22, std::vector<int> &v) {
-    std::vector<int> s1 = s11;
-    std::vector<int> s2 = s22;
-    std::sort(s1.begin(), s1.end());
-    std::sort(s2.begin(), s2.end());
-    std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(),
-                          std::back_inserter(v));
-  };
-
-  /////////////////////////////
+template <int Order>
+int cutet_swap_impl(CuTetMesh<Order> &mesh, const std::set<int> &inside_verts,
+                    double stop_energy, EnergyCache &energy) {
   auto &helper = prism::curve::magic_matrices();
-  auto &codecs_o4 = helper.volume_data.vol_codec;
   auto &vec_dxyz = helper.volume_data.vec_dxyz;
-  auto &codecs_o9 = helper.volume_data.vol_jac_codec;
-  auto &bern_from_lagr_o4 = helper.volume_data.vol_bern_from_lagr;
-  auto &bern_from_lagr_o9 = helper.volume_data.vol_jac_bern_from_lagr;
-
-  auto n_node = codecs_o4.rows();
-  auto inside_verts = verts_inside_volume(p4T);
-  std::vector<Vec3d> vertices(lagr.rows());
-  std::vector<Eigen::VectorXi> tets(p4T.rows());
-  for (int i = 0; i < lagr.rows(); i++) {
-    vertices[i] = lagr.row(i);
-  }
-  for (int i = 0; i < p4T.rows(); i++) {
-    tets[i] = p4T.row(i);
-  }
-  // conn_tets[i] = j -> i-th vertex connected with j-th tet
-  std::vector<std::vector<int>> conn_tets(vertices.size());
-  for (int i = 0; i < tets.size(); i++) {
-    for (int j = 0; j < 4; j++) conn_tets[tets[i][j]].push_back(i);
+  constexpr auto n_node = CuTetMesh<Order>::num_nodes;
+  if (helper.volume_data.vol_codec.rows() != n_node) {
+    spdlog::critical("tet order mismatch");
+    throw std::runtime_error("tet order mismatch");
   }
-  //
-  std::vector<bool> v_is_removed(vertices.size(), false);
-  std::vector<bool> t_is_removed(tets.size(), false);
-  //
+  auto &vertices = mesh.vertices;
+  auto &tets = mesh.tets;
+
   std::vector<bool> is_surface_vs(vertices.size(), true);
   for (int v_id : inside_verts) is_surface_vs[v_id] = false;
   //
-  std::vector<std::array<int, 2>> edges;
-  for (int i = 0; i < tets.size(); i++) {
-    const auto &t = tets[i];
-    for (int j = 0; j < 3; j++) {
-      std::array<int, 2> e = {{t[0], t[j + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-      e = {{t[j + 1], t[(j + 1) % 3 + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-    }
-  }
-  std::sort(edges.begin(), edges.end());
-  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  auto edges = mesh.edges();
 
+  typename CuTetMesh<Order>::Shell shell;
   std::priority_queue<ElementInQueue, std::vector<ElementInQueue>, cmp_l>
       es_queue;
+  std::vector<int> n_v_ids;
   for (auto &e : edges) {
     if (is_surface_vs[e[0]] && is_surface_vs[e[1]]) {
-      std::vector<int> n12_t_ids;
-      set_intersection(conn_tets[e[0]], conn_tets[e[1]], n12_t_ids);
-      std::vector<int> n_v_ids;
-      for (int t_id : n12_t_ids) {
+      mesh.edge_shell(e[0], e[1], shell);
+      n_v_ids.clear();
+      for (int t_id : shell) {
         for (int j = 0; j < 4; j++) {
           if (tets[t_id][j] != e[0] && tets[t_id][j] != e[1])
             n_v_ids.push_back(tets[t_id][j]);
@@ -953,131 +1084,221 @@ int cutet_swap(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       }
       std::sort(n_v_ids.begin(), n_v_ids.end());
       n_v_ids.erase(std::unique(n_v_ids.begin(), n_v_ids.end()), n_v_ids.end());
-      if (n12_t_ids.size() != n_v_ids.size()) continue;
+      if (shell.size() != n_v_ids.size()) continue;
     }
     double l_2 = (vertices[e[0]] - vertices[e[1]]).norm();
     es_queue.push(ElementInQueue(e, l_2));
   }
   edges.clear();
 
+  // Edge removal (Shewchuk, Two Discrete Optimization Algorithms for the
+  // Topological Improvement of Tetrahedral Meshes): the n tets around an edge
+  // are replaced by 2n-4, the triangles of the link polygon joined with both
+  // endpoints. The triangulation minimizing the max energy is found by
+  // dynamic programming over the sub-polygons.
+  constexpr auto max_shell = 7;
+  using Key = std::array<int, Order>;
+  auto &codec = helper.volume_data.vol_codec;
+  std::vector<std::pair<Key, int>> bnd_nodes;
+  std::vector<int> ring;
+  bool flip = false;
+
+  // link polygon of an edge, starting from the link of shell[0]. False if the
+  // link is not a simple closed loop (boundary edge). `flip` records the
+  // orientation, such that (v1, a_i, a_k, a_j) is positive for i<k<j.
+  auto edge_link = [&](int v1, int v2) -> bool {
+    std::array<std::array<int, 2>, max_shell> link;
+    for (auto i = 0; i < shell.size(); i++) {
+      auto c = 0;
+      for (auto j = 0; j < 4; j++) {
+        auto v = tets[shell[i]][j];
+        if (v != v1 && v != v2) link[i][c++] = v;
+      }
+    }
+    ring.assign(link[0].begin(), link[0].end());
+    auto used = 1;
+    for (auto step = 1; step < shell.size(); step++) {
+      auto found = false;
+      for (auto i = 1; i < shell.size() && !found; i++) {
+        if (used & (1 << i)) continue;
+        for (auto c = 0; c < 2; c++)
+          if (link[i][c] == ring.back()) {
+            ring.push_back(link[i][1 - c]);
+            used |= 1 << i;
+            found = true;
+            break;
+          }
+      }
+      if (!found) return false;
+    }
+    if (ring.back() != ring.front()) return false;
+    ring.pop_back();
+    auto sorted = ring;
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+      return false;
+    // parity of shell[0] against (v1, v2, a_0, a_1)
+    std::array<int, 4> ref = {v1, v2, ring[0], ring[1]}, perm;
+    for (auto j = 0; j < 4; j++)
+      perm[j] = int(std::find(ref.begin(), ref.end(), tets[shell[0]][j]) -
+                    ref.begin());
+    auto inversions = 0;
+    for (auto j = 0; j < 4; j++)
+      for (auto k = j + 1; k < 4; k++)
+        if (perm[j] > perm[k]) inversions++;
+    flip = inversions % 2 == 1;
+    return true;
+  };
+
+  // energy of a new tet, with the nodes on the shell boundary kept and the
+  // others linear. 1e100 if inverted, and the inversion check is skipped
+  // once the energy is no better than `bound`.
+  RowMatX3d local_nodes(n_node, 3);
+  auto candidate_energy = [&](const Eigen::Vector4i &tet, double bound) {
+    for (auto n = 0; n < n_node; n++) {
+      auto key = node_key<Order>(tet, codec.row(n));
+      auto it = std::lower_bound(bnd_nodes.begin(), bnd_nodes.end(),
+                                 std::pair(key, -1));
+      if (it != bnd_nodes.end() && it->first == key) {
+        local_nodes.row(n) = vertices[it->second];
+        continue;
+      }
+      local_nodes.row(n).setZero();
+      for (auto k = 0; k < 4; k++)
+        local_nodes.row(n) += codec(n, k) * vertices[tet[k]];
+      local_nodes.row(n) /= Order;
+    }
+    if (n_node == 35)
+      local_nodes.row(34) = local_nodes.topRows(34).colwise().mean().eval();
+    auto [q, ign] = mips_energy(local_nodes, vec_dxyz, false);
+    if (std::isnan(q)) return 1e100;
+    if (q >= bound) return q;
+    if (!prism::curve::tetrahedron_inversion_check(local_nodes)) return 1e100;
+    return q;
+  };
+  auto tri_tets = [&](int v1, int v2, int i, int k, int j) {
+    if (flip) std::swap(i, j);
+    return std::pair(Eigen::Vector4i(v1, ring[i], ring[k], ring[j]),
+                     Eigen::Vector4i(v2, ring[j], ring[k], ring[i]));
+  };
+
   int cnt_suc = 0;
+  std::array<int, max_shell - 2> cnt_shell{};
+  std::vector<int> old_tids, new_tids;
+  std::vector<Eigen::Vector4i> new_tets;
+  std::array<std::array<double, max_shell>, max_shell> cost;
+  std::array<std::array<int, max_shell>, max_shell> split;
   while (!es_queue.empty()) {
     auto [e, old_weight] = es_queue.top();
     es_queue.pop();
     auto [v1_id, v2_id] = e;
 
-    std::vector<int> old_tids;
-    set_intersection(conn_tets[e[0]], conn_tets[e[1]], old_tids);
-    if (old_tids.size() != 3)
-      continue;  // only enables 3-2 swap https://i.imgur.com/zcmFleu.png
-
-    auto id_in_array = [](auto &v, auto &k) {
-      for (auto i = 0; i < v.size(); i++) {
-        if (v[i] == k) return i;
-      }
-      return -1;
-    };
-
-    auto t0_id = old_tids[0];
-    int t1_id = old_tids[1];
-    int t2_id = old_tids[2];
-    std::array<int, 2> t12_ids = {{t1_id, t2_id}};
-    auto n0_id = -1, n1_id = -1, n2_id = -1;
-    for (int j = 0; j < 4; j++) {
-      auto v0j = tets[t0_id][j];
-      if (v0j != v1_id && v0j != v2_id) {
-        if (id_in_array(tets[t1_id], v0j) != -1)
-          n1_id = v0j;
-        if (id_in_array(tets[t2_id], v0j) != -1)
-          n2_id = v0j;
-      }
-      if (id_in_array(tets[t0_id], tets[t1_id][j]) == -1)
-        n0_id = tets[t1_id][j];
-    }
-    assert (n0_id != n1_id && n1_id != n2_id);
-    // T0 = (n1,n2,v1,v2) -> (n1,n2,v1,n0)
-    // T1 = (n0, n1, v1,v2) ->  (n0, n1, n2,v2) 
-    // T2 = (n0,n2, v1,v2) -> (-1,-1,-1,-1)
-    auto new_tids = std::vector<int>({t0_id, t1_id});
-    auto new_tets = std::vector<Eigen::Vector4i>(2);
-    auto replace = [](auto& arr, auto v0, auto v1){
-      for (auto j=0 ;j<arr.size();j++) if (arr[j]==v0) arr[j] = v1;
-    };
-    new_tets[0] = tets[new_tids[0]].head(4);
-    new_tets[1] = tets[new_tids[1]].head(4);
-
-    replace(new_tets[0], v2_id, n0_id);
-    replace(new_tets[1], v1_id, n2_id);
+    mesh.edge_shell(e[0], e[1], shell);
+    if (shell.size() < 3 || shell.size() > max_shell) continue;
+    if (!edge_link(v1_id, v2_id)) continue;
+    old_tids.assign(shell.begin(), shell.end());
+    const int n = ring.size();
 
     double max_energy = stop_energy;
-    for (int t_id : old_tids) {
-      RowMatX3d old_nodes35(n_node, 3);
-      for (int j = 0; j < codecs_o4.rows(); j++) {
-        old_nodes35.row(j) = vertices[tets[t_id][j]];
+    for (int t_id : old_tids) max_energy = std::max(max_energy, energy[t_id]);
+
+    // nodes on the shell boundary, which do not involve both v1 and v2.
+    bnd_nodes.clear();
+    for (auto t : old_tids)
+      for (auto nd = 0; nd < n_node; nd++) {
+        auto key = node_key<Order>(tets[t], codec.row(nd));
+        if (std::find(key.begin(), key.end(), v1_id) != key.end() &&
+            std::find(key.begin(), key.end(), v2_id) != key.end())
+          continue;
+        bnd_nodes.emplace_back(key, tets[t][nd]);
       }
-      std::tuple<double, RowMatX3d> old_q = mips_energy(old_nodes35, vec_dxyz);
-      if (std::get<0>(old_q) > max_energy) max_energy = std::get<0>(old_q);
-    }
-    auto is_valid = local_edit(vertices, tets, old_tids, new_tids, new_tets, conn_tets, max_energy);
+    std::sort(bnd_nodes.begin(), bnd_nodes.end());
+    bnd_nodes.erase(std::unique(bnd_nodes.begin(), bnd_nodes.end()),
+                    bnd_nodes.end());
+
+    // cost[i][j]: min over the triangulations of the sub-polygon (a_i..a_j)
+    // of the max energy, only below the current max_energy.
+    for (auto i = 0; i + 1 < n; i++) cost[i][i + 1] = 0.;
+    for (auto len = 2; len < n; len++)
+      for (auto i = 0; i + len < n; i++) {
+        auto j = i + len;
+        cost[i][j] = max_energy;
+        split[i][j] = -1;
+        for (auto k = i + 1; k < j; k++) {
+          auto c = std::max(cost[i][k], cost[k][j]);
+          if (c >= cost[i][j]) continue;
+          auto [tet1, tet2] = tri_tets(v1_id, v2_id, i, k, j);
+          c = std::max(c, candidate_energy(tet1, cost[i][j]));
+          if (c >= cost[i][j]) continue;
+          c = std::max(c, candidate_energy(tet2, cost[i][j]));
+          if (c >= cost[i][j]) continue;
+          cost[i][j] = c;
+          split[i][j] = k;
+        }
+      }
+    if (split[0][n - 1] == -1) continue;
+
+    new_tets.clear();
+    std::vector<std::array<int, 2>> stack;
+    stack.push_back({0, n - 1});
+    while (!stack.empty()) {
+      auto [i, j] = stack.back();
+      stack.pop_back();
+      if (j - i < 2) continue;
+      auto k = split[i][j];
+      assert(k != -1);
+      auto [tet1, tet2] = tri_tets(v1_id, v2_id, i, k, j);
+      new_tets.push_back(tet1);
+      new_tets.push_back(tet2);
+      stack.push_back({i, k});
+      stack.push_back({k, j});
+    }
+    assert(new_tets.size() == 2 * n - 4);
+    new_tids.clear();
+    for (auto i = 0; i < new_tets.size(); i++)
+      new_tids.push_back(i < n ? old_tids[i] : int(tets.size()) + i - n);
+
+    auto is_valid = local_edit(mesh, old_tids, new_tids, new_tets, max_energy);
     if (!is_valid) continue;
-    spdlog::debug("[{}] Success {} {}", cnt_suc, v1_id, v2_id);
+    spdlog::debug("[{}] Success {} {} ({}-{})", cnt_suc, v1_id, v2_id, n,
+                  2 * n - 4);
     cnt_suc++;
-    auto &[node_assigner, new_cutets, new_vt] = is_valid.value();
-    // update
-     for (auto &[n, p] : node_assigner) {
-      if (n >= vertices.size()) {
-        vertices.resize(n + 1);
-        v_is_removed.resize(n + 1, false);
-      }
-      if (p.hasNaN()) {
-        v_is_removed[n] = true;
-      }
-      vertices[n] = p;
-    }
-    for (auto t : old_tids) {
-      tets[t].setConstant(-1);
-      t_is_removed[t] = true;
-    }
-    for (auto i = 0; i < new_tids.size(); i++) {
-      tets[new_tids[i]] = new_cutets[i];
-      t_is_removed[new_tids[i]] = false;
-    }
-    for (auto [v, vt] : new_vt) {
-      if (vt.size() == 0) v_is_removed[v] = true;
-      std::sort(vt.begin(), vt.end());
-      conn_tets[v] = std::move(vt);
-    }
+    cnt_shell[n - 3]++;
+    commit_local_edit(mesh, old_tids, new_tids, is_valid.value(), energy);
   }
+  spdlog::debug("edge removal by shell size (3..{}): {}", max_shell,
+                fmt::join(cnt_shell, ","));
+  return cnt_suc;
+}
 
-  RowMatd lagr_new(std::count(v_is_removed.begin(), v_is_removed.end(), false),
-                   3);
-  RowMati p4T_new(std::count(t_is_removed.begin(), t_is_removed.end(), false),
-                  n_node);
-  std::vector<int> map_v_ids(vertices.size(), -1);
-  int cnt = 0;
-  for (int i = 0; i < vertices.size(); i++) {
-    if (v_is_removed[i]) continue;
-    lagr_new.row(cnt) = vertices[i];
-    map_v_ids[i] = cnt;
-    cnt++;
-  }
-  int cnt_t = 0;
-  for (int i = 0; i < tets.size(); i++) {
-    if (t_is_removed[i]) continue;
-    for (int j = 0; j < tets[i].size(); j++) {
-      p4T_new(cnt_t, j) = map_v_ids[tets[i][j]];
-    }
-    cnt_t++;
-  }
-  p4T = p4T_new;
-  lagr = lagr_new;
-  auto energy = energy_evaluation(lagr, p4T, vec_dxyz);
+int cutet_swap(RowMatd &lagr, RowMati &p4T, double stop_energy) {
+  EnergyCache energy(lagr, p4T);
+  return cutet_swap(lagr, p4T, stop_energy, energy);
+}
+
+int cutet_swap(RowMatd &lagr, RowMati &p4T, double stop_energy,
+               EnergyCache &energy) {
+  auto inside_verts = verts_inside_volume(p4T);
+  auto cnt_suc = dispatch_tet_order(p4T.cols(), [&](auto order) {
+    CuTetMesh<decltype(order)::value> mesh(lagr, p4T);
+    auto cnt = cutet_swap_impl(mesh, inside_verts, stop_energy, energy);
+    mesh.export_to(lagr, p4T);
+    energy.compact(mesh.t_is_removed);
+    return cnt;
+  });
   spdlog::info("{} edges swapped   | Energy {}", cnt_suc, e_stat(energy));
   return cnt_suc;
 };
 
+// dense index of a tet codec, (order+1)^4 entries.
+template <int Order>
+constexpr int codec_key(int c0, int c1, int c2, int c3) {
+  return ((c0 * (Order + 1) + c1) * (Order + 1) + c2) * (Order + 1) + c3;
+}
 
+// The two passes below hard-code the single interior node of P4 (34).
 int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
+  constexpr auto order = 4;
   auto &helper = prism::curve::magic_matrices();
   auto &codecs_o4 = helper.volume_data.vol_codec;
   auto &vec_dxyz = helper.volume_data.vec_dxyz;
@@ -1087,47 +1308,23 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
 
   auto inside_verts = verts_inside_volume(p4T);
 
-  auto n_node = codecs_o4.rows();
-  if (n_node != p4T.cols()) {
+  constexpr auto n_node = CuTetMesh<order>::num_nodes;
+  if (codecs_o4.rows() != n_node || n_node != p4T.cols()) {
     spdlog::critical("tet order mismatch");
     throw std::runtime_error("tet order mismatch");
   }
 
-  std::vector<Vec3d> vertices(lagr.rows());
-  std::vector<Eigen::VectorXi> tets(p4T.rows());
-  for (int i = 0; i < lagr.rows(); i++) {
-    vertices[i] = lagr.row(i);
-  }
-  for (int i = 0; i < p4T.rows(); i++) {
-    tets[i] = p4T.row(i);
-  }
-
-  // conn_tets[i] = j -> i-th vertex connected with j-th tet
-  std::vector<std::vector<int>> conn_tets(vertices.size());
-  for (int i = 0; i < tets.size(); i++) {
-    for (int j = 0; j < 4; j++) conn_tets[tets[i][j]].push_back(i);
-  }
-  //
-  std::vector<bool> v_is_removed(vertices.size(), false);
-  std::vector<bool> t_is_removed(tets.size(), false);
+  CuTetMesh<order> mesh(lagr, p4T);
+  auto &vertices = mesh.vertices;
+  auto &tets = mesh.tets;
+  auto &conn_tets = mesh.conn_tets;
+  auto &v_is_removed = mesh.v_is_removed;
+  auto &t_is_removed = mesh.t_is_removed;
   //
   std::vector<bool> is_surface_vs(vertices.size(), true);
   for (int v_id : inside_verts) is_surface_vs[v_id] = false;
   //
-  std::vector<std::array<int, 2>> edges;
-  for (int i = 0; i < tets.size(); i++) {
-    const auto &t = tets[i];
-    for (int j = 0; j < 3; j++) {
-      std::array<int, 2> e = {{t[0], t[j + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-      e = {{t[j + 1], t[(j + 1) % 3 + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-    }
-  }
-  std::sort(edges.begin(), edges.end());
-  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  auto edges = mesh.edges();
 
   std::priority_queue<ElementInQueue, std::vector<ElementInQueue>, cmp_s>
       ec_queue;
@@ -1139,8 +1336,18 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
   }
   edges.clear();
 
+  // codec -> local node index
+  std::vector<int> codec_index(codec_key<order>(order + 1, 0, 0, 0), -1);
+  for (int j = 0; j < n_node; j++)
+    codec_index[codec_key<order>(codecs_o4(j, 0), codecs_o4(j, 1),
+                                 codecs_o4(j, 2), codecs_o4(j, 3))] = j;
+
   // Collapsing starts
   auto cnt_suc = 0;
+  std::vector<int> check_t_ids, rm_t_ids;
+  NodeMap<int> map_node_ids;
+  NodeMap<std::pair<int, Vec3d>> map_node_pos;
+  RowMatX3d old_nodes35(n_node, 3), nodes35(n_node, 3);
   while (!ec_queue.empty()) {
     auto [e, old_weight] = ec_queue.top();
     ec_queue.pop();
@@ -1153,61 +1360,51 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
     // try to collapse an edge
     auto [v1_id, v2_id] = e;
     spdlog::debug("Entering {}-{}", v1_id, v2_id);
-    std::vector<int> check_t_ids;
-    std::vector<int> rm_t_ids;            // those containing (v1, v2)
+    check_t_ids.clear();
+    rm_t_ids.clear();                     // those containing (v1, v2)
     for (auto t_id : conn_tets[v1_id]) {  // for all tets connected with v1,
                                           // either check or delete
-      if (std::find(conn_tets[v2_id].begin(), conn_tets[v2_id].end(), t_id) ==
-          conn_tets[v2_id].end())  // if t_id not adjacent to v2
+      if (!mesh.contains(t_id, v2_id))    // if t_id not adjacent to v2
         check_t_ids.push_back(t_id);
       else
         rm_t_ids.push_back(t_id);  // remove all tets with v1-v2.
     }
 
-    auto map_node_ids = [&rm_t_ids, &tets, &codecs_o4, v1_id = v1_id,
-                         v2_id = v2_id]() {
-      // maps from
-      std::map<int, int> map_node_ids;
-      for (int i = 0; i < rm_t_ids.size(); i++) {
-        int t_id = rm_t_ids[i];
-        auto v1_id_j = -1, v2_id_j = -1;
-        for (int j = 0; j < 4; j++) {
-          if (tets[t_id][j] == v1_id) v1_id_j = j;
-          if (tets[t_id][j] == v2_id) v2_id_j = j;
-        }
-        assert(v1_id_j != -1 && v2_id_j != -1);
-        std::map<std::array<int, 4>, int> local_map;  // codec -> node_id
-        for (int j = 0; j < codecs_o4.rows(); j++) {
-          local_map[{{codecs_o4(j, 0), codecs_o4(j, 1), codecs_o4(j, 2),
-                      codecs_o4(j, 3)}}] = tets[t_id][j];
-        }
-
-        for (int j = 0; j < codecs_o4.rows(); j++) {
-          if (codecs_o4(j, v1_id_j) != 0 &&
-              codecs_o4(j, v2_id_j) ==
-                  0) {  // ho-nodes that only depend on v1, oppo faces to v2.
-            std::array<int, 4> code_j = {{codecs_o4(j, 0), codecs_o4(j, 1),
-                                          codecs_o4(j, 2), codecs_o4(j, 3)}};
-            code_j[v2_id_j] = code_j[v1_id_j];
-            code_j[v1_id_j] = 0;  // exchange of bc between v1-v2
-            int tmp_v2_id = local_map[code_j];
-            map_node_ids[tets[t_id][j]] = tmp_v2_id;
-          }
+    // maps from the nodes only depending on v1 to their v2 counterparts.
+    map_node_ids.clear();
+    for (int i = 0; i < rm_t_ids.size(); i++) {
+      int t_id = rm_t_ids[i];
+      auto v1_id_j = -1, v2_id_j = -1;
+      for (int j = 0; j < 4; j++) {
+        if (tets[t_id][j] == v1_id) v1_id_j = j;
+        if (tets[t_id][j] == v2_id) v2_id_j = j;
+      }
+      assert(v1_id_j != -1 && v2_id_j != -1);
+      for (int j = 0; j < n_node; j++) {
+        if (codecs_o4(j, v1_id_j) != 0 &&
+            codecs_o4(j, v2_id_j) ==
+                0) {  // ho-nodes that only depend on v1, oppo faces to v2.
+          std::array<int, 4> code_j = {{codecs_o4(j, 0), codecs_o4(j, 1),
+                                        codecs_o4(j, 2), codecs_o4(j, 3)}};
+          code_j[v2_id_j] = code_j[v1_id_j];
+          code_j[v1_id_j] = 0;  // exchange of bc between v1-v2
+          auto k = codec_index[codec_key<order>(code_j[0], code_j[1],
+                                                code_j[2], code_j[3])];
+          assert(k >= 0);
+          map_node_ids[tets[t_id][j]] = tets[t_id][k];
         }
       }
-      return std::move(map_node_ids);
-    }();
+    }
 
-    std::map<int, std::pair<int, Vec3d>> map_node_pos;
+    map_node_pos.clear();
     auto is_valid = true;
     double max_energy = 0;  // max_energy of old tets
     for (auto t_id : check_t_ids) {
-      RowMatX3d old_nodes35(n_node, 3);
-      for (auto j = 0; j < codecs_o4.rows(); j++) {
+      for (auto j = 0; j < n_node; j++) {
         old_nodes35.row(j) = vertices[tets[t_id][j]];
       }
-      std::tuple<double, RowMatX3d> old_q = mips_energy(old_nodes35, vec_dxyz);
-      if (std::get<0>(old_q) > max_energy) max_energy = std::get<0>(old_q);
+      auto [q, ign] = mips_energy(old_nodes35, vec_dxyz);
+      max_energy = std::max(max_energy, q);
     }
 
     for (auto i = 0; i < check_t_ids.size(); i++) {
@@ -1222,8 +1419,8 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
         } else
           new_vs[j] = vertices[tets[t_id][j]];
       }
-      RowMatX3d nodes35 = RowMatX3d::Zero(n_node, 3);  // n_elem*3
-      for (int j = 0; j < codecs_o4.rows(); j++) {
+      nodes35.setZero();
+      for (int j = 0; j < n_node; j++) {
         if (codecs_o4(j, v1_id_k) ==
             0) {  // no contribution from v1 (boundary), use nodes directly.
           nodes35.row(j) = vertices[tets[t_id][j]];
@@ -1237,9 +1434,9 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       }
       auto &cur_tet = tets[t_id];
       // for the nodes in map_node_ids, record in map_node_pos.
-      for (auto j = 0; j < codecs_o4.rows(); j++) {
-        if (map_node_ids.find(cur_tet[j]) != map_node_ids.end()) {
-          int mapped_n_id = map_node_ids[cur_tet[j]];
+      for (auto j = 0; j < n_node; j++) {
+        if (auto mapped = map_node_ids.find(cur_tet[j])) {
+          int mapped_n_id = *mapped;
           nodes35.row(j) = vertices[mapped_n_id];
           map_node_pos[cur_tet[j]] =
               std::make_pair(mapped_n_id, nodes35.row(j));
@@ -1260,9 +1457,8 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
         is_valid = false;
         break;
       }
-      std::tuple<double, RowMatX3d> q = mips_energy(nodes35, vec_dxyz);
-      if (std::get<0>(q) > std::max(stop_energy, max_energy)) {
-        // if (std::get<0>(q) > stop_energy) {
+      auto [q, ign] = mips_energy(nodes35, vec_dxyz);
+      if (q > std::max(stop_energy, max_energy)) {
         is_valid = false;
         break;
       }
@@ -1295,30 +1491,27 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       for (int j = 0; j < 4; j++) {
         if (tets[t_id][j] == v1_id) v1_id_j = j;
         //
-        conn_tets[tets[t_id][j]].erase(
-            std::find(conn_tets[tets[t_id][j]].begin(),
-                      conn_tets[tets[t_id][j]].end(), t_id));
+        conn_tets.erase(tets[t_id][j], t_id);
       }
-      for (int j = 0; j < tets[t_id].size(); j++) {
+      for (int j = 0; j < n_node; j++) {
         if (codecs_o4(j, v1_id_j) != 0) v_is_removed[tets[t_id][j]] = true;
       }
     }
 
     for (int t_id : check_t_ids) {
-      for (int j = 0; j < tets[t_id].size(); j++) {
-        if (map_node_pos.find(tets[t_id][j]) != map_node_pos.end()) {
-          int new_v_id = map_node_pos[tets[t_id][j]].first;
+      for (int j = 0; j < n_node; j++) {
+        if (auto node_pos = map_node_pos.find(tets[t_id][j])) {
+          auto [new_v_id, pos] = *node_pos;
           if (new_v_id >= 0) {
             tets[t_id][j] = new_v_id;
           } else {
-            auto pos = map_node_pos[tets[t_id][j]].second;
             vertices[tets[t_id][j]] = pos;
           }
         }
       }
-      conn_tets[v2_id].push_back(t_id);
+      conn_tets.push_back(v2_id, t_id);
     }
-    spdlog::debug("nv1_id {}", fmt::join(n_v1_id,"."));
+    spdlog::debug("nv1_id {}", fmt::join(n_v1_id, "."));
     for (int v_id : n_v1_id) {
       double l_2 = (vertices[v_id] - vertices[v2_id]).norm();
       if (!is_surface_vs[v_id])
@@ -1328,32 +1521,7 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
     }
   }
 
-  RowMatd lagr_new(std::count(v_is_removed.begin(), v_is_removed.end(), false),
-                   3);
-  RowMati p4T_new(std::count(t_is_removed.begin(), t_is_removed.end(), false),
-                  n_node);
-  std::vector<int> map_v_ids(vertices.size(), -1);
-  int cnt = 0;
-  for (int i = 0; i < vertices.size(); i++) {
-    if (v_is_removed[i]) continue;
-    lagr_new.row(cnt) = vertices[i];
-    map_v_ids[i] = cnt;
-    cnt++;
-  }
-  int cnt_t = 0;
-  for (int i = 0; i < tets.size(); i++) {
-    if (t_is_removed[i]) continue;
-    for (int j = 0; j < tets[i].size(); j++) {
-      p4T_new(cnt_t, j) = map_v_ids[tets[i][j]];
-    }
-    cnt_t++;
-  }
-
-  // auto ofile = H5Easy::File(in_file + "_out.h5", H5Easy::File::Overwrite);
-  // H5Easy::dump(ofile, "lagr", lagr_new);
-  // H5Easy::dump(ofile, "cells", p4T_new);
-  lagr = lagr_new;
-  p4T = p4T_new;
+  mesh.export_to(lagr, p4T);
   auto energy = energy_evaluation(lagr, p4T, vec_dxyz);
   spdlog::info("{} edges collapsed | Energy {}", cnt_suc, e_stat(energy));
   return cnt_suc;
@@ -1362,17 +1530,7 @@ int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
-  auto set_intersection = [](const std::vector<int> &s11,
-                             const std::vector<int> &s22, std::vector<int> &v) {
-    std::vector<int> s1 = s11;
-    std::vector<int> s2 = s22;
-    std::sort(s1.begin(), s1.end());
-    std::sort(s2.begin(), s2.end());
-    std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(),
-                          std::back_inserter(v));
-  };
-
-  /////////////////////////////
+  constexpr auto order = 4;
   auto &helper = prism::curve::magic_matrices();
   auto &codecs_o4 = helper.volume_data.vol_codec;
   auto &vec_dxyz = helper.volume_data.vec_dxyz;
@@ -1380,50 +1538,32 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
   auto &bern_from_lagr_o4 = helper.volume_data.vol_bern_from_lagr;
   auto &bern_from_lagr_o9 = helper.volume_data.vol_jac_bern_from_lagr;
 
-  auto n_node = codecs_o4.rows();
-  auto inside_verts = verts_inside_volume(p4T);
-  std::vector<Vec3d> vertices(lagr.rows());
-  std::vector<Eigen::VectorXi> tets(p4T.rows());
-  for (int i = 0; i < lagr.rows(); i++) {
-    vertices[i] = lagr.row(i);
-  }
-  for (int i = 0; i < p4T.rows(); i++) {
-    tets[i] = p4T.row(i);
-  }
-  // conn_tets[i] = j -> i-th vertex connected with j-th tet
-  std::vector<std::vector<int>> conn_tets(vertices.size());
-  for (int i = 0; i < tets.size(); i++) {
-    for (int j = 0; j < 4; j++) conn_tets[tets[i][j]].push_back(i);
+  constexpr auto n_node = CuTetMesh<order>::num_nodes;
+  if (codecs_o4.rows() != n_node || n_node != p4T.cols()) {
+    spdlog::critical("tet order mismatch");
+    throw std::runtime_error("tet order mismatch");
   }
-  //
-  std::vector<bool> v_is_removed(vertices.size(), false);
-  std::vector<bool> t_is_removed(tets.size(), false);
+  auto inside_verts = verts_inside_volume(p4T);
+  CuTetMesh<order> mesh(lagr, p4T);
+  auto &vertices = mesh.vertices;
+  auto &tets = mesh.tets;
+  auto &conn_tets = mesh.conn_tets;
+  auto &v_is_removed = mesh.v_is_removed;
+  auto &t_is_removed = mesh.t_is_removed;
   //
   std::vector<bool> is_surface_vs(vertices.size(), true);
   for (int v_id : inside_verts) is_surface_vs[v_id] = false;
   //
-  std::vector<std::array<int, 2>> edges;
-  for (int i = 0; i < tets.size(); i++) {
-    const auto &t = tets[i];
-    for (int j = 0; j < 3; j++) {
-      std::array<int, 2> e = {{t[0], t[j + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-      e = {{t[j + 1], t[(j + 1) % 3 + 1]}};
-      if (e[0] > e[1]) std::swap(e[0], e[1]);
-      edges.push_back(e);
-    }
-  }
-  std::sort(edges.begin(), edges.end());
-  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  auto edges = mesh.edges();
 
+  CuTetMesh<order>::Shell n12_t_ids;
   std::priority_queue<ElementInQueue, std::vector<ElementInQueue>, cmp_l>
       es_queue;
+  std::vector<int> n_v_ids;
   for (auto &e : edges) {
     if (is_surface_vs[e[0]] && is_surface_vs[e[1]]) {
-      std::vector<int> n12_t_ids;
-      set_intersection(conn_tets[e[0]], conn_tets[e[1]], n12_t_ids);
-      std::vector<int> n_v_ids;
+      mesh.edge_shell(e[0], e[1], n12_t_ids);
+      n_v_ids.clear();
       for (int t_id : n12_t_ids) {
         for (int j = 0; j < 4; j++) {
           if (tets[t_id][j] != e[0] && tets[t_id][j] != e[1])
@@ -1439,9 +1579,14 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
   }
   edges.clear();
 
+  // face nodes of a tet, indexed by their codec restricted to three
+  // vertices, (order+1)^3 entries.
+  struct FaceNodes {
+    std::array<int, (order + 1) * (order + 1) * (order + 1)> id;
+    SmallVector<int, 16> keys;
+  };
   auto map_nodes = [&](int t_id, const std::array<int, 3> &v_ids,
-                       int empty_v_id,
-                       std::map<std::array<int, 3>, int> &map_node_coords) {
+                       int empty_v_id, FaceNodes &map_node_coords) {
     auto empty_v_id_j = -1;
     std::array<int, 3> v_ids_j = {-1, -1, -1};
     for (int j = 0; j < 4; j++) {
@@ -1454,15 +1599,31 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       else if (tets[t_id][j] == v_ids[2])
         v_ids_j[2] = j;
     }
+    map_node_coords.keys.clear();
     for (int j = 0; j < n_node; j++) {
       if (codecs_o4(j, empty_v_id_j) == 0) {
-        map_node_coords[{{codecs_o4(j, v_ids_j[0]), codecs_o4(j, v_ids_j[1]),
-                          codecs_o4(j, v_ids_j[2])}}] = tets[t_id][j];
+        auto key = (codecs_o4(j, v_ids_j[0]) * (order + 1) +
+                    codecs_o4(j, v_ids_j[1])) *
+                       (order + 1) +
+                   codecs_o4(j, v_ids_j[2]);
+        map_node_coords.id[key] = tets[t_id][j];
+        map_node_coords.keys.push_back(key);
       }
     }
   };
+  auto id_in_array = [](auto &v, auto &k) {
+    for (auto i = 0; i < v.size(); i++) {
+      if (v[i] == k) return i;
+    }
+    return -1;
+  };
 
   int cnt_suc = 0;
+  FaceNodes t0_map1_node_coords, t0_map2_node_coords, t1_map_node_coords,
+      t2_map_node_coords;
+  std::array<NodeMap<std::pair<int, Vec3d>>, 2> maps_node_ids;
+  std::vector<int> rm_v_ids;
+  RowMatX3d old_nodes35(n_node, 3), nodes35(n_node, 3);
   while (!es_queue.empty()) {
     std::array<int, 2> e = es_queue.top().v_ids;
     double old_weight = es_queue.top().weight;
@@ -1470,18 +1631,10 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
 
     int v1_id = e[0];
     int v2_id = e[1];
-    std::vector<int> n12_t_ids;
-    set_intersection(conn_tets[e[0]], conn_tets[e[1]], n12_t_ids);
+    mesh.edge_shell(e[0], e[1], n12_t_ids);
     if (n12_t_ids.size() != 3)
       continue;  // only enables 3-2 swap https://i.imgur.com/zcmFleu.png
 
-    auto id_in_array = [](auto &v, auto &k) {
-      for (auto i = 0; i < v.size(); i++) {
-        if (v[i] == k) return i;
-      }
-      return -1;
-    };
-
     int t0_id = n12_t_ids[0];
     std::array<int, 2> t12_ids = {{n12_t_ids[1], n12_t_ids[2]}};
     auto n0_id = -1, n1_id = -1, n2_id = -1;
@@ -1493,75 +1646,63 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       } else if (tets[t0_id][j] == v2_id) {
         ;  // v2_id_j = j;
       } else {
-        if (id_in_array(tets[t1_id], tets[t0_id][j]) != -1)
-          n1_id = tets[t0_id][j];
-        if (id_in_array(tets[t2_id], tets[t0_id][j]) != -1)
-          n2_id = tets[t0_id][j];
+        if (mesh.contains(t1_id, tets[t0_id][j])) n1_id = tets[t0_id][j];
+        if (mesh.contains(t2_id, tets[t0_id][j])) n2_id = tets[t0_id][j];
       }
-      if (id_in_array(tets[t0_id], tets[t1_id][j]) == -1)
-        n0_id = tets[t1_id][j];
+      if (!mesh.contains(t0_id, tets[t1_id][j])) n0_id = tets[t1_id][j];
     }
 
-    std::map<std::array<int, 3>, int> t0_map1_node_coords;
-    std::map<std::array<int, 3>, int> t0_map2_node_coords;
     map_nodes(t0_id, {{v1_id, n1_id, v2_id}}, n2_id, t0_map1_node_coords);
     map_nodes(t0_id, {{v1_id, n2_id, v2_id}}, n1_id, t0_map2_node_coords);
     //
-    std::array<std::map<int, std::pair<int, Vec3d>>, 2> maps_node_ids;
+    for (auto &m : maps_node_ids) m.clear();
 
     // v1n1v2 -> n0n1v2
     // v1n2v2 -> n0n2v2
-    std::map<std::array<int, 3>, int> t1_map_node_coords;
-    std::map<std::array<int, 3>, int> t2_map_node_coords;
     map_nodes(t1_id, {{n0_id, n1_id, v2_id}}, v1_id, t1_map_node_coords);
     map_nodes(t2_id, {{n0_id, n2_id, v2_id}}, v1_id, t2_map_node_coords);
-    for (auto &t0_map : t0_map1_node_coords) {
-      maps_node_ids[0][t0_map.second] =
-          std::make_pair(t1_map_node_coords[t0_map.first],
-                         vertices[t1_map_node_coords[t0_map.first]]);
+    for (auto k : t0_map1_node_coords.keys) {
+      auto n = t1_map_node_coords.id[k];
+      maps_node_ids[0][t0_map1_node_coords.id[k]] =
+          std::make_pair(n, vertices[n]);
     }
-    for (auto &t0_map : t0_map2_node_coords) {
-      maps_node_ids[0][t0_map.second] =
-          std::make_pair(t2_map_node_coords[t0_map.first],
-                         vertices[t2_map_node_coords[t0_map.first]]);
+    for (auto k : t0_map2_node_coords.keys) {
+      auto n = t2_map_node_coords.id[k];
+      maps_node_ids[0][t0_map2_node_coords.id[k]] =
+          std::make_pair(n, vertices[n]);
     }
 
-    std::map<int, int> map2_node_ids;
     // v1n1v2 -> v1n1n0
     // v1n2v2 -> v1n2n0
-    t1_map_node_coords.clear();
-    t2_map_node_coords.clear();
     map_nodes(t1_id, {{v1_id, n1_id, n0_id}}, v2_id, t1_map_node_coords);
     map_nodes(t2_id, {{v1_id, n2_id, n0_id}}, v2_id, t2_map_node_coords);
-    for (auto &t0_map : t0_map1_node_coords) {
-      maps_node_ids[1][t0_map.second] =
-          std::make_pair(t1_map_node_coords[t0_map.first],
-                         vertices[t1_map_node_coords[t0_map.first]]);
+    for (auto k : t0_map1_node_coords.keys) {
+      auto n = t1_map_node_coords.id[k];
+      maps_node_ids[1][t0_map1_node_coords.id[k]] =
+          std::make_pair(n, vertices[n]);
     }
-    for (auto &t0_map : t0_map2_node_coords) {
-      maps_node_ids[1][t0_map.second] =
-          std::make_pair(t2_map_node_coords[t0_map.first],
-                         vertices[t2_map_node_coords[t0_map.first]]);
+    for (auto k : t0_map2_node_coords.keys) {
+      auto n = t2_map_node_coords.id[k];
+      maps_node_ids[1][t0_map2_node_coords.id[k]] =
+          std::make_pair(n, vertices[n]);
     }
 
     ///////////////////////////
 
     double max_energy = 0;
     for (int t_id : n12_t_ids) {
-      RowMatX3d old_nodes35(n_node, 3);
-      for (int j = 0; j < codecs_o4.rows(); j++) {
+      for (int j = 0; j < n_node; j++) {
         old_nodes35.row(j) = vertices[tets[t_id][j]];
       }
-      std::tuple<double, RowMatX3d> old_q = mips_energy(old_nodes35, vec_dxyz);
-      if (std::get<0>(old_q) > max_energy) max_energy = std::get<0>(old_q);
+      auto [q, ign] = mips_energy(old_nodes35, vec_dxyz);
+      max_energy = std::max(max_energy, q);
     }
     //
     bool is_valid = true;
     for (int i = 0; i < 2; i++) {
-      RowMatX3d nodes35(n_node, 3);
-      for (int j = 0; j < codecs_o4.rows(); j++) {
-        if (maps_node_ids[i].find(tets[t0_id][j]) != maps_node_ids[i].end())
-          nodes35.row(j) = vertices[maps_node_ids[i][tets[t0_id][j]].first];
+      for (int j = 0; j < n_node; j++) {
+        if (auto m = maps_node_ids[i].find(tets[t0_id][j]))
+          nodes35.row(j) = vertices[m->first];
         else
           nodes35.row(j) = vertices[tets[t0_id][j]];
       }
@@ -1571,11 +1712,9 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
         tmp_v_id = v2_id;
       else
         tmp_v_id = v1_id;
-      int tmp_k =
-          std::distance(tets[t0_id].data(),
-                        std::find(tets[t0_id].data(), tets[t0_id].data() + 4,
-                                  tmp_v_id));  // find in true verts.
-      for (int j = 0; j < codecs_o4.rows(); j++) {
+      Eigen::Vector4i t0_verts = mesh.linear(t0_id);
+      int tmp_k = id_in_array(t0_verts, tmp_v_id);  // find in true verts.
+      for (int j = 0; j < n_node; j++) {
         if (codecs_o4(j, tmp_k) == 0 && codecs_o4(j, (tmp_k + 1) % 4) != 0 &&
             codecs_o4(j, (tmp_k + 2) % 4) != 0 &&
             codecs_o4(j, (tmp_k + 3) % 4) != 0) {
@@ -1597,8 +1736,8 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
           std::make_pair(-2, nodes35.row(34));
 
       /////
-      std::tuple<double, RowMatX3d> q = mips_energy(nodes35, vec_dxyz);
-      if (std::get<0>(q) > std::max(stop_energy, max_energy)) {
+      auto [q, ign] = mips_energy(nodes35, vec_dxyz);
+      if (q > std::max(stop_energy, max_energy)) {
         is_valid = false;
         break;
       }
@@ -1616,14 +1755,14 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
     ///////////////////////////
 
     // update
-    std::vector<int> rm_v_ids;
+    rm_v_ids.clear();
     for (int t_id : t12_ids) {
       int v1_id_k, v2_id_k;
       for (int k = 0; k < 4; k++) {
         if (tets[t_id][k] == v1_id) v1_id_k = k;
         if (tets[t_id][k] == v2_id) v2_id_k = k;
       }
-      for (int i = 0; i < codecs_o4.rows() - 1; i++) {
+      for (int i = 0; i < n_node - 1; i++) {
         if (codecs_o4(i, v1_id_k) != 0 && codecs_o4(i, v2_id_k) != 0) {
           v_is_removed[tets[t_id][i]] = true;
           rm_v_ids.push_back(tets[t_id][i]);
@@ -1644,8 +1783,8 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       else
         t_id = t1_id;
       for (int j = 0; j < n_node; j++) {
-        if (maps_node_ids[i].find(tets[t_id][j]) != maps_node_ids[i].end()) {
-          const auto tmp_map = maps_node_ids[i][tets[t_id][j]];
+        if (auto m = maps_node_ids[i].find(tets[t_id][j])) {
+          const auto tmp_map = *m;
           int v_id = tmp_map.first;
           if (v_id >= 0)
             tets[t_id][j] = v_id;
@@ -1657,59 +1796,29 @@ int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy) {
       }
     }
     //
-    t0_map1_node_coords.clear();
-    t0_map2_node_coords.clear();
     map_nodes(t0_id, {{n0_id, n1_id, n2_id}}, v2_id, t0_map1_node_coords);
     map_nodes(t1_id, {{n0_id, n1_id, n2_id}}, v1_id, t0_map2_node_coords);
-    std::map<int, int> map_node_id;
-    for (const auto &t0_map : t0_map1_node_coords) {
-      int t0_v_id = t0_map.second;
-      int t1_v_id = t0_map2_node_coords[t0_map.first];
+    for (auto k : t0_map1_node_coords.keys) {
+      int t0_v_id = t0_map1_node_coords.id[k];
+      int t1_v_id = t0_map2_node_coords.id[k];
       if (t0_v_id == t1_v_id) continue;
       //            v_is_removed[t0_v_id] = true;
       v_is_removed[t1_v_id] = false;
       int j = id_in_array(tets[t0_id], t0_v_id);
       tets[t0_id][j] = t1_v_id;
     }
-    conn_tets[v1_id].erase(
-        std::find(conn_tets[v1_id].begin(), conn_tets[v1_id].end(), t2_id));
-    conn_tets[v1_id].erase(
-        std::find(conn_tets[v1_id].begin(), conn_tets[v1_id].end(), t0_id));
-    conn_tets[v2_id].erase(
-        std::find(conn_tets[v2_id].begin(), conn_tets[v2_id].end(), t2_id));
-    conn_tets[v2_id].erase(
-        std::find(conn_tets[v2_id].begin(), conn_tets[v2_id].end(), t1_id));
+    conn_tets.erase(v1_id, t2_id);
+    conn_tets.erase(v1_id, t0_id);
+    conn_tets.erase(v2_id, t2_id);
+    conn_tets.erase(v2_id, t1_id);
     //
-    conn_tets[n0_id].erase(
-        std::find(conn_tets[n0_id].begin(), conn_tets[n0_id].end(), t2_id));
-    conn_tets[n0_id].push_back(t0_id);
-    conn_tets[n2_id].erase(
-        std::find(conn_tets[n2_id].begin(), conn_tets[n2_id].end(), t2_id));
-    conn_tets[n2_id].push_back(t1_id);
+    conn_tets.erase(n0_id, t2_id);
+    conn_tets.push_back(n0_id, t0_id);
+    conn_tets.erase(n2_id, t2_id);
+    conn_tets.push_back(n2_id, t1_id);
   }
 
-  RowMatd lagr_new(std::count(v_is_removed.begin(), v_is_removed.end(), false),
-                   3);
-  RowMati p4T_new(std::count(t_is_removed.begin(), t_is_removed.end(), false),
-                  n_node);
-  std::vector<int> map_v_ids(vertices.size(), -1);
-  int cnt = 0;
-  for (int i = 0; i < vertices.size(); i++) {
-    if (v_is_removed[i]) continue;
-    lagr_new.row(cnt) = vertices[i];
-    map_v_ids[i] = cnt;
-    cnt++;
-  }
-  int cnt_t = 0;
-  for (int i = 0; i < tets.size(); i++) {
-    if (t_is_removed[i]) continue;
-    for (int j = 0; j < tets[i].size(); j++) {
-      p4T_new(cnt_t, j) = map_v_ids[tets[i][j]];
-    }
-    cnt_t++;
-  }
-  p4T = p4T_new;
-  lagr = lagr_new;
+  mesh.export_to(lagr, p4T);
   auto energy = energy_evaluation(lagr, p4T, vec_dxyz);
   spdlog::info("{} edges swapped   | Energy {}", cnt_suc, e_stat(energy));
   return cnt_suc;
@@ -9,18 +9,81 @@ bool InversionCheck(const RowMatd &lagr, const RowMati &p4T,
                     const RowMatd &bern_from_lagr_o4,
                     const RowMatd &bern_from_lagr_o9);
 
+// MIPS energy per tet, 1e100 if inverted at a sample. Panels of tets are
+// evaluated in parallel, as in `tetrahedra_inversion_check`.
 Eigen::VectorXd energy_evaluation(RowMatd &lagr, RowMati &p4T,
                                   const std::vector<RowMatd> &vec_dxyz);
 
+// per tet quality of a high order mesh, evaluated in parallel.
+// Helper matrices must be initialized for the order of p4T.
+struct QualityStatistics {
+  Eigen::VectorXd mips;       // MIPS energy, 1e100 if inverted at a sample.
+  Eigen::VectorXd min_jac;    // min det(J) over the samples.
+  Eigen::VectorXd jac_ratio;  // min/max det(J) over the samples (scaled).
+  std::vector<int> certified; // Bernstein recursive inversion check passed.
+
+  struct Histogram {
+    std::vector<double> edges;  // bins+1, the outer bins are open ended.
+    std::vector<int> counts;
+  };
+  Histogram mips_hist, ratio_hist;
+  std::vector<int> worst_mips, worst_ratio;  // sorted, worst first.
+};
+QualityStatistics quality_statistics(const RowMatd &lagr, const RowMati &p4T,
+                                     int num_bins = 20, int num_worst = 10);
+
+// Per tet MIPS energy kept along the cutet passes, indexed as the rows of p4T.
+// The passes only re-evaluate the tets they touch, and the statistics are
+// updated on the way. The names follow Eigen, for `e_stat`.
+class EnergyCache {
+ public:
+  EnergyCache() = default;
+  EnergyCache(const RowMatd &lagr, const RowMati &p4T) { reset(lagr, p4T); }
+  void reset(const RowMatd &lagr, const RowMati &p4T);  // full evaluation.
+
+  // t may be past the end, for the tets appended by an edit.
+  void set(int t, double e);
+  void remove(int t);
+  // drop the removed entries, in the order of the compacted p4T.
+  void compact(const std::vector<bool> &t_is_removed);
+
+  double operator[](int t) const { return energy_[t]; }
+  int size() const { return count_; }  // number of tets.
+  // 0 for an empty cache.
+  double mean() const { return count_ > 0 ? sum_ / count_ : 0.; }
+  double minCoeff() const;
+  double maxCoeff() const;
+  Eigen::VectorXd values() const;
+
+  // max relative difference to a full evaluation.
+  double verify(const RowMatd &lagr, const RowMati &p4T) const;
+
+ private:
+  void rescan() const;
+  std::vector<double> energy_;  // NaN for removed slots.
+  double sum_ = 0.;
+  int count_ = 0;
+  mutable double min_ = 0., max_ = 0.;
+  mutable bool stale_ = false;
+};
+
 // lagr is unique here per nodes. not the duplicated version.
 void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int, int);
+void vertex_star_smooth(RowMatd &lagr, RowMati &p4T, int, int,
+                        EnergyCache &energy);
 
 int edge_collapsing(RowMatd &lagr, RowMati &p4T, double stop_energy);
 
 int edge_swapping(RowMatd &lagr, RowMati &p4T, double stop_energy);
 
 int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy);
+int cutet_collapse(RowMatd &lagr, RowMati &p4T, double stop_energy,
+                   EnergyCache &energy);
+// edge removal (n to 2n-4 tets, n up to 7) with the best triangulation of the
+// edge link.
 int cutet_swap(RowMatd &lagr, RowMati &p4T, double stop_energy);
+int cutet_swap(RowMatd &lagr, RowMati &p4T, double stop_energy,
+               EnergyCache &energy);
 }  // namespace prism::curve
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "inversion_check.hpp"
 
+#include <igl/parallel_for.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
@@ -132,4 +133,54 @@ bool prism::curve::tetrahedron_inversion_check(
   }
   return prism::curve::tetrahedron_recursive_positive_check(
       lagr, bern_from_lagr_o9, codecs_o9);
-}
\ No newline at end of file
+}
+
+std::vector<bool> prism::curve::tetrahedra_inversion_check(
+    const RowMatd& lagr, const RowMati& p4T, const Eigen::MatrixX4i& codecs_o4,
+    const Eigen::MatrixX4i& codecs_o9, const RowMatd& bern_from_lagr_o4,
+    const RowMatd& bern_from_lagr_o9, int block) {
+  int high_order = codecs_o9(0, 0);
+  auto num_nodes = bern_from_lagr_o4.rows();
+  auto num_samples = codecs_o9.rows();
+  // derivatives at the samples, composed with the conversion: 3s x n.
+  auto r1 = prism::curve::evaluate_bernstein_derivative(
+      codecs_o9.col(1).cast<double>() / high_order,
+      codecs_o9.col(2).cast<double>() / high_order,
+      codecs_o9.col(3).cast<double>() / high_order, codecs_o4);
+  Eigen::MatrixXd deriv(3 * num_samples, num_nodes);
+  for (auto k = 0; k < 3; k++)
+    deriv.middleRows(k * num_samples, num_samples) =
+        r1[k].matrix().transpose() * bern_from_lagr_o4;
+
+  std::vector<char> flags(p4T.rows(), 0);
+  auto num_panels = (p4T.rows() + block - 1) / block;
+  igl::parallel_for(
+      num_panels,
+      [&](int b) {
+        auto begin = b * block;
+        auto size = std::min<int>(block, p4T.rows() - begin);
+        Eigen::MatrixXd panel(num_nodes, 3 * size);
+        for (auto t = 0; t < size; t++)
+          for (auto j = 0; j < num_nodes; j++)
+            panel.block<1, 3>(j, 3 * t) = lagr.row(p4T(begin + t, j));
+        Eigen::MatrixXd samples = deriv * panel;
+        Eigen::MatrixXd jac_lagr(num_samples, size);
+        for (auto t = 0; t < size; t++)
+          for (auto i = 0; i < num_samples; i++) {
+            Eigen::Matrix3d temp;
+            for (auto j = 0; j < 3; j++)
+              temp.row(j) = samples.block<1, 3>(j * num_samples + i, 3 * t);
+            jac_lagr(i, t) = temp.determinant();
+          }
+        Eigen::MatrixXd jac_bern = bern_from_lagr_o9 * jac_lagr;
+        for (auto t = 0; t < size; t++) {
+          if (jac_lagr.col(t).minCoeff() <= 0) continue;
+          flags[begin + t] =
+              jac_bern.col(t).minCoeff() > 0 ||
+              tetrahedron_recursive_positive_check(
+                  jac_lagr.col(t), bern_from_lagr_o9, codecs_o9);
+        }
+      },
+      size_t(1));
+  return std::vector<bool>(flags.begin(), flags.end());
+}
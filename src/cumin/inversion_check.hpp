@@ -11,6 +11,15 @@ bool tetrahedron_inversion_check(const RowMatd& cp, const Eigen::MatrixX4i& code
                                  const RowMatd& bern_from_lagr_o4,
                                  const RowMatd& bern_from_lagr_o9);
 bool tetrahedron_inversion_check(const RowMatd& cp);
+
+// whole-mesh version of the above, one flag per row of p4T. The nodes of
+// `block` tets are gathered in a (nodes x 3*block) column major panel, so the
+// derivative samples and their Bernstein conversion are one GEMM per panel.
+// Only the tets not certified at the first level go through the recursion.
+std::vector<bool> tetrahedra_inversion_check(
+    const RowMatd& lagr, const RowMati& p4T, const Eigen::MatrixX4i& codecs_o4,
+    const Eigen::MatrixX4i& codecs_o9, const RowMatd& bern_from_lagr_o4,
+    const RowMatd& bern_from_lagr_o9, int block = 64);
 }  // namespace prism::curve
 
 #endif
\ No newline at end of file
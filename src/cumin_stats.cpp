@@ -0,0 +1,82 @@
+#include <spdlog/spdlog.h>
+
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <cumin/curve_utils.hpp>
+#include <cumin/high_order_optimization.hpp>
+#include <fstream>
+#include <highfive/H5Easy.hpp>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+// quality summary of a high order tetrahedral mesh (`lagr` and `cells` as
+// written by cumin_bin).
+int main(int argc, char **argv) {
+  CLI::App program{"Quality statistics of high order tetrahedral meshes."};
+
+  std::string input_file, output_file;
+  int num_bins = 20, num_worst = 10;
+  program.add_option("-i,--input", input_file, "input .h5 with lagr and cells")
+      ->required()
+      ->check(CLI::ExistingFile);
+  program.add_option("-o,--output", output_file, "output json, default stdout");
+  program.add_option("--bins", num_bins, "histogram bins");
+  program.add_option("--worst", num_worst, "number of worst elements listed");
+  program.add_option_function<int>(
+      "--loglevel",
+      [](const int &l) {
+        spdlog::set_level(static_cast<spdlog::level::level_enum>(l));
+      },
+      "log level");
+  CLI11_PARSE(program, argc, argv);
+
+  H5Easy::File file(input_file, H5Easy::File::ReadOnly);
+  auto lagr = H5Easy::load<RowMatd>(file, "lagr");
+  auto p4T = H5Easy::load<RowMati>(file, "cells");
+  auto order = 0;
+  while ((order + 1) * (order + 2) * (order + 3) < 6 * p4T.cols()) order++;
+  if ((order + 1) * (order + 2) * (order + 3) != 6 * p4T.cols() || order < 2)
+    throw std::runtime_error("cells are not high order tetrahedra.");
+  prism::curve::magic_matrices(order - 1, 3);
+
+  auto stats = prism::curve::quality_statistics(lagr, p4T, num_bins, num_worst);
+
+  auto summary = [](const Eigen::VectorXd &v) {
+    return nlohmann::json{{"min", v.minCoeff()},
+                          {"max", v.maxCoeff()},
+                          {"mean", v.mean()}};
+  };
+  auto hist = [](const auto &h) {
+    return nlohmann::json{{"edges", h.edges}, {"counts", h.counts}};
+  };
+  auto worst = [](const std::vector<int> &ids, const Eigen::VectorXd &v) {
+    auto list = nlohmann::json::array();
+    for (auto i : ids) list.push_back({i, v[i]});
+    return list;
+  };
+  auto num_certified =
+      std::count(stats.certified.begin(), stats.certified.end(), 1);
+  nlohmann::json js;
+  js["input"] = input_file;
+  js["order"] = order;
+  js["num_nodes"] = lagr.rows();
+  js["num_tets"] = p4T.rows();
+  js["num_certified"] = num_certified;
+  if (p4T.rows() > 0) {
+    js["mips"] = summary(stats.mips);
+    js["min_jac"] = summary(stats.min_jac);
+    js["jac_ratio"] = summary(stats.jac_ratio);
+  }
+  js["mips"]["histogram"] = hist(stats.mips_hist);
+  js["jac_ratio"]["histogram"] = hist(stats.ratio_hist);
+  js["mips"]["worst"] = worst(stats.worst_mips, stats.mips);
+  js["jac_ratio"]["worst"] = worst(stats.worst_ratio, stats.jac_ratio);
+
+  spdlog::info("{} tets, {} certified", p4T.rows(), num_certified);
+  if (output_file.empty()) {
+    std::cout << js.dump(2) << std::endl;
+  } else {
+    std::ofstream(output_file) << js.dump(2);
+  }
+  return num_certified == p4T.rows() ? 0 : 1;
+}
@@ -8,8 +8,7 @@
 #include <nlohmann/json.hpp>
 #include <stdexcept>
 
-void feature_and_curve(std::string filename, std::string fgname,
-                       std::string ser_file, nlohmann::json config);
+#include "pipeline_schedules.hpp"
 
 auto dict_to_option(nlohmann::json &config, CLI::App &program) -> void {
   for (auto &[cmd, subopt] : config.items()) {
@@ -57,40 +56,12 @@ int main(int argc, char **argv) {
 
   std::string suffix = "";
   program.add_option("--suffix", suffix, "suffix identifier");
+  std::vector<double> section_lengths;
+  program.add_option("--section-lengths", section_lengths,
+                     "remesh the mid surface of a shell checkpoint to each "
+                     "target edge length, instead of running the pipeline");
 
-  auto config = nlohmann::json();
-  config["curve"] = {{"order", 3},
-                     {"distance_threshold", 1e-2},
-                     {"normal_threshold", -1.0},
-                     {"recursive_check", true}};
-  config["shell"] = {{"initial_thickness", 1e-2},
-                     {"target_edge_length", 1e-1},
-                     {"distortion_bound", 0.01},
-                     {"target_thickness", 5e-2}};
-  config["feature"] = {
-      {"enable_polyshell", false},
-      {"initial_split_edge", 2e-1},
-      {"dihedral_threshold", 0.5}  // 120 degree.
-  };
-  config["control"] = {
-      {"enable_curve", true},
-      {"reset_cp", false},  // this is a experiment switch: reset linear cp so
-                            // that we can load a un-curved intermediate model.
-      {"serialize_level", 2},
-      {"freeze_feature", false},
-      {"only_initial", false},
-      {"skip_collapse", false},
-      {"skip_split", true},
-      {"skip_volume", false},
-      {"danger_relax_precondition", false}, // this is a experiment switch: bypass thresholds in precondition, the result may or may not encounter floating point failures.
-  };
-  config["tetfill"] = {{"tetwild", true}};
-  config["cutet"] = {
-      {"debug", false},
-      {"passes", 6},
-      {"smooth_iter", 4},
-      {"energy_threshold", 100},
-  };
+  auto config = default_pipeline_config();
   dict_to_option(config, program);
 
   program.callback([&]() {
@@ -102,6 +73,11 @@ int main(int argc, char **argv) {
     }
     spdlog::flush_on(spdlog::level::info);
     spdlog::info("{}", config.dump());
+    if (!section_lengths.empty()) {
+      section_from_checkpoint(input_file, section_lengths,
+                              output_dir + "/" + filename + suffix, config);
+      return;
+    }
     feature_and_curve(input_file, feature_graph_file,
                       output_dir + "/" + filename + suffix + ".h5", config);
   });
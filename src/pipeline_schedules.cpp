@@ -17,6 +17,7 @@
 
 #include "cumin/curve_utils.hpp"
 #include "cumin/curve_validity.hpp"
+#include "pipeline_schedules.hpp"
 #include "prism/PrismCage.hpp"
 #include "prism/cage_check.hpp"
 #include "prism/geogram/AABB.hpp"
@@ -122,7 +123,7 @@ constexpr auto consistent_orientation = [](const RowMati &F) {
 };
 
 bool preconditions(const RowMatd &V, const RowMati &F,
-                   const std::string &filename, bool shortcircuit=true) {
+                   const std::string &filename, bool shortcircuit) {
   spdlog::info("Preconditions: Checking consistency of input data, with short circuit {}", shortcircuit);
   if (F.rows() == 0) {
     spdlog::error("Precondition: Empty Mesh");
@@ -265,6 +266,21 @@ RowMatd one_side_extrusion(RowMatd &V, const RowMati &F, RowMatd &VN,
 #include <tetwild/Logger.h>
 #include <tetwild/tetwild.h>
 // label == 1 inside 2 outside
+void tetwild_fill(const Eigen::MatrixXd &V_in, const Eigen::MatrixXi &F_in,
+                  Eigen::MatrixXd &V_out, Eigen::MatrixXi &T_out,
+                  Eigen::VectorXi &label_output) {
+  Eigen::VectorXd quality_output;
+  tetwild::Args args;
+  args.initial_edge_len_rel = 0.25;
+  args.tet_mesh_sanity_check = true;
+  args.write_csv_file = false;
+  args.is_quiet = true;
+  args.postfix = "";
+  tetwild::logger().set_level(spdlog::level::info);
+  tetwild::tetrahedralization(V_in, F_in, V_out, T_out, quality_output,
+                              label_output, args);
+}
+
 void tetshell_fill(const RowMatd &ext_base, const RowMatd &shell_base,
                    const RowMatd &shell_top, const RowMatd &ext_top,
                    const RowMati &F_sh, Eigen::MatrixXd &V_out,
@@ -277,20 +293,86 @@ void tetshell_fill(const RowMatd &ext_base, const RowMatd &shell_base,
     F_in.middleRows(i * F_sh.rows(), F_sh.rows()) =
         F_sh.array() + oneShellVertices * i;
   }
-  Eigen::VectorXd quality_output;
-  tetwild::Args args;
-  args.initial_edge_len_rel = 0.25;
-  args.tet_mesh_sanity_check = true;
-  args.write_csv_file = false;
-  args.is_quiet = true;
-  args.postfix = "";
-  tetwild::logger().set_level(spdlog::level::info);
-  tetwild::tetrahedralization(V_in, F_in, V_out, T_out, quality_output,
-                              label_output, args);
+  tetwild_fill(V_in, F_in, V_out, T_out, label_output);
 };
 
+#include <igl/boundary_facets.h>
+#include <array>
+
+bool tetshell_fill_core(const RowMatd &ext_base, const RowMatd &shell_base,
+                        const RowMati &F_sh, Eigen::MatrixXd &V_out,
+                        Eigen::MatrixXi &T_out) {
+  auto n = shell_base.rows();
+  Eigen::MatrixXd V_in(2 * n, 3);
+  V_in << ext_base, shell_base;
+  Eigen::MatrixXi F_in(2 * F_sh.rows(), 3);
+  F_in << F_sh, F_sh.array() + n;
+  Eigen::MatrixXd Vmsh;
+  Eigen::MatrixXi Tmsh;
+  Eigen::VectorXi labels;
+  tetwild_fill(V_in, F_in, Vmsh, Tmsh, labels);
+
+  MatLexMap<Vec3d, int> base_ids;
+  for (auto i = 0; i < n; i++) base_ids.emplace(shell_base.row(i), i);
+  std::vector<bool> used(Vmsh.rows(), false), hit(n, false);
+  for (auto t = 0; t < Tmsh.rows(); t++) {
+    if (labels[t] != 1) continue;
+    for (auto j = 0; j < 4; j++) used[Tmsh(t, j)] = true;
+  }
+  std::vector<int> map_v(Vmsh.rows(), -1);
+  int cnt = n;
+  for (auto v = 0; v < Vmsh.rows(); v++) {
+    if (!used[v]) continue;
+    auto it = base_ids.find(Vec3d(Vmsh.row(v)));
+    if (it != base_ids.end() && !hit[it->second]) {
+      map_v[v] = it->second;
+      hit[it->second] = true;
+    } else
+      map_v[v] = cnt++;
+  }
+  if (std::count(hit.begin(), hit.end(), false) > 0) {
+    spdlog::warn("Core fill does not conform to the shell base ({}/{})",
+                 std::count(hit.begin(), hit.end(), true), n);
+    return false;
+  }
+  V_out.resize(cnt, 3);
+  V_out.topRows(n) = shell_base;
+  for (auto v = 0; v < Vmsh.rows(); v++)
+    if (used[v]) V_out.row(map_v[v]) = Vmsh.row(v);
+  T_out.resize((labels.array() == 1).count(), 4);
+  auto cnt_t = 0;
+  for (auto t = 0; t < Tmsh.rows(); t++) {
+    if (labels[t] != 1) continue;
+    for (auto j = 0; j < 4; j++) T_out(cnt_t, j) = map_v[Tmsh(t, j)];
+    cnt_t++;
+  }
+
+  // every base vertex may be hit while the base is still re-triangulated or
+  // carries Steiner points, so the boundary must be exactly `F_sh`.
+  Eigen::MatrixXi BF;
+  igl::boundary_facets(T_out, BF);
+  auto sorted_faces = [](const auto &M) {
+    std::vector<std::array<int, 3>> faces(M.rows());
+    for (auto i = 0; i < M.rows(); i++) {
+      faces[i] = {M(i, 0), M(i, 1), M(i, 2)};
+      std::sort(faces[i].begin(), faces[i].end());
+    }
+    std::sort(faces.begin(), faces.end());
+    return faces;
+  };
+  if (sorted_faces(BF) != sorted_faces(F_sh)) {
+    spdlog::warn("Core fill boundary does not match the shell base ({}/{})",
+                 BF.rows(), F_sh.rows());
+    return false;
+  }
+  spdlog::info("Core fill: {} tets, {} vertices", T_out.rows(), V_out.rows());
+  return true;
+}
+
 #include <cumin/high_order_optimization.hpp>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 
 #include "cumin/stitch_surface_to_volume.hpp"
 
@@ -307,7 +389,8 @@ bool checker_inversion(const PrismCage &pc,
   return true;
 };
 
-void cutet_optim(RowMatd &lagr, RowMati &p4T, nlohmann::json config) {
+void cutet_optim(RowMatd &lagr, RowMati &p4T, nlohmann::json config,
+                 PipelineProgress &progress) {
   auto debugMode = config["debug"];
   auto passes = config["passes"];
   auto smoothingIt = config["smooth_iter"];
@@ -341,52 +424,71 @@ void cutet_optim(RowMatd &lagr, RowMati &p4T, nlohmann::json config) {
     }
   };
 
+  // per tet energy, maintained by the passes. Only verified in debug mode.
+  prism::curve::EnergyCache energy(lagr, p4T);
+  auto EnergyCheck = [&](std::string str) {
+    auto diff = energy.verify(lagr, p4T);
+    if (diff > 1e-8) {
+      spdlog::error("Energy cache mismatch {}: {}", diff, str);
+      throw std::runtime_error("Energy cache mismatch");
+    }
+  };
+
   auto SaveToFile = [&](auto name) {
-    auto energy = prism::curve::energy_evaluation(lagr, p4T, vec_dxyz);
     auto file = H5Easy::File(name, H5Easy::File::ReadWrite);
-    H5Easy::dump(file, "energy", energy);
+    H5Easy::dump(file, "energy", energy.values());
     H5Easy::dump(file, "lagr", lagr);
     H5Easy::dump(file, "cells", p4T);
   };
 
   // pre-optimization check
   InversionCheckForAll("Before Optimization");
-  auto e = prism::curve::energy_evaluation(lagr, p4T, vec_dxyz);
   spdlog::info(
       "Before Optimization: meanE={:.2f} minE={:.2f} maxE={:.2f} | tetCnt={}",
-      e.mean(), e.minCoeff(), e.maxCoeff(), e.size());
+      energy.mean(), energy.minCoeff(), energy.maxCoeff(), energy.size());
 
   // optimization
   if (threadNum == -1) threadNum = 16;
+  progress("cutet", 0.);
   for (int pass = 1; pass <= passes; pass++) {
     spdlog::info("======== Optimization Pass {}/{} ========", pass, passes);
 
-    int col = prism::curve::cutet_collapse(lagr, p4T, newEnergyThres);
-    if (debugMode)
+    int col = prism::curve::cutet_collapse(lagr, p4T, newEnergyThres, energy);
+    if (debugMode) {
       InversionCheckForAll(fmt::format("Pass {} after collapsing", pass));
+      EnergyCheck(fmt::format("Pass {} after collapsing", pass));
+    }
 
-    int swa = prism::curve::cutet_swap(lagr, p4T, newEnergyThres);
-    if (debugMode)
+    int swa = prism::curve::cutet_swap(lagr, p4T, newEnergyThres, energy);
+    if (debugMode) {
       InversionCheckForAll(fmt::format("Pass {} after swapping", pass));
+      EnergyCheck(fmt::format("Pass {} after swapping", pass));
+    }
 
-    prism::curve::vertex_star_smooth(lagr, p4T, smoothingIt, threadNum);
-    if (debugMode)
+    prism::curve::vertex_star_smooth(lagr, p4T, smoothingIt, threadNum,
+                                     energy);
+    if (debugMode) {
       InversionCheckForAll(fmt::format("Pass {} after smoothing", pass));
+      EnergyCheck(fmt::format("Pass {} after smoothing", pass));
+    }
     if (col + swa == 0) break;
+    progress("cutet", double(pass) / passes);
   }
 
   // post-optimization check
   InversionCheckForAll("After Optimization");
+  progress("cutet", 1.);
 
   // save file
-  SaveToFile(config["output_file"]);
+  if (config.contains("output_file")) SaveToFile(config["output_file"]);
 
   double stageTime = igl_timer.getElapsedTime();
   spdlog::info("Total time for curved optimization = {}s", stageTime);
 }
 
 void volume_stage(PrismCage &pc, std::vector<RowMatd> &complete_cp,
-                  nlohmann::json config) {
+                  nlohmann::json config, RowMatd &nodes, RowMati &p4T,
+                  PipelineProgress &progress) {
   RowMatd mT, mB, vtop, vbase;
   RowMati mF;
   vec2eigen(pc.top, mT);
@@ -404,49 +506,205 @@ void volume_stage(PrismCage &pc, std::vector<RowMatd> &complete_cp,
     return;
   }
 
-  spdlog::info("== TOP ==");
-  vtop = one_side_extrusion(mT, mF, VN, true);
+  progress("volume", 0.);
   spdlog::info("== BOTTOM ==");
   vbase = one_side_extrusion(mB, mF, VN, false);
+  progress("volume", 0.2);
 
   Eigen::MatrixXd Vmsh;
   Eigen::MatrixXi Tmsh;
-  Eigen::VectorXi labels;
-  tetshell_fill(vbase, mB, mT, vtop, mF, Vmsh, Tmsh, labels);
-  spdlog::debug("Tmsh {}", Tmsh.rows());
-  std::vector<Eigen::VectorXi> T1;
-  for (auto l = 0; l < labels.size(); l++) {
-      if (labels[l] == 1)
-          T1.emplace_back(Tmsh.row(l));
+  auto filled = false;
+  if (config["tetfill"]["reuse_shell"])
+    filled = tetshell_fill_core(vbase, mB, mF, Vmsh, Tmsh);
+  if (!filled) {
+    spdlog::info("== TOP ==");
+    vtop = one_side_extrusion(mT, mF, VN, true);
+    Eigen::VectorXi labels;
+    tetshell_fill(vbase, mB, mT, vtop, mF, Vmsh, Tmsh, labels);
+    spdlog::debug("Tmsh {}", Tmsh.rows());
+    std::vector<Eigen::VectorXi> T1;
+    for (auto l = 0; l < labels.size(); l++) {
+        if (labels[l] == 1)
+            T1.emplace_back(Tmsh.row(l));
+    }
+    vec2eigen(T1, Tmsh);
   }
-  vec2eigen(T1, Tmsh);
 
   spdlog::debug("Tmsh {}", Tmsh.rows());
+  progress("volume", 0.8);
 
   auto &helper = prism::curve::magic_matrices(-1, -1);
-  const auto elevlag_from_bern = helper.elev_lag_from_bern;
-  const auto vec_dxyz = helper.volume_data.vec_dxyz;
-
-  RowMatd nodes;
-  RowMati p4T;
 
   prism::curve::stitch_surface_to_volume(
       mB, mT, mF, complete_cp, Vmsh, Tmsh, nodes, p4T);
-
-  cutet_optim(nodes, p4T, config["cutet"]);
+  progress("volume", 1.);
 };
 
-#include <igl/barycentric_coordinates.h>
-////////////////////////
-//// This is the main entry point for the curve mesh generation program.
-//// @Params:
-//// Mesh path. igl reader, supports obj, stl, off, ply
-//// feature (incl. constraint points) path: h5 file.
-//// Serialization path: h5 file
-//// Config JSON
-////////////////////////
-void feature_and_curve(std::string filename, std::string fgname,
-                       std::string ser_file, nlohmann::json config) {
+#include "cumin/bernstein_eval.hpp"
+bool surface_stage(const PrismCage &pc,
+                   const std::vector<RowMatd> &complete_cp, RowMatd &nodes,
+                   RowMati &cells) {
+  if (complete_cp.size() != pc.F.size()) {
+    spdlog::error("Surface Stage: control points do not match the faces.");
+    return false;
+  }
+  if (!checker_inversion(pc, complete_cp)) {
+    spdlog::error("Surface Stage: curved shell is not certified positive.");
+    return false;
+  }
+  auto order = 0;
+  while ((order + 1) * (order + 2) < 2 * complete_cp[0].rows()) order++;
+  assert((order + 1) * (order + 2) == 2 * complete_cp[0].rows());
+
+  // gmsh ordering: corners, edges (01, 12, 20), then interior recursively.
+  std::function<void(int, std::vector<Vec3i> &)> gmsh_tuples =
+      [&gmsh_tuples](int p, std::vector<Vec3i> &tup) {
+        if (p == 0) {
+          tup.push_back({0, 0, 0});
+          return;
+        }
+        tup.insert(tup.end(), {{p, 0, 0}, {0, p, 0}, {0, 0, p}});
+        for (auto k = 1; k < p; k++) tup.push_back({p - k, k, 0});
+        for (auto k = 1; k < p; k++) tup.push_back({0, p - k, k});
+        for (auto k = 1; k < p; k++) tup.push_back({k, 0, p - k});
+        if (p < 3) return;
+        std::vector<Vec3i> inner;
+        gmsh_tuples(p - 3, inner);
+        for (auto [a, b, c] : inner) tup.push_back({a + 1, b + 1, c + 1});
+      };
+  std::vector<Vec3i> gmsh_order;
+  gmsh_tuples(order, gmsh_order);
+
+  RowMati cod_bc;
+  vec2eigen(codecs_gen(order, 2), cod_bc);
+  auto cod_id = codecs_gen_id(order, 2);
+  std::map<Vec3i, int> bc_to_node;
+  for (auto i = 0; i < cod_bc.rows(); i++)
+    bc_to_node.emplace(Vec3i{cod_bc(i, 0), cod_bc(i, 1), cod_bc(i, 2)}, i);
+  std::vector<int> reorder;
+  for (auto &t : gmsh_order) reorder.push_back(bc_to_node.at(t));
+
+  // Bernstein coefficients to values at the uniform nodes.
+  Eigen::VectorXd X = cod_bc.col(1).cast<double>() / order;
+  Eigen::VectorXd Y = cod_bc.col(2).cast<double>() / order;
+  RowMatd lagr_from_bern =
+      prism::curve::evaluate_bernstein(X, Y, Eigen::VectorXd::Zero(X.size()),
+                                       cod_bc)
+          .matrix();
+
+  auto [index_entries, entries] = global_entry_map(pc.F, cod_id);
+  nodes.resize(index_entries.size(), 3);
+  for (auto k = 0; k < index_entries.size(); k++) {
+    auto [f, c] = index_entries[k];
+    nodes.row(k) = lagr_from_bern.row(c) * complete_cp[f];
+  }
+  cells.resize(pc.F.size(), reorder.size());
+  for (auto f = 0; f < pc.F.size(); f++)
+    for (auto j = 0; j < reorder.size(); j++)
+      cells(f, j) = entries.at(sort_slice(pc.F[f], cod_id.row(reorder[j])));
+  return true;
+}
+
+void write_lagrange_triangles_msh(const std::string &filename,
+                                  const RowMatd &nodes, const RowMati &cells) {
+  // gmsh element types for triangle 3, 6, 10, 15, 21
+  const std::map<int, int> gmsh_type = {
+      {3, 2}, {6, 9}, {10, 21}, {15, 23}, {21, 25}};
+  if (gmsh_type.find(cells.cols()) == gmsh_type.end())
+    throw std::runtime_error("Unsupported triangle order for gmsh output.");
+  std::ofstream out(filename);
+  out << "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n";
+  out << "$Nodes\n" << nodes.rows() << "\n";
+  out << std::setprecision(17);
+  for (auto i = 0; i < nodes.rows(); i++)
+    out << i + 1 << " " << nodes(i, 0) << " " << nodes(i, 1) << " "
+        << nodes(i, 2) << "\n";
+  out << "$EndNodes\n$Elements\n" << cells.rows() << "\n";
+  for (auto i = 0; i < cells.rows(); i++) {
+    out << i + 1 << " " << gmsh_type.at(cells.cols()) << " 2 0 0";
+    for (auto j = 0; j < cells.cols(); j++) out << " " << cells(i, j) + 1;
+    out << "\n";
+  }
+  out << "$EndElements\n";
+}
+
+nlohmann::json default_pipeline_config() {
+  auto config = nlohmann::json();
+  config["curve"] = {{"order", 3},
+                     {"distance_threshold", 1e-2},
+                     {"normal_threshold", -1.0},
+                     {"recursive_check", true}};
+  config["shell"] = {{"initial_thickness", 1e-2},
+                     {"target_edge_length", 1e-1},
+                     {"distortion_bound", 0.01},
+                     {"target_thickness", 5e-2}};
+  config["feature"] = {
+      {"enable_polyshell", false},
+      {"initial_split_edge", 2e-1},
+      {"dihedral_threshold", 0.5},  // 120 degree.
+      {"parallel_slide", false}  // feature slide over independent chains.
+  };
+  config["control"] = {
+      {"enable_curve", true},
+      {"reset_cp", false},  // this is a experiment switch: reset linear cp so
+                            // that we can load a un-curved intermediate model.
+      {"serialize_level", 2},
+      {"freeze_feature", false},
+      {"only_initial", false},
+      {"skip_collapse", false},
+      {"skip_split", true},
+      {"skip_volume", false},
+      {"surface_only", false},  // stop after curving, write the certified
+                                // high order triangles instead of tetrahedra.
+      {"danger_relax_precondition", false}, // this is a experiment switch: bypass thresholds in precondition, the result may or may not encounter floating point failures.
+  };
+  config["tetfill"] = {
+      {"tetwild", true},
+      {"reuse_shell", false},  // only fill the core inside the shell base,
+                               // falls back to the full stack if it fails.
+  };
+  config["section"] = {
+      {"iterations", 3},  // remeshing a checkpoint with `--section-lengths`.
+      {"smooth_per_iteration", 5},
+  };
+  config["cutet"] = {
+      {"debug", false},
+      {"passes", 6},
+      {"smooth_iter", 4},
+      {"energy_threshold", 100},
+  };
+  return config;
+}
+
+std::unique_ptr<PrismCage> shell_initialize(
+    RowMatd V, RowMati F, RowMati feature_edges,
+    Eigen::VectorXi feature_corners, Eigen::VectorXi points_fid,
+    RowMatd points_bc, nlohmann::json config) {
+  auto shell_cf = config["shell"];
+  auto featr_cf = config["feature"];
+  auto pre_split_threshold = featr_cf["initial_split_edge"].get<double>();
+  auto initial_thickness = shell_cf["initial_thickness"].get<double>();
+
+  if (!check_feature_valid(V, F, feature_corners, feature_edges))
+    return nullptr;
+
+  std::vector<int> face_parent(F.rows());
+  for (auto fi = 0; fi < F.rows(); fi++) face_parent[fi] = fi;
+  prism::feature_pre_split(V, F, feature_edges, pre_split_threshold,
+                           face_parent, points_fid, points_bc);
+
+  auto pc = std::make_unique<PrismCage>(
+      V, F, std::move(feature_edges), std::move(feature_corners),
+      std::move(points_fid), std::move(points_bc), initial_thickness,
+      PrismCage::SeparateType::kShell);
+  prism::cage_check::initial_trackee_reconcile(
+      *pc, shell_cf["distortion_bound"].get<double>());
+  return pc;
+}
+
+void shell_schedule(PrismCage &pc, std::vector<RowMatd> &complete_cp,
+                    nlohmann::json config, const std::string &ser_file,
+                    PipelineProgress &progress) {
   // Options
   auto curve_cf = config["curve"];
   auto shell_cf = config["shell"];
@@ -455,155 +713,25 @@ void feature_and_curve(std::string filename, std::string fgname,
   auto order = curve_cf["order"].get<int>();
   auto dist_th = curve_cf["distance_threshold"].get<double>();
   auto normal_th = curve_cf["normal_threshold"].get<double>();
-  auto pre_split_threshold = featr_cf["initial_split_edge"].get<double>();
-  auto initial_thickness = shell_cf["initial_thickness"].get<double>();
   auto target_edge_length = shell_cf["target_edge_length"].get<double>();
-  auto serialize_level = control_cfg["serialize_level"].get<int>();
+  auto serialize_level = ser_file.empty()
+                             ? 0
+                             : control_cfg["serialize_level"].get<int>();
   auto freeze_feature = control_cfg["freeze_feature"].get<bool>();
 
-  auto dihedral_threshold = featr_cf["dihedral_threshold"].get<double>();
-
-  auto parse_feature_file = [&](const auto &V, const auto &F,
-                                std::string fgname) {
-    RowMati feature_edges;
-    Eigen::VectorXi feature_corners;
-    Eigen::VectorXi points_fid;
-    RowMatd points_bc;
-    if (fgname == "") {  // no feature file, use threshold mark.
-      spdlog::info("Use dihedral threshold {} to mark features",
-                   dihedral_threshold);
-      prism::mark_feature_edges(V, F, dihedral_threshold, feature_edges);
-    } else {
-      auto ext = std::filesystem::path(fgname).extension();
-      if (ext == ".fgraph") {
-        prism::read_feature_graph(fgname, feature_corners, feature_edges);
-      } else if (ext == ".h5") {
-        prism::read_feature_h5(fgname, feature_corners, feature_edges,
-                               points_fid, points_bc);
-      }
-      spdlog::info("Parse Feature N {} E {} Constraint Points {}",
-                   feature_corners.size(), feature_edges.rows(),
-                   points_fid.size());
-    }
-    return std::tuple(feature_corners, feature_edges, points_fid, points_bc);
-  };
-  ///////
-  auto pc = std::unique_ptr<PrismCage>(nullptr);
-  auto complete_cp = std::vector<RowMatd>();
-  auto ext = std::filesystem::path(filename).extension();
-  if (ext == ".init" || ext == ".h5") {  // loading.
-    pc.reset(new PrismCage(filename));
-    if (ext == ".h5") {
-      if (!control_cfg["reset_cp"] && control_cfg["enable_curve"])
-        complete_cp = prism::curve::load_cp(filename);
-    }
-  }
-
-  if (pc == nullptr) {  // initialize shell.
-    RowMatd V;
-    RowMati F;
-    {
-      igl::read_triangle_mesh(filename, V, F);
-      if (fgname == "") {  // no feature, stl file TODO: branch can be merged,
-                           // subject to futher feature cleaning.
-        Eigen::VectorXi SVI, SVJ;
-        RowMatd temp_V = V;  // for STL file
-        igl::remove_duplicate_vertices(temp_V, 0, V, SVI, SVJ);
-        for (int i = 0; i < F.rows(); i++)
-          for (int j : {0, 1, 2}) F(i, j) = SVJ[F(i, j)];
-      }
-
-      spdlog::info("V={}, F={}", V.rows(), F.rows());
-      put_in_unit_box(V);
-      if (preconditions(V, F, filename, !control_cfg["danger_relax_precondition"]) ==false) return;
-    }
-    RowMati feature_edges;
-    Eigen::VectorXi feature_corners;
-    Eigen::VectorXi points_fid;
-    RowMatd points_bc;
-    std::tie(feature_corners, feature_edges, points_fid, points_bc) =
-        parse_feature_file(V, F, fgname);
-    if (!check_feature_valid(V, F, feature_corners, feature_edges)) return;
-
-    std::vector<int> face_parent(F.rows());
-    for (auto fi = 0; fi < F.rows(); fi++) face_parent[fi] = fi;
-    RowMatd origV = V;
-    RowMati origF = F;
-    prism::feature_pre_split(V, F, feature_edges, pre_split_threshold,
-                             face_parent);
-    auto assign_constraints_to_new_faces =
-        [](const RowMatd &oV, const RowMati &oF, const RowMatd &nV,
-           const RowMati &nF, const std::vector<int> &face_parent,
-           Eigen::VectorXi &points_fid, RowMatd &points_bc) {
-          auto eval_bc = [](auto &V, auto &f, auto &bc) {
-            Vec3d pos = Vec3d::Zero();
-            for (auto k = 0; k < 3; k++) pos += V.row(f[k]) * bc[k];
-            return pos;
-          };
-          if (points_fid.size() == 0) return;
-          std::vector<std::vector<int>> face_map(oF.rows());
-          for (auto i = 0; i < face_parent.size(); i++)
-            face_map[face_parent[i]].push_back(i);
-          for (auto p = 0; p < points_fid.size(); p++) {
-            auto f = points_fid(p);
-            Vec3d bc = points_bc.row(p);
-            auto &children = face_map[f];
-            Vec3d pos = eval_bc(oV, oF.row(f), bc);
-
-            Vec3d best_bc;
-            auto nfid = -1;
-            auto best_error = 1.;
-            // lets rank them
-            for (auto c : children) {
-              Vec3d nbc;
-              igl::barycentric_coordinates(pos, nV.row(nF(c, 0)),
-                                           nV.row(nF(c, 1)), nV.row(nF(c, 2)),
-                                           nbc);
-              auto npos = eval_bc(nV, nF.row(c), nbc);
-              auto error = ((npos - pos).squaredNorm());
-              if (best_error > error) {
-                best_error = error;
-                nfid = c;
-                best_bc = nbc;
-              }
-            }
-            if (best_error > 1e-5 || nfid == -1) {
-              spdlog::critical("Constraints Points Re-assign.");
-            }
-
-            points_fid[p] = nfid;
-            points_bc.row(p) = best_bc;
-          }
-        };
-    assign_constraints_to_new_faces(origV, origF, V, F, face_parent, points_fid,
-                                    points_bc);
-
-    pc.reset(new PrismCage(V, F, std::move(feature_edges),
-                           std::move(feature_corners), 
-                           std::move(points_fid), std::move(points_bc),
-                           initial_thickness,
-                           PrismCage::SeparateType::kShell));
-    prism::cage_check::initial_trackee_reconcile(
-        *pc, shell_cf["distortion_bound"].get<double>());
-    control_cfg["reset_cp"] = true;
-    spdlog::info("=====Initial Good. Saving.", ser_file);
-    pc->serialize(ser_file + ".init");
-  }
-  if (control_cfg["only_initial"]) return;
-
-  auto chains = prism::recover_chains_from_meta_edges(pc->meta_edges);
+  auto chains = prism::recover_chains_from_meta_edges(pc.meta_edges);
   spdlog::info("chains size {}", chains.size());
   if (control_cfg["enable_curve"] && control_cfg["reset_cp"] &&
-      complete_cp.size() != pc->F.size()) {
+      complete_cp.size() != pc.F.size()) {
     spdlog::info("order {} Reset CP", order);
     complete_cp =
-        prism::curve::initialize_cp(pc->mid, pc->F, codecs_gen_id(order,2));
+        prism::curve::initialize_cp(pc.mid, pc.F, codecs_gen_id(order,2));
   }
-  if (pc->ref.inpV.rows() == 0) {
+  if (pc.ref.inpV.rows() == 0) {
     spdlog::info("resetting inpV");
-    pc->ref.inpV = pc->ref.V;
+    pc.ref.inpV = pc.ref.V;
   }
-  prism::local::RemeshOptions option(pc->mid.size(), 0.1);
+  prism::local::RemeshOptions option(pc.mid.size(), 0.1);
   option.use_polyshell = featr_cf["enable_polyshell"].get<bool>();
   option.dynamic_hashgrid = true;
   option.distortion_bound = shell_cf["distortion_bound"].get<double>();
@@ -614,33 +742,34 @@ void feature_and_curve(std::string filename, std::string fgname,
   option.collapse_quality_threshold = 30;
   option.collapse_valence_threshold = 10;
   option.parallel = false;
+  option.parallel_feature = featr_cf["parallel_slide"].get<bool>();
   option.curve_dist_bound = dist_th;
   option.curve_normal_bound = normal_th;
   option.linear_curve = true;
   if (control_cfg["enable_curve"]) {
     option.curve_checker = prism::curve::curve_func_handles(
-        complete_cp, *pc, option, order);
+        complete_cp, pc, option, order);
   }
 
-  auto checker = [&option, &pc](bool enable) {
+  auto checker = [&option, pc = &pc](bool enable) {
     checker_in_main(pc, option, enable);
   };
   auto collapse = [&]() {
     option.relax_quality_threshold = 30;
     checker(serialize_level > 7);
-    int col = prism::local::wildcollapse_pass(*pc, option);
+    int col = prism::local::wildcollapse_pass(pc, option);
     post_collapse(complete_cp);
     checker(serialize_level > 7);
     for (auto i = 0; i < 2; i++) {
       if (!freeze_feature) {
         if (option.use_polyshell)
-          col += prism::local::zig_collapse_pass(*pc, option);
+          col += prism::local::zig_collapse_pass(pc, option);
         else
-          col += prism::local::feature_collapse_pass(*pc, option);
+          col += prism::local::feature_collapse_pass(pc, option);
         post_collapse(complete_cp);
       }
       checker(serialize_level > 7);
-      reverse_feature_order(*pc, option);
+      reverse_feature_order(pc, option);
     }
     checker(serialize_level > 3);
     return col;
@@ -649,17 +778,17 @@ void feature_and_curve(std::string filename, std::string fgname,
     option.relax_quality_threshold = 0;
     if (!freeze_feature) {
       if (option.use_polyshell) {
-        prism::local::zig_slide_pass(*pc, option);
+        prism::local::zig_slide_pass(pc, option);
       } else {
-        prism::local::feature_slide_pass(*pc, option);
+        prism::local::feature_slide_pass(pc, option);
       }
     }
     checker(serialize_level > 7);
-    prism::local::localsmooth_pass(*pc, option);
+    prism::local::localsmooth_pass(pc, option);
     checker(serialize_level > 7);
-    prism::local::wildflip_pass(*pc, option);
+    prism::local::wildflip_pass(pc, option);
     checker(serialize_level > 7);
-    prism::curve::localcurve_pass(*pc, option);
+    prism::curve::localcurve_pass(pc, option);
     checker(serialize_level > 3);
   };
   auto refine = [&](auto q) {
@@ -670,18 +799,18 @@ void feature_and_curve(std::string filename, std::string fgname,
       // try to refine towards target length if quality not destroy
       option.relax_quality_threshold = 30;
       // double ael = igl::avg_edge_length(
-      // Eigen::Map<RowMatd>(pc->mid[0].data(), pc->mid.size(), 3),
-      // Eigen::Map<RowMati>(pc->F[0].data(), pc->F.size(), 3));
+      // Eigen::Map<RowMatd>(pc.mid[0].data(), pc.mid.size(), 3),
+      // Eigen::Map<RowMati>(pc.F[0].data(), pc.F.size(), 3));
       option.sizing_field = [target_edge_length](auto &) {
         return target_edge_length;
       };
     }
-    auto spl = prism::local::wildsplit_pass(*pc, option);
+    auto spl = prism::local::wildsplit_pass(pc, option);
     if (!freeze_feature) {
       if (option.use_polyshell)
-        spl += prism::local::zig_split_pass(*pc, option);
+        spl += prism::local::zig_split_pass(pc, option);
       else
-        spl += prism::local::feature_split_pass(*pc, option);
+        spl += prism::local::feature_split_pass(pc, option);
     }
     checker(serialize_level > 4);
     option.sizing_field = [target_edge_length](auto &) {
@@ -694,6 +823,7 @@ void feature_and_curve(std::string filename, std::string fgname,
   option.sizing_field = [target_edge_length](auto &) {
     return target_edge_length;
   };
+  progress("collapse", 0.);
   for (int collapse_iteration = 0; collapse_iteration < 10;
        collapse_iteration++) {
     if (control_cfg["skip_collapse"]) break;
@@ -704,11 +834,13 @@ void feature_and_curve(std::string filename, std::string fgname,
     refine(true);
     relax();
     if (col == 0) break;
-    reverse_feature_order(*pc, option);
+    reverse_feature_order(pc, option);
     if (serialize_level > 4)
-      pc->serialize(fmt::format("{}_col{}.h5", ser_file, collapse_iteration),
-                    prism::curve::save_cp(complete_cp));
+      pc.serialize(fmt::format("{}_col{}.h5", ser_file, collapse_iteration),
+                   prism::curve::save_cp(complete_cp));
+    progress("collapse", (collapse_iteration + 1) / 10.);
   }
+  progress("collapse", 1.);
 
   spdlog::info("========Done with Collapse. Try Split Now.======");
   option.sizing_field = [target_edge_length](auto &) {
@@ -716,6 +848,7 @@ void feature_and_curve(std::string filename, std::string fgname,
   };
 
   // Start split schedule.
+  progress("split", 0.);
   for (int split_iteration = 0; split_iteration < 10; split_iteration++) {
     if (control_cfg["skip_split"]) break;
     auto spl = refine(split_iteration > 4);
@@ -724,25 +857,192 @@ void feature_and_curve(std::string filename, std::string fgname,
       relax();
       collapse();
       relax();
-      reverse_feature_order(*pc, option);
+      reverse_feature_order(pc, option);
       if (serialize_level > 8)
-        pc->serialize(fmt::format("{}_spl{}_imp{}.h5", ser_file,
-                                  split_iteration, inside_improve_iteration),
-                      prism::curve::save_cp(complete_cp));
+        pc.serialize(fmt::format("{}_spl{}_imp{}.h5", ser_file,
+                                 split_iteration, inside_improve_iteration),
+                     prism::curve::save_cp(complete_cp));
     }
     if (spl == 0) break;
     if (serialize_level > 4)
-      pc->serialize(fmt::format("{}_spl{}.h5", ser_file, split_iteration),
-                    prism::curve::save_cp(complete_cp));
+      pc.serialize(fmt::format("{}_spl{}.h5", ser_file, split_iteration),
+                   prism::curve::save_cp(complete_cp));
+    progress("split", (split_iteration + 1) / 10.);
   }
+  progress("split", 1.);
+}
+
+#include <igl/parallel_for.h>
+std::vector<std::pair<RowMatd, RowMati>> section_stage(
+    const PrismCage &pc, const std::vector<double> &edge_lengths,
+    nlohmann::json config) {
+  auto shell_cf = config["shell"];
+  auto section_cf = config["section"];
+  RowMatd mV;
+  RowMati mF;
+  vec2eigen(pc.base, mV);
+  vec2eigen(pc.F, mF);
+  auto base_ptr =
+      prism::geogram::shared_aabb(mV, mF, pc.ref.aabb->num_freeze);
+  vec2eigen(pc.top, mV);
+  auto top_ptr = prism::geogram::shared_aabb(mV, mF, pc.ref.aabb->num_freeze);
+  auto &base_tree = *base_ptr, &top_tree = *top_ptr;
+
+  std::vector<std::pair<RowMatd, RowMati>> results(edge_lengths.size());
+  igl::parallel_for(
+      edge_lengths.size(),
+      [&](int i) {
+        prism::section::RemeshOptions option(pc.mid.size(), edge_lengths[i]);
+        option.distortion_bound = shell_cf["distortion_bound"].get<double>();
+        option.iteration_number = section_cf["iterations"].get<int>();
+        option.smooth_per_iteration =
+            section_cf["smooth_per_iteration"].get<int>();
+        option.parallel = edge_lengths.size() == 1;  // no nested threads.
+
+        auto V = pc.mid;
+        auto F = pc.F;
+        std::vector<std::set<int>> track_to_prism(F.size());
+        for (auto f = 0; f < F.size(); f++) track_to_prism[f] = {f};
+        std::vector<double> target_adjustment(V.size(), 1.);
+        for (auto it = 0; it < option.iteration_number; it++) {
+          prism::section::wildcollapse_pass(pc, base_tree, top_tree, option, V,
+                                            F, track_to_prism,
+                                            target_adjustment);
+          prism::section::wildsplit_pass(pc, base_tree, top_tree, option, V, F,
+                                         track_to_prism, target_adjustment);
+          prism::section::wildflip_pass(pc, base_tree, top_tree, option, V, F,
+                                        track_to_prism);
+          for (auto s = 0; s < option.smooth_per_iteration; s++)
+            prism::section::localsmooth_pass(pc, base_tree, top_tree, option,
+                                             V, F, track_to_prism);
+        }
+        spdlog::info("Section {}: V={} F={}", edge_lengths[i], V.size(),
+                     F.size());
+        vec2eigen(V, results[i].first);
+        vec2eigen(F, results[i].second);
+      },
+      size_t(1));
+  return results;
+}
+
+void section_from_checkpoint(std::string filename,
+                             std::vector<double> edge_lengths,
+                             std::string ser_file, nlohmann::json config) {
+  auto ext = std::filesystem::path(filename).extension();
+  if (ext != ".init" && ext != ".h5")
+    throw std::runtime_error("Section remeshing needs a shell checkpoint.");
+  PrismCage pc(filename);
+  auto sections = section_stage(pc, edge_lengths, config);
+  for (auto i = 0; i < sections.size(); i++)
+    igl::write_triangle_mesh(fmt::format("{}_sec{}.obj", ser_file, i),
+                             sections[i].first, sections[i].second);
+}
+
+////////////////////////
+//// This is the main entry point for the curve mesh generation program.
+//// @Params:
+//// Mesh path. igl reader, supports obj, stl, off, ply
+//// feature (incl. constraint points) path: h5 file.
+//// Serialization path: h5 file
+//// Config JSON
+////////////////////////
+void feature_and_curve(std::string filename, std::string fgname,
+                       std::string ser_file, nlohmann::json config) {
+  // Options
+  auto featr_cf = config["feature"];
+  auto control_cfg = config["control"];
+  auto dihedral_threshold = featr_cf["dihedral_threshold"].get<double>();
+
+  auto parse_feature_file = [&](const auto &V, const auto &F,
+                                std::string fgname) {
+    RowMati feature_edges;
+    Eigen::VectorXi feature_corners;
+    Eigen::VectorXi points_fid;
+    RowMatd points_bc;
+    if (fgname == "") {  // no feature file, use threshold mark.
+      spdlog::info("Use dihedral threshold {} to mark features",
+                   dihedral_threshold);
+      prism::mark_feature_edges(V, F, dihedral_threshold, feature_edges);
+    } else {
+      auto ext = std::filesystem::path(fgname).extension();
+      if (ext == ".fgraph") {
+        prism::read_feature_graph(fgname, feature_corners, feature_edges);
+      } else if (ext == ".h5") {
+        prism::read_feature_h5(fgname, feature_corners, feature_edges,
+                               points_fid, points_bc);
+      }
+      spdlog::info("Parse Feature N {} E {} Constraint Points {}",
+                   feature_corners.size(), feature_edges.rows(),
+                   points_fid.size());
+    }
+    return std::tuple(feature_corners, feature_edges, points_fid, points_bc);
+  };
+  ///////
+  auto pc = std::unique_ptr<PrismCage>(nullptr);
+  auto complete_cp = std::vector<RowMatd>();
+  auto ext = std::filesystem::path(filename).extension();
+  if (ext == ".init" || ext == ".h5") {  // loading.
+    pc.reset(new PrismCage(filename));
+    if (ext == ".h5") {
+      if (!control_cfg["reset_cp"] && control_cfg["enable_curve"])
+        complete_cp = prism::curve::load_cp(filename);
+    }
+  }
+
+  if (pc == nullptr) {  // initialize shell.
+    RowMatd V;
+    RowMati F;
+    {
+      igl::read_triangle_mesh(filename, V, F);
+      if (fgname == "") {  // no feature, stl file TODO: branch can be merged,
+                           // subject to futher feature cleaning.
+        Eigen::VectorXi SVI, SVJ;
+        RowMatd temp_V = V;  // for STL file
+        igl::remove_duplicate_vertices(temp_V, 0, V, SVI, SVJ);
+        for (int i = 0; i < F.rows(); i++)
+          for (int j : {0, 1, 2}) F(i, j) = SVJ[F(i, j)];
+      }
+
+      spdlog::info("V={}, F={}", V.rows(), F.rows());
+      put_in_unit_box(V);
+      if (preconditions(V, F, filename, !control_cfg["danger_relax_precondition"]) ==false) return;
+    }
+    RowMati feature_edges;
+    Eigen::VectorXi feature_corners;
+    Eigen::VectorXi points_fid;
+    RowMatd points_bc;
+    std::tie(feature_corners, feature_edges, points_fid, points_bc) =
+        parse_feature_file(V, F, fgname);
+    pc = shell_initialize(V, F, feature_edges, feature_corners, points_fid,
+                          points_bc, config);
+    if (pc == nullptr) return;
+    config["control"]["reset_cp"] = true;
+    spdlog::info("=====Initial Good. Saving.", ser_file);
+    pc->serialize(ser_file + ".init");
+  }
+  if (control_cfg["only_initial"]) return;
+
+  PipelineProgress progress;
+  shell_schedule(*pc, complete_cp, config, ser_file, progress);
   spdlog::info("========Finalize: Save.======");
   pc->serialize(ser_file, prism::curve::save_cp(complete_cp));
+  if (control_cfg["surface_only"]) {
+    RowMatd nodes;
+    RowMati cells;
+    if (surface_stage(*pc, complete_cp, nodes, cells))
+      write_lagrange_triangles_msh(ser_file + ".msh", nodes, cells);
+    return;
+  }
   if (control_cfg["skip_volume"]) return;
   checker_inversion(*pc, complete_cp);
   spdlog::info("========Vol Stage======");
 
+  RowMatd nodes;
+  RowMati p4T;
+  volume_stage(*pc, complete_cp, config, nodes, p4T, progress);
+  if (p4T.size() == 0) return;
   config["cutet"]["output_file"] = ser_file;
-  volume_stage(*pc, complete_cp, config);
+  cutet_optim(nodes, p4T, config["cutet"], progress);
 }
 
 /*
@@ -0,0 +1,119 @@
+#ifndef PRISM_PIPELINE_SCHEDULES_HPP
+#define PRISM_PIPELINE_SCHEDULES_HPP
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <prism/common.hpp>
+#include <stdexcept>
+#include <string>
+
+struct PrismCage;
+
+////////////////////////
+//// Progress report shared by the stages. The callback receives the stage
+//// name and a fraction in [0,1], and returns false to request cancellation,
+//// in which case the stage throws `PipelineCancelled` at its next
+//// checkpoint. Calls are rate limited to one every `min_interval` seconds,
+//// except for the start and the end of a stage.
+////////////////////////
+struct PipelineCancelled : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+struct PipelineProgress {
+  using callback_t = std::function<bool(const std::string &, double)>;
+  PipelineProgress(callback_t cb = nullptr, double min_interval = 0.5)
+      : callback(std::move(cb)), min_interval(min_interval) {}
+
+  void operator()(const std::string &stage, double fraction) {
+    if (!callback) return;
+    auto now = std::chrono::steady_clock::now();
+    if (fraction > 0 && fraction < 1 && last_report.has_value() &&
+        std::chrono::duration<double>(now - *last_report).count() <
+            min_interval)
+      return;
+    last_report = now;
+    if (!callback(stage, fraction))
+      throw PipelineCancelled("Pipeline cancelled at " + stage);
+  }
+
+  callback_t callback;
+  double min_interval;
+  std::optional<std::chrono::steady_clock::time_point> last_report;
+};
+
+// The option groups (curve, shell, feature, control, tetfill, cutet), which
+// are also the command line options through `dict_to_option`.
+nlohmann::json default_pipeline_config();
+
+bool preconditions(const RowMatd &V, const RowMati &F,
+                   const std::string &filename, bool shortcircuit = true);
+
+// pre-split features, reassign constraint points and construct the shell.
+// The input is expected to pass `preconditions`. Returns nullptr if the
+// features are not valid.
+std::unique_ptr<PrismCage> shell_initialize(
+    RowMatd V, RowMati F, RowMati feature_edges,
+    Eigen::VectorXi feature_corners, Eigen::VectorXi points_fid,
+    RowMatd points_bc, nlohmann::json config);
+
+// collapse/split schedule with curving on the shell. `complete_cp` is updated
+// in place. Intermediate checkpoints are written with prefix `ser_file`
+// according to `serialize_level`, none if it is empty.
+void shell_schedule(PrismCage &pc, std::vector<RowMatd> &complete_cp,
+                    nlohmann::json config, const std::string &ser_file,
+                    PipelineProgress &progress);
+
+// certify the curved shell with `elevated_positive`, and convert the surface
+// control points to Lagrange triangles of the same order, with shared nodes and
+// gmsh node ordering. Returns false if the certification fails.
+bool surface_stage(const PrismCage &pc,
+                   const std::vector<RowMatd> &complete_cp, RowMatd &nodes,
+                   RowMati &cells);
+
+// ASCII gmsh 2.2, triangles up to order 5.
+void write_lagrange_triangles_msh(const std::string &filename,
+                                  const RowMatd &nodes, const RowMati &cells);
+
+// Only fill the core bounded by the shell base (with the inward extrusion
+// `ext_base` as the guiding layer), since the shell layer is stitched from its
+// own prism decomposition. The inside tets are kept and the vertices reordered
+// as [shell_base, interior], as expected by `stitch_surface_to_volume`.
+// Returns false if the boundary of the fill is not exactly `F_sh`.
+bool tetshell_fill_core(const RowMatd &ext_base, const RowMatd &shell_base,
+                        const RowMati &F_sh, Eigen::MatrixXd &V_out,
+                        Eigen::MatrixXi &T_out);
+
+// fill the volume in- and outside of the shell, and stitch the curved surface
+// to produce high order tetrahedra.
+void volume_stage(PrismCage &pc, std::vector<RowMatd> &complete_cp,
+                  nlohmann::json config, RowMatd &nodes, RowMati &p4T,
+                  PipelineProgress &progress);
+
+// optimize the high order tetrahedra. The result is written to
+// `config["output_file"]` if it is set.
+void cutet_optim(RowMatd &lagr, RowMati &p4T, nlohmann::json config,
+                 PipelineProgress &progress);
+
+// remesh the mid surface inside a finished shell to each of the target edge
+// lengths with the `prism::section` passes, leaving the shell untouched. The
+// resolutions are independent and run concurrently, sharing the shell, the
+// reference and the base/top trees.
+std::vector<std::pair<RowMatd, RowMati>> section_stage(
+    const PrismCage &pc, const std::vector<double> &edge_lengths,
+    nlohmann::json config);
+
+// load a shell checkpoint (.init or .h5) and write `{ser_file}_sec{i}.obj` for
+// the i-th edge length.
+void section_from_checkpoint(std::string filename,
+                             std::vector<double> edge_lengths,
+                             std::string ser_file, nlohmann::json config);
+
+// The command line entry, from files to files.
+void feature_and_curve(std::string filename, std::string fgname,
+                       std::string ser_file, nlohmann::json config);
+
+#endif
@@ -13,6 +13,7 @@
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <highfive/H5Easy.hpp>
 #include <prism/geogram/geogram_utils.hpp>
@@ -195,9 +196,8 @@ PrismCage::PrismCage(const RowMatd &vert, const RowMati &face,
     if (mt[1] < num_cons || mt[2] < num_cons) throw std::runtime_error("only one vertex in each triangle can be singular.");
   }
 
-  ref.aabb.reset(
-      new prism::geogram::AABB(ref.V, ref.F, st == SeparateType::kSurface));
-  ref.aabb->num_freeze = num_cons;
+  ref.aabb = prism::geogram::shared_aabb(ref.V, ref.F, num_cons,
+                                         st == SeparateType::kSurface);
 
   RowMatd inner, outer;
   prism::cage_utils::extrude_for_base_and_top(
@@ -274,7 +274,13 @@ PrismCage::PrismCage(const RowMatd &vert, const RowMati &face,
 
 auto serialize_meta_edges = [](auto &meta_edges) {
   std::vector<int> flat, ind;
-  for (auto [m, data] : meta_edges) {
+  // sorted by edge, so the file does not depend on the insertion history.
+  std::vector<const prism::MetaEdges::value_type *> sorted;
+  for (auto &m : meta_edges) sorted.push_back(&m);
+  std::sort(sorted.begin(), sorted.end(),
+            [](auto a, auto b) { return a->first < b->first; });
+  for (auto p : sorted) {
+    auto &[m, data] = *p;
     ind.push_back(flat.size());
     flat.push_back(m.first);
     flat.push_back(m.second);
@@ -287,7 +293,7 @@ auto serialize_meta_edges = [](auto &meta_edges) {
 };
 
 auto deserialize_meta_edges = [](auto &flat, auto &ind) {
-  std::map<std::pair<int, int>, std::pair<int, std::vector<int>>> meta;
+  prism::MetaEdges meta;
   auto prev = 0;
   auto begin = flat.begin();
   for (auto cur : ind) {
@@ -391,14 +397,15 @@ void PrismCage::load_from_hdf5(std::string filename) {
   eigen2vec(mF, F);
 
   // after
-  ref.aabb = std::make_unique<prism::geogram::AABB>(
-      ref.V, ref.F, st == SeparateType::kSurface);
+  int num_freeze = 0;
   for (int i = 0; i < mid.size(); i++) {
     if (base[i] != top[i]) {
-      ref.aabb->num_freeze = i;
+      num_freeze = i;
       break;
     }
   }
+  ref.aabb = prism::geogram::shared_aabb(ref.V, ref.F, num_freeze,
+                                         st == SeparateType::kSurface);
   spdlog::info("AABB {}, SeparateType {}",
                ref.aabb->enabled ? "enabled" : "disabled",
                st == SeparateType::kSurface
@@ -481,7 +488,7 @@ void PrismCage::cleanup_empty_faces(Eigen::VectorXi &NI, Eigen::VectorXi &NJ) {
 
   auto &vid_map = NI;
   // feature meta edges
-  std::map<std::pair<int, int>, std::pair<int, std::vector<int>>> new_metas;
+  meta_type_t new_metas;
   for (auto m : meta_edges) {
     auto [u0, u1] = m.first;
     new_metas[{vid_map[u0], vid_map[u1]}] = m.second;
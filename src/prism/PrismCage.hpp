@@ -10,6 +10,7 @@
 #include <mutex>
 
 #include "common.hpp"
+#include "meta_edges.hpp"
 
 namespace prism::geogram {
 struct AABB;
@@ -29,7 +30,7 @@ struct PrismCage {
     RowMatd V;
     RowMati F;
     std::vector<std::vector<int>> VF, VFi;
-    std::unique_ptr<prism::geogram::AABB> aabb;
+    std::shared_ptr<const prism::geogram::AABB> aabb;
   };
   RefSurf ref;
 
@@ -55,7 +56,7 @@ struct PrismCage {
 
   // marked feature edges.
   // a map from endpoints to chain id and list of vertices. As a feature representation.
-  using meta_type_t = std::map<std::pair<int, int>, std::pair<int, std::vector<int>>>;
+  using meta_type_t = prism::MetaEdges;
   meta_type_t meta_edges;
 
   // specified constraint points (for distance bound) on each face.
@@ -283,24 +283,27 @@ bool prism::cage_check::cage_is_positive(const PrismCage &pc) {
   return true;
 }
 bool prism::cage_check::cage_is_away_from_ref(const PrismCage &pc) {
-  auto aabb = std::optional<prism::geogram::AABB>();
-  aabb.emplace(pc.ref.V, pc.ref.F);
   auto num_freeze = pc.ref.aabb->num_freeze;
-  aabb->num_freeze = num_freeze;
+  // the reference tree is only enabled for kSurface.
+  auto aabb = pc.ref.aabb->enabled ? pc.ref.aabb
+                                   : prism::geogram::shared_aabb(
+                                         pc.ref.V, pc.ref.F, num_freeze);
 
+  std::vector<std::array<Vec3d, 3>> queries;
+  std::vector<bool> freeze;
   for (auto [v0, v1, v2] : pc.F) {
     // singular edge does not exist. Bevel always split it aggressively.
     assert(!(v1 < num_freeze && v2 < num_freeze));
-    if (aabb->intersects_triangle({pc.base[v0], pc.base[v1], pc.base[v2]},
-                                  v0 < num_freeze)) {
-      spdlog::error("Intersect Base [{}, {}, {}]", v0, v1, v2);
-      return false;
-    }
-    if (aabb->intersects_triangle({pc.top[v0], pc.top[v1], pc.top[v2]},
-                                  v0 < num_freeze)) {
-      spdlog::error("Intersect Top [{}, {}, {}]", v0, v1, v2);
-      return false;
-    }
+    queries.push_back({pc.base[v0], pc.base[v1], pc.base[v2]});
+    queries.push_back({pc.top[v0], pc.top[v1], pc.top[v2]});
+    freeze.insert(freeze.end(), 2, v0 < num_freeze);
+  }
+  auto hits = aabb->intersects_triangles(queries, freeze, true);
+  if (!hits.empty()) {
+    auto [v0, v1, v2] = pc.F[hits.front() / 2];
+    spdlog::error("Intersect {} [{}, {}, {}]",
+                  hits.front() % 2 == 0 ? "Base" : "Top", v0, v1, v2);
+    return false;
   }
   return true;
 }
@@ -624,6 +624,7 @@ void prism::cage_utils::mark_singular_on_border(const RowMatd &mV,
 }
 
 
+#include <igl/parallel_for.h>
 #include "spatial-hash/AABB_hash.hpp"
 #include "spatial-hash/self_intersection.hpp"
 void prism::cage_utils::hashgrid_shrink(const std::vector<Vec3d> &mid, std::vector<Vec3d> &top,
@@ -636,40 +637,50 @@ void prism::cage_utils::hashgrid_shrink(const std::vector<Vec3d> &mid, std::vect
   prism::cage_utils::tetmesh_from_prismcage(mid, top, vecF, tetV, tetT);
   std::vector<int> affected_faces(vecF.size());
   std::iota(affected_faces.begin(), affected_faces.end(), 0);
+  std::vector<std::pair<Vec3d, Vec3d>> boxes;
   while (!affected_faces.empty()) {
     hg.clear();
-    for (auto f : affected_faces)
-      for (int j = 0; j < 3; j++) {
-        auto i = 3 * f + j;
-        Eigen::Matrix<double, 4, 3> local;
-        for (auto k = 0; k < local.rows(); k++) local.row(k) = tetV[tetT[i][k]];
-        auto aabb_min = local.colwise().minCoeff();
-        auto aabb_max = local.colwise().maxCoeff();
-        hg.add_element(aabb_min, aabb_max, i);
-      }
+    boxes.resize(3 * affected_faces.size());
+    igl::parallel_for(
+        boxes.size(),
+        [&](int b) {
+          auto i = 3 * affected_faces[b / 3] + b % 3;
+          Eigen::Matrix<double, 4, 3> local;
+          for (auto k = 0; k < local.rows(); k++) local.row(k) = tetV[tetT[i][k]];
+          boxes[b] = {local.colwise().minCoeff(), local.colwise().maxCoeff()};
+        },
+        size_t(1000));
+    for (auto b = 0; b < boxes.size(); b++)
+      hg.add_element(boxes[b].first, boxes[b].second,
+                     3 * affected_faces[b / 3] + b % 3);
     auto cand = hg.self_candidates();
     spdlog::debug("cand {}", cand.size());
-    std::set<std::pair<int, int>> offend_pairs;
-    auto offend_handle = prism::spatial_hash::find_offending_pairs(
-        vecF, tetV, tetT, offend_pairs);
-    std::for_each(cand.begin(), cand.end(), offend_handle);
+    auto offend_pairs =
+        prism::spatial_hash::offending_pairs(vecF, tetV, tetT, cand);
     spdlog::debug("offending pairs {}", offend_pairs.size());
 
-    std::set<int> masked_verts;
+    std::vector<int> masked_verts;
     for (auto [f0, f1] : offend_pairs) {
       for (auto j = 0; j < 3; j++) {
-        masked_verts.insert(vecF[f0][j]);
-        masked_verts.insert(vecF[f1][j]);
+        masked_verts.push_back(vecF[f0][j]);
+        masked_verts.push_back(vecF[f1][j]);
       }
     }
+    std::sort(masked_verts.begin(), masked_verts.end());
+    masked_verts.erase(std::unique(masked_verts.begin(), masked_verts.end()),
+                       masked_verts.end());
     spdlog::debug("masked_verts {}", masked_verts.size());
 
-    int vnum = mid.size();
+    igl::parallel_for(
+        masked_verts.size(),
+        [&](int i) {
+          auto v = masked_verts[i];
+          tetV[vnum + v] = (tetV[vnum + v] + 3 * tetV[v]) / 4;
+        },
+        size_t(1000));
     affected_faces.clear();
-    for (auto v : masked_verts) {
-      tetV[vnum + v] = (tetV[vnum + v] + 3 * tetV[v]) / 4;
+    for (auto v : masked_verts)
       affected_faces.insert(affected_faces.end(), VF[v].begin(), VF[v].end());
-    }
     std::sort(affected_faces.begin(), affected_faces.end());
     affected_faces.erase(
         std::unique(affected_faces.begin(), affected_faces.end()),
@@ -698,17 +709,25 @@ bool prism::cage_utils::safe_shrink(const std::vector<Vec3d> &mid,
     tree.self_intersections(pairs);
     spdlog::info("pairs {}", pairs.size());
     if (pairs.empty()) break;
-    std::set<int> masked_verts;
+    std::vector<int> masked_verts;
     for (auto [f0, f1] : pairs) {
       for (auto j = 0; j < 3; j++) {
-        masked_verts.insert(vecF[f0][j]);
-        masked_verts.insert(vecF[f1][j]);
+        masked_verts.push_back(vecF[f0][j]);
+        masked_verts.push_back(vecF[f1][j]);
       }
     }
-    for (auto v : masked_verts) {
-      if ((mT.row(v) - mid[v]).norm() < 1e-10) continue; // taken care by precondition
-      mT.row(v) = (mT.row(v) + mid[v]) / 2;
-    }
+    std::sort(masked_verts.begin(), masked_verts.end());
+    masked_verts.erase(std::unique(masked_verts.begin(), masked_verts.end()),
+                       masked_verts.end());
+    igl::parallel_for(
+        masked_verts.size(),
+        [&](int i) {
+          auto v = masked_verts[i];
+          if ((mT.row(v) - mid[v]).norm() < 1e-10)
+            return;  // taken care by precondition
+          mT.row(v) = (mT.row(v) + mid[v]) / 2;
+        },
+        size_t(1000));
   }
   eigen2vec(mT,top);
 
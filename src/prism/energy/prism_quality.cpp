@@ -136,6 +136,57 @@ DScalar prism_full_quality(const std::array<Vec3d, 6>& corners, const Eigen::Row
   return quality;
 }
 
+// Closed form of the above. Each tet jacobian is affine in the free corner p,
+// J = A + diag(s) p g^T with g the corner column of the gradient operator.
+// With u = s.*dp, K = J^-1, w = K^T g and z = K^T K w,
+//   |J|^2:    grad 2Jg,  hess 2|g|^2 I
+//   |K|^2:    grad -2z,  hess 2|w|^2 K^T K + 2(wz^T + zw^T)
+std::tuple<double, Vec3d, Eigen::Matrix3d> prism_quality_derivatives(
+    const std::array<Vec3d, 6>& corners, const Eigen::RowVector3d& dimscale,
+    QualityType qt, int id_with_grad) {
+  auto cornersMat = Eigen::Map<const RowMatd>(corners[0].data(), 6, 3);
+  Eigen::Matrix<double, 36, 3, Eigen::RowMajor> jacobian =
+      POSITIVE_TETRA_GRAD * cornersMat;
+  double value = 0;
+  Eigen::Vector3d grad = Eigen::Vector3d::Zero();
+  Eigen::Matrix3d hess = Eigen::Matrix3d::Zero();
+  for (int i = 0; i < 12; i++) {
+    Eigen::Matrix3d jac =
+        dimscale.asDiagonal() * Eigen::Map<Eigen::Matrix3d>(jacobian.data() + 9 * i);
+    Eigen::Vector3d g =
+        POSITIVE_TETRA_GRAD.block<3, 1>(3 * i, id_with_grad);
+    Eigen::Matrix3d K = jac.inverse();
+    Eigen::Matrix3d KtK = K.transpose() * K;
+    Eigen::Vector3d w = K.transpose() * g;
+    Eigen::Vector3d z = KtK * w;
+
+    auto frob2 = jac.cwiseAbs2().sum();
+    auto invf2 = K.cwiseAbs2().sum();
+    Eigen::Vector3d frob2_grad = 2 * jac * g;
+    Eigen::Vector3d invf2_grad = -2 * z;
+    Eigen::Matrix3d frob2_hess =
+        2 * g.squaredNorm() * Eigen::Matrix3d::Identity();
+    Eigen::Matrix3d invf2_hess =
+        2 * w.squaredNorm() * KtK + 2 * (w * z.transpose() + z * w.transpose());
+    if (qt == QualityType::SYMMETRIC_DIRICHLET) {
+      value += frob2 + invf2;
+      grad += frob2_grad + invf2_grad;
+      hess += frob2_hess + invf2_hess;
+    } else if (qt == QualityType::MIPS_3D) {
+      value += frob2 * invf2;
+      grad += invf2 * frob2_grad + frob2 * invf2_grad;
+      hess += invf2 * frob2_hess + frob2 * invf2_hess +
+              frob2_grad * invf2_grad.transpose() +
+              invf2_grad * frob2_grad.transpose();
+    }
+  }
+  value = value / 12 - (qt == QualityType::MIPS_3D ? 9 : 6);
+  Eigen::Vector3d s = dimscale.transpose();
+  grad = grad.cwiseProduct(s) / 12;
+  hess = s.asDiagonal() * hess * s.asDiagonal() / 12;
+  return std::tuple(value, grad.transpose(), hess);
+}
+
 double prism_one_ring_quality(const std::vector<Vec3d>& base,
                               const std::vector<Vec3d>& top,
                               const std::vector<Vec3i>& F,
@@ -206,10 +257,10 @@ std::tuple<double, Vec3d> prism_one_ring_quality(
     if (v_with_grad != -1) {
       int v_id = nbi[index];
       if (!on_base) v_id += 3;
-      auto quality =
-          prism::energy::prism_full_quality(verts,  dimscale, quality_type, v_id);
-      grad += quality.getGradient();
-      value += quality.getValue();
+      auto [q, g, h] = prism::energy::prism_quality_derivatives(
+          verts, dimscale, quality_type, v_id);
+      grad += g;
+      value += q;
     } else {  // no grad needed
       value += prism::energy::prism_full_quality(verts, dimscale, quality_type);
     }
@@ -260,6 +311,35 @@ DScalar triangle_quality(const std::array<Vec3d, 3>& vertices,
   return frob2 / det;
 }
 
+// Same energy as S / (sqrt(3) N), S the sum of squared edge lengths and N the
+// norm of the normal n. For the free corner a opposite to e = c - b,
+// dn = e x da, so grad N = n x e / N and hess N = (|e|^2 I - ee^T - grad N grad N^T) / N.
+std::tuple<double, Vec3d, Eigen::Matrix3d> triangle_quality_derivatives(
+    const std::array<Vec3d, 3>& vertices, int id_with_grad) {
+  const Eigen::Vector3d a = vertices[id_with_grad];
+  const Eigen::Vector3d b = vertices[(id_with_grad + 1) % 3];
+  const Eigen::Vector3d c = vertices[(id_with_grad + 2) % 3];
+  Eigen::Vector3d e = c - b;
+  Eigen::Vector3d n = (b - a).cross(c - a);
+  auto N = n.norm();
+  auto S = (b - a).squaredNorm() + (c - a).squaredNorm() + e.squaredNorm();
+  Eigen::Vector3d S_grad = 2 * (2 * a - b - c);
+  Eigen::Vector3d N_grad = n.cross(e) / N;
+  Eigen::Matrix3d N_hess = (e.squaredNorm() * Eigen::Matrix3d::Identity() -
+                            e * e.transpose() - N_grad * N_grad.transpose()) /
+                           N;
+  const double scale = 1 / sqrt(3);
+  double value = scale * S / N;
+  Eigen::Vector3d grad = scale * (S_grad / N - S * N_grad / (N * N));
+  Eigen::Matrix3d hess =
+      scale * (4 * Eigen::Matrix3d::Identity() / N -
+               (S_grad * N_grad.transpose() + N_grad * S_grad.transpose()) /
+                   (N * N) -
+               S * N_hess / (N * N) +
+               2 * S * N_grad * N_grad.transpose() / (N * N * N));
+  return std::tuple(value, grad.transpose(), hess);
+}
+
 std::tuple<double, Vec3d> triangle_one_ring_quality(
     const std::vector<Vec3d>& mid, const std::vector<Vec3i>& F,
     const std::vector<int>& nb, const std::vector<int>& nbi,
@@ -278,10 +358,10 @@ std::tuple<double, Vec3d> triangle_one_ring_quality(
     verts[nbi[index]] += modification;
 
     if (with_grad) {
-      auto quality = prism::energy::triangle_quality(verts, v_id);
-      grad += quality.getGradient();
-      value += quality.getValue();
-      hess += quality.getHessian();
+      auto [q, g, h] = prism::energy::triangle_quality_derivatives(verts, v_id);
+      grad += g;
+      value += q;
+      hess += h;
     } else {  // no grad needed
       value += prism::energy::triangle_quality(verts);
     }
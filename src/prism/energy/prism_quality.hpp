@@ -18,6 +18,12 @@ DScalar prism_full_quality(const std::array<Vec3d, 6>& corners,
                            const Eigen::RowVector3d& dimscale, QualityType qt,
                            int id_with_grad);
 
+// value, gradient and hessian w.r.t. corners[id_with_grad], in closed form.
+// Agrees with the DScalar version, which is kept as the reference.
+std::tuple<double, Vec3d, Eigen::Matrix3d> prism_quality_derivatives(
+    const std::array<Vec3d, 6>& corners, const Eigen::RowVector3d& dimscale,
+    QualityType qt, int id_with_grad);
+
 double prism_one_ring_quality(const std::vector<Vec3d>& base,
                               const std::vector<Vec3d>& top,
                               const std::vector<Vec3i>& F,
@@ -45,6 +51,8 @@ std::tuple<double /*value*/, Vec3d /*grad*/> prism_one_ring_quality(
 
 DScalar triangle_quality(const std::array<Vec3d, 3>& vertices, int v_with_grad);
 double triangle_quality(const std::array<Vec3d, 3>& vertices);
+std::tuple<double, Vec3d, Eigen::Matrix3d> triangle_quality_derivatives(
+    const std::array<Vec3d, 3>& vertices, int v_with_grad);
 
 std::tuple<double, Vec3d> triangle_one_ring_quality(
     const std::vector<Vec3d>& mid, const std::vector<Vec3i>& F,
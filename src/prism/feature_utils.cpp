@@ -1,5 +1,7 @@
 #include "feature_utils.hpp"
 
+#include <Eigen/Dense>
+#include <igl/parallel_for.h>
 #include <igl/per_face_normals.h>
 #include <igl/triangle_triangle_adjacency.h>
 #include <igl/vertex_triangle_adjacency.h>
@@ -9,6 +11,8 @@
 
 #include <algorithm>
 #include <fstream>
+#include <limits>
+#include <numeric>
 #include <highfive/H5Easy.hpp>
 #include <queue>
 #include <utility>
@@ -410,8 +414,7 @@ void prism::feature_chain_region_segments(
 }
 
 std::vector<std::list<int>> prism::glue_meta_together(
-    const std::map<std::pair<int, int>, std::pair<int, std::vector<int>>>
-        &meta) {
+    const prism::MetaEdges &meta) {
   std::vector<std::vector<std::pair<int, int>>> collect;
   for (auto [m, cid_chain] : meta) {
     auto [v0, v1] = m;
@@ -466,8 +469,7 @@ auto glue_together = [](std::vector<std::pair<int, int>> &vv_groups) {
 };
 
 std::vector<std::list<int>> prism::recover_chains_from_meta_edges(
-    const std::map<std::pair<int, int>, std::pair<int, std::vector<int>>>
-        &meta) {
+    const prism::MetaEdges &meta) {
   std::vector<std::vector<std::pair<int, int>>> collect;
   for (auto [m, cid_chain] : meta) {
     auto [v0, v1] = m;
@@ -497,10 +499,149 @@ std::vector<std::list<int>> prism::recover_chains_from_meta_edges(
   return chains;
 }
 
+namespace {
+using EdgeMarks = Eigen::Matrix<bool, -1, 3, Eigen::RowMajor>;
+
+// splits the faces at the midpoints of the marked edges (marks are made
+// symmetric across FF): 1 marked edge gives 2 children, 2 give 3, 3 give 4.
+// New vertices and children are counted per face and placed with prefix sums,
+// so every face is handled independently. edge_vert is the midpoint of each
+// marked edge, -1 otherwise.
+void split_marked_edges(const RowMatd &V, const RowMati &F, const RowMati &FF,
+                        const RowMati &FFi, EdgeMarks marked, RowMatd &nV,
+                        RowMati &nF, RowMati &edge_vert,
+                        prism::FaceSplit &split) {
+  int nf = F.rows();
+  auto symmetric = marked;
+  igl::parallel_for(
+      nf,
+      [&](int f) {
+        for (auto e = 0; e < 3; e++)
+          if (FF(f, e) != -1 && marked(FF(f, e), FFi(f, e)))
+            symmetric(f, e) = true;
+      },
+      size_t(1000));
+  marked = std::move(symmetric);
+  // the midpoint belongs to the smaller face of the edge.
+  auto owns = [&](int f, int e) {
+    return marked(f, e) && (FF(f, e) == -1 || f < FF(f, e));
+  };
+  std::vector<int> vert_offset(nf + 1, 0), face_offset(nf + 1, 0);
+  igl::parallel_for(
+      nf,
+      [&](int f) {
+        face_offset[f + 1] = 1 + marked.row(f).count();
+        for (auto e = 0; e < 3; e++) vert_offset[f + 1] += owns(f, e);
+      },
+      size_t(1000));
+  std::partial_sum(vert_offset.begin(), vert_offset.end(), vert_offset.begin());
+  std::partial_sum(face_offset.begin(), face_offset.end(), face_offset.begin());
+
+  edge_vert.setConstant(nf, 3, -1);
+  nV.resize(V.rows() + vert_offset.back(), 3);
+  nV.topRows(V.rows()) = V;
+  igl::parallel_for(
+      nf,
+      [&](int f) {
+        int ux = V.rows() + vert_offset[f];
+        for (auto e = 0; e < 3; e++) {
+          if (!owns(f, e)) continue;
+          edge_vert(f, e) = ux;
+          if (FF(f, e) != -1) edge_vert(FF(f, e), FFi(f, e)) = ux;
+          nV.row(ux) = (V.row(F(f, e)) + V.row(F(f, (e + 1) % 3))) / 2;
+          ux++;
+        }
+      },
+      size_t(1000));
+
+  // corners 0-2, then the midpoints of edges 0-2.
+  Eigen::Matrix<double, 6, 3> local_bc;
+  local_bc.topRows(3).setIdentity();
+  for (auto e = 0; e < 3; e++)
+    local_bc.row(3 + e) = (local_bc.row(e) + local_bc.row((e + 1) % 3)) / 2;
+  nF.resize(face_offset.back(), 3);
+  split.offset = face_offset;
+  split.corners.resize(face_offset.back());
+  split.inverses.resize(face_offset.back());
+  igl::parallel_for(
+      nf,
+      [&](int f) {
+        auto c = face_offset[f];
+        std::array<int, 6> vid{F(f, 0),         F(f, 1),         F(f, 2),
+                               edge_vert(f, 0), edge_vert(f, 1), edge_vert(f, 2)};
+        auto emit = [&](int a, int b, int d) {
+          nF.row(c) << vid[a], vid[b], vid[d];
+          split.corners[c] << local_bc.row(a), local_bc.row(b), local_bc.row(d);
+          split.inverses[c] = split.corners[c].inverse();
+          c++;
+        };
+        switch (marked.row(f).count()) {
+          case 0:
+            emit(0, 1, 2);
+            break;
+          case 1: {
+            auto e = 0;
+            while (!marked(f, e)) e++;
+            emit(e, 3 + e, (e + 2) % 3);
+            emit((e + 1) % 3, (e + 2) % 3, 3 + e);
+            break;
+          }
+          case 2: {  // edges j and j+1 meet at s.
+            auto j = 0;
+            while (!(marked(f, j) && marked(f, (j + 1) % 3))) j++;
+            auto s = (j + 1) % 3, k = (j + 2) % 3;
+            emit(3 + j, s, 3 + s);
+            emit(j, 3 + j, 3 + s);
+            emit(j, 3 + s, k);
+            break;
+          }
+          default:
+            emit(0, 3, 5);
+            emit(1, 4, 3);
+            emit(2, 5, 4);
+            emit(3, 4, 5);
+        }
+      },
+      size_t(1000));
+}
+
+void inherit_parent(const prism::FaceSplit &split,
+                    std::vector<int> &face_parent) {
+  std::vector<int> parent(split.offset.back());
+  igl::parallel_for(
+      face_parent.size(),
+      [&](int f) {
+        for (auto c = split.offset[f]; c < split.offset[f + 1]; c++)
+          parent[c] = face_parent[f];
+      },
+      size_t(1000));
+  face_parent = std::move(parent);
+}
+}  // namespace
+
+void prism::remap_points(const FaceSplit &split, Eigen::VectorXi &points_fid,
+                         RowMatd &points_bc) {
+  igl::parallel_for(
+      points_fid.size(),
+      [&](int p) {
+        auto f = points_fid[p];
+        Eigen::RowVector3d bc = points_bc.row(p);
+        auto best = -std::numeric_limits<double>::infinity();
+        for (auto c = split.offset[f]; c < split.offset[f + 1]; c++) {
+          Eigen::RowVector3d child_bc = bc * split.inverses[c];
+          if (child_bc.minCoeff() <= best) continue;
+          best = child_bc.minCoeff();
+          points_fid[p] = c;
+          points_bc.row(p) = child_bc;
+        }
+      },
+      size_t(1000));
+}
+
 std::tuple<RowMatd, RowMati, RowMati> prism::subdivide_feature_triangles(
     const RowMatd &mV, const RowMati &mF, const RowMati &feature_edges,
     const std::vector<std::pair<int, int>> &slice_vv,
-    std::vector<int> &face_parent) {
+    std::vector<int> &face_parent, FaceSplit &split) {
   assert(face_parent.size() == mF.rows());
   // splits
   RowMati FF, FFi;
@@ -513,94 +654,60 @@ std::tuple<RowMatd, RowMati, RowMati> prism::subdivide_feature_triangles(
   for (auto [v0, v1] : slice_vv) {
     auto [f, e] = vv2fe(v0, v1, mF, VF);
     colors[f] = 2;
-    colors[FF(f, e)] = 2;
+    if (FF(f, e) != -1) colors[FF(f, e)] = 2;
   }
 
-  auto feature_fe = RowMati(mF.rows(), 3);
-  feature_fe.setConstant(-1);
-  auto sub_features = std::vector<Eigen::RowVector2i>(feature_edges.rows());
+  std::vector<std::pair<int, int>> feature_fe(feature_edges.rows());
+  igl::parallel_for(
+      feature_edges.rows(),
+      [&](int e) {
+        feature_fe[e] =
+            vv2fe(feature_edges(e, 0), feature_edges(e, 1), mF, VF);
+      },
+      size_t(1000));
   for (auto e = 0; e < feature_edges.rows(); e++) {
-    auto v0 = feature_edges(e, 0), v1 = feature_edges(e, 1);
-    auto [f, j] = vv2fe(v0, v1, mF, VF);
-    if (f == -1) {
+    if (feature_fe[e].first == -1) {
+      auto v0 = feature_edges(e, 0), v1 = feature_edges(e, 1);
       spdlog::warn("fe[e] {}", feature_edges.row(e));
       spdlog::warn("VF {}/{}", VF[v0], VF[v1]);
       spdlog::error("Subdivide Feature Triangles Error");
       exit(1);
     }
-    feature_fe(f, j) = e;
-    sub_features[e] = feature_edges.row(e);
   }
-  RowMati edge_vert = -RowMati::Ones(mF.rows(), 3);
   prism::local::red_green_coloring(mF, FF, colors);
 
-  auto feature_splitter = [&](int f, int e, int va, int vb, int vc) {
-    if (feature_fe(f, e) != -1) {
-      // clear and split.
-      auto ei = feature_fe(f, e);
-      sub_features[ei] << -1, -1;
-      sub_features.emplace_back(va, vb);
-      sub_features.emplace_back(vb, vc);
+  // red faces split all edges, green ones the edge to the red neighbor.
+  EdgeMarks marked = EdgeMarks::Constant(mF.rows(), 3, false);
+  igl::parallel_for(
+      mF.rows(),
+      [&](int f) {
+        if (colors[f] == 2) marked.row(f).setConstant(true);
+        if (colors[f] != 1) return;
+        for (int j = 0; j < 3; j++) {
+          if (FF(f, j) != -1 && colors[FF(f, j)] == 2) {
+            marked(f, j) = true;
+            break;
+          }  // find red neighbor
+        }
+      },
+      size_t(1000));
+  RowMatd V;
+  RowMati F, edge_vert;
+  split_marked_edges(mV, mF, FF, FFi, marked, V, F, edge_vert, split);
+  inherit_parent(split, face_parent);
+
+  auto sub_features = std::vector<Eigen::RowVector2i>();
+  sub_features.reserve(2 * feature_edges.rows());
+  for (auto e = 0; e < feature_edges.rows(); e++) {
+    auto [f, j] = feature_fe[e];
+    auto ux = edge_vert(f, j);
+    if (ux == -1) {
+      sub_features.emplace_back(feature_edges.row(e));
+      continue;
     }
-  };
-  std::vector<Vec3d> V;
-  std::vector<Vec3i> F;
-  eigen2vec(mV, V);
-  eigen2vec(mF, F);
-  for (int i = 0; i < mF.rows(); i++) {  // only deal with green here
-    if (colors[i] != 1) continue;
-    int e = [&colors, &FF](int i) {
-      for (int j = 0; j < 3; j++) {
-        if (FF(i, j) != -1 && colors[FF(i, j)] == 2) {
-          return j;
-        }  // find red neighbor
-      }
-      return -1;
-    }(i);
-    assert(e != -1);
-
-    int ux = V.size();
-    V.push_back((V[F[i][e]] + V[F[i][(e + 1) % 3]]) / 2);
-    edge_vert(i, e) = ux;
-    edge_vert(FF(i, e), FFi(i, e)) = ux;
-    auto v0 = mF(i, e), v1 = mF(i, (e + 1) % 3), v2 = mF(i, (e + 2) % 3);
-    F.emplace_back(Vec3i{v0, ux, v2});
-    F.emplace_back(Vec3i{v1, v2, ux});
-    face_parent.emplace_back(face_parent[i]);
-    face_parent.emplace_back(face_parent[i]);
-    feature_splitter(i, e, v0, ux, v1);
+    sub_features.emplace_back(feature_edges(e, 0), ux);
+    sub_features.emplace_back(ux, feature_edges(e, 1));
   }
-
-  for (int f = 0; f < colors.size(); f++) {
-    if (colors[f] != 2) continue;
-    for (auto e = 0; e < 3; e++) {
-      if (edge_vert(f, e) == -1) {  // un-assigned
-        edge_vert(f, e) = edge_vert(FF(f, e), FFi(f, e)) = V.size();
-        V.push_back((V[mF(f, e)] + V[mF(f, (e + 1) % 3)]) / 2);
-      }
-      feature_splitter(f, e, mF(f, e), edge_vert(f, e), mF(f, (e + 1) % 3));
-    }
-    auto v0 = mF(f, 0), v1 = mF(f, 1), v2 = mF(f, 2);
-    auto e0 = edge_vert(f, 0), e1 = edge_vert(f, 1), e2 = edge_vert(f, 2);
-    F.emplace_back(Vec3i{v0, e0, e2});
-    F.emplace_back(Vec3i{v1, e1, e0});
-    F.emplace_back(Vec3i{v2, e2, e1});
-    F.emplace_back(Vec3i{e0, e1, e2});
-    for (auto ii = 0; ii < 4; ii++) face_parent.emplace_back(face_parent[f]);
-  }  // insert red faces
-
-  for (int f = 0, freal = 0; f < colors.size();
-       f++)               // organize and fill to the front.
-    if (colors[f] > 0) {  // removed
-      F[f] = F.back();
-      F.pop_back();
-      face_parent[f] = face_parent.back();
-      face_parent.pop_back();
-    }
-
-  sub_features.erase(std::remove_if(sub_features.begin(), sub_features.end(),
-                                    [](auto &v) -> bool { return v[0] < 0; }),
-                     sub_features.end());
   std::for_each(sub_features.begin(), sub_features.end(), [](auto &v) {
     if (v[0] > v[1]) std::swap(v[0], v[1]);
   });
@@ -611,48 +718,45 @@ std::tuple<RowMatd, RowMati, RowMati> prism::subdivide_feature_triangles(
   sub_features.erase(std::unique(sub_features.begin(), sub_features.end()),
                      sub_features.end());
 
-  return std::tuple(RowMatd(Eigen::Map<RowMatd>(V[0].data(), V.size(), 3)),
-                    RowMati(Eigen::Map<RowMati>(F[0].data(), F.size(), 3)),
+  return std::tuple(V, F,
                     RowMati(Eigen::Map<RowMati>(sub_features[0].data(),
                                                 sub_features.size(), 2)));
 }
 
-#include <prism/local_operations/local_mesh_edit.hpp>
-#include <prism/local_operations/retain_triangle_adjacency.hpp>
 void prism::split_feature_ears(RowMatd &mV, RowMati &mF,
                                const RowMati &feature_edges,
-                               std::vector<int> &face_parent) {
-  std::vector<Vec3i> F;
-  std::vector<Vec3d> V;
-  eigen2vec(mF, F);
-  eigen2vec(mV, V);
-  auto [FF, FFi] = prism::local::triangle_triangle_adjacency(F);
-
-  std::set<int> verts_on_feat;
+                               std::vector<int> &face_parent,
+                               FaceSplit &split) {
+  RowMati FF, FFi;
+  igl::triangle_triangle_adjacency(mF, FF, FFi);
+
+  std::vector<bool> verts_on_feat(mV.rows(), false);
   std::set<std::pair<int, int>> edges_on_feat;
   for (auto e = 0; e < feature_edges.rows(); e++) {
     auto v0 = feature_edges(e, 0), v1 = feature_edges(e, 1);
     if (v0 > v1) std::swap(v0, v1);
     edges_on_feat.emplace(v0, v1);
-    verts_on_feat.insert(v0);
-    verts_on_feat.insert(v1);
+    verts_on_feat[v0] = true;
+    verts_on_feat[v1] = true;
   }
-  for (auto f = 0; f < F.size(); f++) {
-    for (auto e = 0; e < 3; e++) {
-      auto v0 = F[f][e], v1 = F[f][(e + 1) % 3];
-      if (v0 > v1) std::swap(v0, v1);
-      if (edges_on_feat.find({v0, v1}) != edges_on_feat.end()) continue;
-      if (verts_on_feat.find(v0) != verts_on_feat.end() &&
-          verts_on_feat.find(v1) != verts_on_feat.end()) {
-        prism::edge_split(V.size(), F, FF, FFi, f, e);
-        face_parent.emplace_back(face_parent[f]);
-        face_parent.emplace_back(face_parent[FF[f][e]]);
-        V.push_back((V[v0] + V[v1]) / 2);
-      }
-    }
-  }
-  vec2eigen(F, mF);
-  vec2eigen(V, mV);
+  EdgeMarks marked = EdgeMarks::Constant(mF.rows(), 3, false);
+  igl::parallel_for(
+      mF.rows(),
+      [&](int f) {
+        for (auto e = 0; e < 3; e++) {
+          auto v0 = mF(f, e), v1 = mF(f, (e + 1) % 3);
+          if (v0 > v1) std::swap(v0, v1);
+          if (edges_on_feat.find({v0, v1}) != edges_on_feat.end()) continue;
+          marked(f, e) = verts_on_feat[v0] && verts_on_feat[v1];
+        }
+      },
+      size_t(1000));
+  RowMatd V;
+  RowMati F, edge_vert;
+  split_marked_edges(mV, mF, FF, FFi, marked, V, F, edge_vert, split);
+  inherit_parent(split, face_parent);
+  mV = std::move(V);
+  mF = std::move(F);
 }
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
@@ -705,13 +809,35 @@ bool prism::feature_sanity(const RowMatd &mV, RowMati &mE) {
 #include <igl/avg_edge_length.h>
 
 bool prism::feature_pre_split(RowMatd &V, RowMati &F, RowMati &feature_edges,
-                              double threshold, std::vector<int> &face_parent) {
+                              double threshold, std::vector<int> &face_parent,
+                              Eigen::VectorXi &points_fid, RowMatd &points_bc) {
   // ear split will not change features, by definition.
   assert(face_parent.size() == F.rows());
 
-  prism::split_feature_ears(V, F, feature_edges, face_parent);
+  // the remapped points should stay in place.
+  auto point_positions = [&points_fid, &points_bc](auto &V, auto &F) {
+    RowMatd pos = RowMatd::Zero(points_fid.size(), 3);
+    for (auto p = 0; p < points_fid.size(); p++)
+      for (auto k = 0; k < 3; k++)
+        pos.row(p) += points_bc(p, k) * V.row(F(points_fid[p], k));
+    return pos;
+  };
+  RowMatd points_pos = point_positions(V, F);
+  auto check_points = [&]() {
+    Eigen::VectorXd error =
+        (point_positions(V, F) - points_pos).rowwise().squaredNorm();
+    if (error.size() > 0 && error.maxCoeff() > 1e-5)
+      spdlog::critical("Constraints Points Re-assign.");
+  };
+
+  FaceSplit split;
+  prism::split_feature_ears(V, F, feature_edges, face_parent, split);
+  prism::remap_points(split, points_fid, points_bc);
 
-  if (threshold > 1.) return false;
+  if (threshold > 1.) {
+    check_points();
+    return false;
+  }
   double avg_len = igl::avg_edge_length(V, F);
   spdlog::info("ael {}", avg_len);
   while (true) {
@@ -743,8 +869,10 @@ bool prism::feature_pre_split(RowMatd &V, RowMati &F, RowMati &feature_edges,
     if (slice_cnt == 0) break;
 
     std::tie(V, F, feature_edges) = prism::subdivide_feature_triangles(
-        V, F, feature_edges, slicer, face_parent);
+        V, F, feature_edges, slicer, face_parent, split);
+    prism::remap_points(split, points_fid, points_bc);
   }
+  check_points();
   spdlog::info("ael {}", igl::avg_edge_length(V, F));
   return true;
 }
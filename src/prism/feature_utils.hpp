@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "common.hpp"
+#include "meta_edges.hpp"
 namespace prism {
 
 constexpr auto vv2fe = [](auto &v0, auto &v1, const auto &F, const auto &VF) {
@@ -48,29 +49,41 @@ void feature_chain_region_segments(
     std::vector<std::set<int>> &region_around_chain);
 
 std::vector<std::list<int>> glue_meta_together(
-    const std::map<std::pair<int, int>, std::pair<int, std::vector<int>>>
-        &meta);
+    const prism::MetaEdges &meta);
 std::vector<std::list<int>> recover_chains_from_meta_edges(
-    const std::map<std::pair<int, int>, std::pair<int, std::vector<int>>>
-        &meta);
+    const prism::MetaEdges &meta);
+
+// children of the faces after a split: face f becomes
+// [offset[f], offset[f + 1]), each with the barycentric coordinates of its
+// corners in f (as rows). inverses[c] maps barycentrics in f to the child c.
+struct FaceSplit {
+  std::vector<int> offset;
+  std::vector<Eigen::Matrix3d> corners;
+  std::vector<Eigen::Matrix3d> inverses;
+};
+// carries points given as (face, barycentric) over a split.
+void remap_points(const FaceSplit &split, Eigen::VectorXi &points_fid,
+                  RowMatd &points_bc);
 
 // split triangles according to slice_vv
 // while maintaining feature_edges correctly tagged.
 std::tuple<RowMatd, RowMati, RowMati> subdivide_feature_triangles(
     const RowMatd &mV, const RowMati &mF, const RowMati &feature_edges,
     const std::vector<std::pair<int, int>> &slicer,
-    std::vector<int> &face_parent);
+    std::vector<int> &face_parent, FaceSplit &split);
 
 // split the edges connecting two feature verts but not feature edge.
 void split_feature_ears(RowMatd &mV, RowMati &mF, const RowMati &mE,
-                        std::vector<int> &face_parent);
+                        std::vector<int> &face_parent, FaceSplit &split);
 
 bool feature_sanity(const RowMatd &mV, RowMati &mE);
 
 // this function splits extrmely long feature edges above a threshold
 // to promote the grouping of feature edges, without the need of fractional.
+// Constraint points (face, barycentric) follow the splits.
 bool feature_pre_split(RowMatd &V, RowMati &F, RowMati &feature_edges,
-                       double threshold, std::vector<int> &face_parent);
+                       double threshold, std::vector<int> &face_parent,
+                       Eigen::VectorXi &points_fid, RowMatd &points_bc);
 }  // namespace prism
 
 #endif
\ No newline at end of file
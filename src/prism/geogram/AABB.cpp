@@ -13,26 +13,212 @@
 #include <igl/Hit.h>
 #include <igl/Timer.h>
 #include <igl/boundary_facets.h>
+#include <igl/parallel_for.h>
 #include <spdlog/fmt/bundled/ranges.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
-#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <prism/geogram/geogram_utils.hpp>
 #include <prism/intersections.hpp>
 
 #include "prism/predicates/triangle_triangle_intersection.hpp"
 
+namespace {
+// exposes the implicit tree layout of geogram (node 1 is the root, children of
+// node n are 2n and 2n+1, splitting the facet range at the middle), which is
+// needed to walk several queries at once.
+class PacketFacetsAABB : public GEO::MeshFacetsAABB {
+ public:
+  using Mask = std::uint64_t;
+  static constexpr int kPacket = 64;
+
+  // fills `M` with (V, F), then orders the facets by the Morton code of their
+  // centroids and computes the boxes bottom-up, the subtrees in parallel.
+  // The layout is the one of geogram, so its own queries work unchanged.
+  PacketFacetsAABB(GEO::Mesh &M, const RowMatd &V, const RowMati &F)
+      : GEO::MeshFacetsAABB(placeholder(M), false) {
+    prism::geo::to_geogram_mesh(V, F, M);
+    morton_order();
+    init_bboxes();
+  }
+
+  // `leaf(f, q)` tests facet f against query q, bits in `found` are set and
+  // removed from the active masks further down.
+  template <typename Leaf>
+  void packet_intersect(const GEO::Box *boxes, int num, Mask &found,
+                        bool stop_at_first, Leaf &leaf) const {
+    if (mesh_.facets.nb() == 0) return;
+    Mask active = (num == kPacket) ? ~Mask(0) : ((Mask(1) << num) - 1);
+    recurse(boxes, active, found, stop_at_first, leaf, 1, 0,
+            mesh_.facets.nb());
+  }
+
+ private:
+  // geogram builds its tree in the constructor, give it a single facet.
+  static GEO::Mesh &placeholder(GEO::Mesh &M) {
+    prism::geo::init_geogram();
+    M.clear();
+    M.vertices.create_vertices(3);
+    M.facets.create_triangle(0, 1, 2);
+    return M;
+  }
+
+  static std::uint64_t spread_bits(std::uint64_t x) {
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+  }
+
+  void morton_order() {
+    auto nf = mesh_.facets.nb();
+    if (nf == 0) return;
+    std::vector<GEO::vec3> center(nf);
+    igl::parallel_for(
+        nf,
+        [&](int f) {
+          auto c = mesh_.facets.corners_begin(f);
+          center[f] = (mesh_.vertices.point(mesh_.facet_corners.vertex(c)) +
+                       mesh_.vertices.point(mesh_.facet_corners.vertex(c + 1)) +
+                       mesh_.vertices.point(mesh_.facet_corners.vertex(c + 2))) /
+                      3.;
+        },
+        size_t(1000));
+    GEO::vec3 lo = center[0], hi = center[0];
+    for (auto &p : center)
+      for (auto d = 0; d < 3; d++) {
+        lo[d] = std::min(lo[d], p[d]);
+        hi[d] = std::max(hi[d], p[d]);
+      }
+    auto scale = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+    scale = scale > 0 ? ((1 << 21) - 1) / scale : 0.;
+    std::vector<std::pair<std::uint64_t, GEO::index_t>> keys(nf);
+    igl::parallel_for(
+        nf,
+        [&](int f) {
+          std::uint64_t code = 0;
+          for (auto d = 0; d < 3; d++)
+            code |= spread_bits(std::uint64_t((center[f][d] - lo[d]) * scale))
+                    << d;
+          keys[f] = {code, GEO::index_t(f)};
+        },
+        size_t(1000));
+    std::sort(keys.begin(), keys.end());
+    GEO::vector<GEO::index_t> permutation(nf);
+    for (auto i = 0; i < nf; i++) permutation[i] = keys[i].second;
+    mesh_.facets.permute_elements(permutation);
+  }
+
+  static GEO::index_t max_node(GEO::index_t node, GEO::index_t b,
+                               GEO::index_t e) {
+    if (b + 1 == e) return node;
+    auto m = b + (e - b) / 2;
+    return std::max(max_node(2 * node, b, m), max_node(2 * node + 1, m, e));
+  }
+
+  void facet_bbox(GEO::index_t f, GEO::Box &box) const {
+    auto c = mesh_.facets.corners_begin(f);
+    const auto &p0 = mesh_.vertices.point(mesh_.facet_corners.vertex(c));
+    for (auto d = 0; d < 3; d++) box.xyz_min[d] = box.xyz_max[d] = p0[d];
+    for (auto k = 1; k < 3; k++) {
+      const auto &p = mesh_.vertices.point(mesh_.facet_corners.vertex(c + k));
+      for (auto d = 0; d < 3; d++) {
+        box.xyz_min[d] = std::min(box.xyz_min[d], p[d]);
+        box.xyz_max[d] = std::max(box.xyz_max[d], p[d]);
+      }
+    }
+  }
+
+  void fill_bboxes(GEO::index_t node, GEO::index_t b, GEO::index_t e) {
+    if (b + 1 == e) {
+      facet_bbox(b, bboxes_[node]);
+      return;
+    }
+    auto m = b + (e - b) / 2;
+    fill_bboxes(2 * node, b, m);
+    fill_bboxes(2 * node + 1, m, e);
+    GEO::bbox_union(bboxes_[node], bboxes_[2 * node], bboxes_[2 * node + 1]);
+  }
+
+  void init_bboxes() {
+    constexpr auto kSubtrees = 256;
+    auto nf = mesh_.facets.nb();
+    bboxes_.clear();
+    if (nf == 0) return;
+    bboxes_.resize(max_node(1, 0, nf) + 1);
+    // split the top levels until there are enough subtrees to go around.
+    std::vector<std::array<GEO::index_t, 3>> inner, subtrees{{1, 0, nf}};
+    while (subtrees.size() < kSubtrees) {
+      std::vector<std::array<GEO::index_t, 3>> next;
+      for (auto [n, b, e] : subtrees) {
+        if (b + 1 == e) {
+          next.push_back({n, b, e});
+          continue;
+        }
+        inner.push_back({n, b, e});
+        auto m = b + (e - b) / 2;
+        next.push_back({2 * n, b, m});
+        next.push_back({2 * n + 1, m, e});
+      }
+      if (next.size() == subtrees.size()) break;
+      subtrees = std::move(next);
+    }
+    igl::parallel_for(subtrees.size(), [&](int i) {
+      auto [n, b, e] = subtrees[i];
+      fill_bboxes(n, b, e);
+    });
+    for (auto it = inner.rbegin(); it != inner.rend(); it++) {
+      auto n = (*it)[0];
+      GEO::bbox_union(bboxes_[n], bboxes_[2 * n], bboxes_[2 * n + 1]);
+    }
+  }
+
+  template <typename Leaf>
+  void recurse(const GEO::Box *boxes, Mask active, Mask &found,
+               bool stop_at_first, Leaf &leaf, GEO::index_t node,
+               GEO::index_t b, GEO::index_t e) const {
+    if (stop_at_first && found != 0) return;
+    active &= ~found;
+    Mask overlap = 0;
+    for (Mask m = active; m != 0; m &= m - 1) {
+      auto q = __builtin_ctzll(m);
+      if (GEO::bboxes_overlap(boxes[q], bboxes_[node])) overlap |= Mask(1) << q;
+    }
+    if (overlap == 0) return;
+    if (b + 1 == e) {
+      for (Mask m = overlap; m != 0; m &= m - 1) {
+        auto q = __builtin_ctzll(m);
+        if (leaf(b, q)) {
+          found |= Mask(1) << q;
+          if (stop_at_first) return;
+        }
+      }
+      return;
+    }
+    GEO::index_t m = b + (e - b) / 2;
+    recurse(boxes, overlap, found, stop_at_first, leaf, 2 * node, b, m);
+    recurse(boxes, overlap, found, stop_at_first, leaf, 2 * node + 1, m, e);
+  }
+};
+}  // namespace
+
 prism::geogram::AABB::AABB(const RowMatd &V, const RowMati &F, bool _enabled)
     : enabled(_enabled) {
   if (!enabled) return;
 
   geo_polyhedron_ptr_ = std::make_unique<GEO::Mesh>();
-  prism::geo::to_geogram_mesh(V, F, *geo_polyhedron_ptr_);
   geo_tree_ptr_ =
-      std::make_unique<GEO::MeshFacetsAABB>(*geo_polyhedron_ptr_, true);
+      std::make_unique<PacketFacetsAABB>(*geo_polyhedron_ptr_, V, F);
 
   geo_vertex_ind.resize(V.rows());
   GEO::Attribute<int> original_indices(
@@ -47,6 +233,115 @@ prism::geogram::AABB::AABB(const RowMatd &V, const RowMati &F, bool _enabled)
     geo_face_ind[i] = face_indices[i];
 }
 
+namespace {
+// content hash of a matrix, coefficient by coefficient (FNV-1a steps).
+template <typename Mat>
+void hash_matrix(std::uint64_t &h, const Mat &M) {
+  auto mix = [&h](std::uint64_t x) { h = (h ^ x) * 0x100000001b3ULL; };
+  mix(M.rows());
+  mix(M.cols());
+  for (auto i = 0; i < M.size(); i++) {
+    std::uint64_t x = 0;
+    std::memcpy(&x, M.data() + i, sizeof(typename Mat::Scalar));
+    mix(x);
+  }
+}
+
+// the hash only selects a candidate: confirm against the geogram copy held by
+// the tree (vertices in input order, facets permuted with their corners).
+bool same_content(const prism::geogram::AABB &tree, const RowMatd &V,
+                  const RowMati &F) {
+  auto &M = *tree.geo_polyhedron_ptr_;
+  if (V.cols() != 3 || F.cols() != 3 || M.vertices.nb() != GEO::index_t(V.rows()) ||
+      M.facets.nb() != GEO::index_t(F.rows()))
+    return false;
+  for (GEO::index_t i = 0; i < M.vertices.nb(); i++) {
+    auto &p = M.vertices.point(i);
+    auto v = tree.geo_vertex_ind[i];
+    if (p[0] != V(v, 0) || p[1] != V(v, 1) || p[2] != V(v, 2)) return false;
+  }
+  for (GEO::index_t f = 0; f < M.facets.nb(); f++) {
+    auto i = tree.geo_face_ind[f];
+    for (auto k = 0; k < 3; k++)
+      if (tree.geo_vertex_ind[M.facets.vertex(f, k)] != F(i, k)) return false;
+  }
+  return true;
+}
+}  // namespace
+
+std::shared_ptr<const prism::geogram::AABB> prism::geogram::shared_aabb(
+    const RowMatd &V, const RowMati &F, int num_freeze, bool enabled) {
+  // a disabled tree holds no data and costs nothing to build.
+  if (!enabled) {
+    auto tree = std::make_shared<AABB>(V, F, false);
+    tree->num_freeze = num_freeze;
+    return tree;
+  }
+  std::uint64_t key = 0xcbf29ce484222325ULL;
+  hash_matrix(key, V);
+  hash_matrix(key, F);
+  key = (key ^ std::uint64_t(num_freeze)) * 0x100000001b3ULL;
+
+  // the entries only observe the trees, which own their copy of the data.
+  static std::mutex mutex;
+  static std::unordered_multimap<std::uint64_t, std::weak_ptr<const AABB>>
+      cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = cache.begin(); it != cache.end();)
+    it = it->second.expired() ? cache.erase(it) : std::next(it);
+  auto [b, e] = cache.equal_range(key);
+  for (auto it = b; it != e; it++) {
+    auto tree = it->second.lock();
+    if (tree && tree->num_freeze == num_freeze && same_content(*tree, V, F))
+      return tree;
+  }
+  auto tree = std::make_shared<AABB>(V, F, enabled);
+  tree->num_freeze = num_freeze;
+  cache.emplace(key, tree);
+  spdlog::debug("shared_aabb: built {}/{}, {} alive", V.rows(), F.rows(),
+                cache.size());
+  return tree;
+}
+
+bool prism::geogram::AABB::facet_intersects_triangle(
+    unsigned int f, const std::array<Vec3d, 3> &P, bool use_freeze) const {
+  using namespace GEO;
+  auto &pp = geo_polyhedron_ptr_;
+  auto &ind = geo_vertex_ind;
+  index_t c = pp->facets.corners_begin(f);
+  auto i0 = pp->facet_corners.vertex(c), i1 = pp->facet_corners.vertex(c + 1),
+       i2 = pp->facet_corners.vertex(c + 2);
+  assert(ind[i0] < ind[i1] && ind[i0] < ind[i2]);
+  const vec3 &v0 = Geom::mesh_vertex(*pp, i0);
+  const vec3 &v1 = Geom::mesh_vertex(*pp, i1);
+  const vec3 &v2 = Geom::mesh_vertex(*pp, i2);
+  Vec3d kv0(v0.x, v0.y, v0.z);
+  Vec3d kv1(v1.x, v1.y, v1.z);
+  Vec3d kv2(v2.x, v2.y, v2.z);
+  if (use_freeze && ind[i0] < num_freeze) {  // triangle vs segment
+    auto &kp0 = P[0];
+    if (kv1 == kp0) std::swap(kv1, kv0);
+    if (kv2 == kp0) std::swap(kv2, kv0);
+    if (kv0 == kp0) {  // floating point should be exact here.
+      std::array<Vec3d, 2> ks{kv1, kv2};
+      std::array<Vec3d, 3> kt{kv0, kv1, kv2};
+      std::array<Vec3d, 2> ks1{P[1], P[2]};
+
+      spdlog::trace("testing {} {} {}", ind[i0], ind[i1], ind[i2]);
+
+      return prism::predicates::segment_triangle_overlap(ks, P) ||
+             prism::predicates::segment_triangle_overlap(ks1, kt);
+    }  // otherwise, a different singularity is at play.
+    assert(num_freeze > 1);
+  }  // ordinary check triangle vs triangle
+  std::array<Vec3d, 3> kt{kv0, kv1, kv2};
+  if (prism::predicates::triangle_triangle_overlap(kt, P)) {
+    spdlog::trace("i {} {} {}", ind[i0], ind[i1], ind[i2]);
+    return true;
+  }
+  return false;
+}
+
 bool prism::geogram::AABB::intersects_triangle(const std::array<Vec3d, 3> &P,
                                                bool use_freeze) const {
   if (!enabled) return false;
@@ -57,59 +352,45 @@ bool prism::geogram::AABB::intersects_triangle(const std::array<Vec3d, 3> &P,
     in_box.xyz_min[i] = std::min({P[0][i], P[1][i], P[2][i]});
   }
 
-  Vec3d kp0(P[0][0], P[0][1], P[0][2]);
-  Vec3d kp1(P[1][0], P[1][1], P[1][2]);
-  Vec3d kp2(P[2][0], P[2][1], P[2][2]);
-  std::array<Vec3d, 3> kquery{kp0, kp1, kp2};
-  auto &ind = geo_vertex_ind;
   bool already_found = false;
-
-  auto action = [&P, &pp = geo_polyhedron_ptr_, &already_found, &ind, &kquery,
-                 &kp0, &kp1, &kp2, num_freeze = num_freeze,
-                 use_freeze](GEO::index_t f) {
+  auto action = [this, &P, &already_found, use_freeze](GEO::index_t f) {
     if (already_found) return;
-
-    index_t c = pp->facets.corners_begin(f);
-    auto i0 = pp->facet_corners.vertex(c), i1 = pp->facet_corners.vertex(c + 1),
-         i2 = pp->facet_corners.vertex(c + 2);
-    assert(ind[i0] < ind[i1] && ind[i0] < ind[i2]);
-    const vec3 &v0 = Geom::mesh_vertex(*pp, i0);
-    const vec3 &v1 = Geom::mesh_vertex(*pp, i1);
-    const vec3 &v2 = Geom::mesh_vertex(*pp, i2);
-    if (use_freeze && ind[i0] < num_freeze) {  // triangle vs segment
-      Vec3d kv0(v0.x, v0.y, v0.z);
-      Vec3d kv1(v1.x, v1.y, v1.z);
-      Vec3d kv2(v2.x, v2.y, v2.z);
-      if (kv1 == kp0) std::swap(kv1, kv0);
-      if (kv2 == kp0) std::swap(kv2, kv0);
-      if (kv0 == kp0) {  // floating point should be exact here.
-        std::array<Vec3d, 2> ks{kv1, kv2};
-        std::array<Vec3d, 3> kt{kv0, kv1, kv2};
-        std::array<Vec3d, 2> ks1{kp1, kp2};
-
-        spdlog::trace("testing {} {} {}", ind[i0], ind[i1], ind[i2]);
-
-        if (prism::predicates::segment_triangle_overlap(ks, kquery) ||
-            prism::predicates::segment_triangle_overlap(ks1, kt)) {
-          already_found = true;
-        }
-        return;
-      } // otherwise, a different singularity is at play.
-      assert(num_freeze > 1);
-    }  // ordinary check triangle vs triangle
-    Vec3d kv0(v0.x, v0.y, v0.z);
-    Vec3d kv1(v1.x, v1.y, v1.z);
-    Vec3d kv2(v2.x, v2.y, v2.z);
-    std::array<Vec3d, 3> kt{kv0, kv1, kv2};
-    if (prism::predicates::triangle_triangle_overlap(kt, P)) {
-      spdlog::trace("i {} {} {}", ind[i0], ind[i1], ind[i2]);
-      already_found = true;
-    }
+    already_found = facet_intersects_triangle(f, P, use_freeze);
   };
   geo_tree_ptr_->compute_bbox_facet_bbox_intersections(in_box, action);
   return already_found;
 }
 
+std::vector<int> prism::geogram::AABB::intersects_triangles(
+    const std::vector<std::array<Vec3d, 3>> &P,
+    const std::vector<bool> &use_freeze, bool stop_at_first) const {
+  std::vector<int> result;
+  if (!enabled || P.empty()) return result;
+  assert(use_freeze.empty() || use_freeze.size() == P.size());
+  auto tree = static_cast<const PacketFacetsAABB *>(geo_tree_ptr_.get());
+  std::array<GEO::Box, PacketFacetsAABB::kPacket> boxes;
+  for (int pb = 0; pb < P.size(); pb += PacketFacetsAABB::kPacket) {
+    int num = std::min<int>(PacketFacetsAABB::kPacket, P.size() - pb);
+    for (int q = 0; q < num; q++) {
+      auto &T = P[pb + q];
+      for (int i = 0; i < 3; i++) {
+        boxes[q].xyz_max[i] = std::max({T[0][i], T[1][i], T[2][i]});
+        boxes[q].xyz_min[i] = std::min({T[0][i], T[1][i], T[2][i]});
+      }
+    }
+    auto leaf = [this, &P, &use_freeze, pb](GEO::index_t f, int q) {
+      auto freeze = use_freeze.empty() ? false : bool(use_freeze[pb + q]);
+      return facet_intersects_triangle(f, P[pb + q], freeze);
+    };
+    PacketFacetsAABB::Mask found = 0;
+    tree->packet_intersect(boxes.data(), num, found, stop_at_first, leaf);
+    for (auto m = found; m != 0; m &= m - 1)
+      result.push_back(pb + __builtin_ctzll(m));
+    if (stop_at_first && !result.empty()) break;
+  }
+  return result;
+}
+
 bool prism::geogram::AABB::segment_query(const Vec3d &start, const Vec3d &end,
                                          int &face_id,
                                          Vec3d &finalpoint) const {
@@ -247,13 +528,69 @@ double prism::geogram::AABB::ray_length(const Vec3d &start, const Vec3d &dir,
   return std::sqrt(min_length_sq);
 }
 
+namespace {
+// closest point on triangle (Ericson, Real-Time Collision Detection 5.1.5),
+// all in double. Only used as a filter, the borderline cases are re-evaluated
+// exactly.
+double point_triangle_squared_distance(const GEO::vec3 &p, const GEO::vec3 &a,
+                                       const GEO::vec3 &b,
+                                       const GEO::vec3 &c) {
+  using GEO::vec3;
+  auto ab = b - a, ac = c - a, ap = p - a;
+  auto d1 = GEO::dot(ab, ap), d2 = GEO::dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0) return GEO::length2(ap);
+  auto bp = p - b;
+  auto d3 = GEO::dot(ab, bp), d4 = GEO::dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3) return GEO::length2(bp);
+  auto vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+    auto v = d1 / (d1 - d3);
+    return GEO::length2(ap - v * ab);
+  }
+  auto cp = p - c;
+  auto d5 = GEO::dot(ab, cp), d6 = GEO::dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6) return GEO::length2(cp);
+  auto vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+    auto w = d2 / (d2 - d6);
+    return GEO::length2(ap - w * ac);
+  }
+  auto va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+    auto w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return GEO::length2(bp - w * (c - b));
+  }
+  auto denom = 1. / (va + vb + vc);
+  auto v = vb * denom, w = vc * denom;
+  return GEO::length2(ap - v * ab - w * ac);
+}
+}  // namespace
+
 bool prism::geogram::AABB::numerical_self_intersection(double tol) const {
   // this function is oblivious to re-ordering (unless debugging), so no need to
   // include permutation in the regular code
   using K = CGAL::Exact_predicates_inexact_constructions_kernel;
+  using EK = CGAL::Exact_predicates_exact_constructions_kernel;
   using namespace GEO;
   auto &pp = geo_polyhedron_ptr_;
-  for (auto v = 0; v < geo_vertex_ind.size(); v++) {
+  const double tol2 = tol * tol;
+  // double evaluation of the squared distance is trusted outside of this band,
+  // scaled with the magnitude of the coordinates (input is in unit box).
+  double max_coord = 0.;
+  for (auto v = 0; v < pp->vertices.nb(); v++) {
+    auto &p = Geom::mesh_vertex(*pp, v);
+    max_coord = std::max({max_coord, std::abs(p.x), std::abs(p.y),
+                          std::abs(p.z)});
+  }
+  const double margin = 1e-10 * tol2 +
+                        128 * std::numeric_limits<double>::epsilon() *
+                            (max_coord * max_coord + tol2);
+
+  std::atomic<bool> found{false};
+  std::vector<int> local_exact;
+  auto vertex_check = [&pp, &found, &local_exact, tol, tol2, margin,
+                       this](int v, size_t t) {
+    if (found.load(std::memory_order_relaxed)) return;
     auto p = GEO::Geom::mesh_vertex(*pp, v);
     GEO::Box in_box;
     for (int i = 0; i < 3; i++) {
@@ -261,33 +598,46 @@ bool prism::geogram::AABB::numerical_self_intersection(double tol) const {
       in_box.xyz_min[i] = p[i] - tol;
     }
     bool intersect_flag = false;
-    K::Point_3 kp(p.x, p.y, p.z);
-    auto action = [&pp, &p, &v, &intersect_flag, &kp,
-                   &tol](GEO::index_t f) -> void {
+    auto action = [&pp, &p, &v, &intersect_flag, &local_exact, &t, tol2,
+                   margin](GEO::index_t f) -> void {
       if (intersect_flag) return;
       GEO::index_t c = pp->facets.corners_begin(f);
       auto i0 = pp->facet_corners.vertex(c),
            i1 = pp->facet_corners.vertex(c + 1),
            i2 = pp->facet_corners.vertex(c + 2);
-      // spdlog::trace("io {} {} {} v {}",i0,i1,i2,v);
       if (i0 == v || i1 == v || i2 == v)  // is neighbor
         return;
       const vec3 &v0 = Geom::mesh_vertex(*pp, i0);
       const vec3 &v1 = Geom::mesh_vertex(*pp, i1);
       const vec3 &v2 = Geom::mesh_vertex(*pp, i2);
-      K::Point_3 kv0(v0.x, v0.y, v0.z);
-      K::Point_3 kv1(v1.x, v1.y, v1.z);
-      K::Point_3 kv2(v2.x, v2.y, v2.z);
-      K::Triangle_3 kt(kv0, kv1, kv2);
-      if (CGAL::squared_distance(kp, kt) <= tol * tol) {
+      auto d2 = point_triangle_squared_distance(p, v0, v1, v2);
+      if (d2 > tol2 + margin) return;
+      if (d2 < tol2 - margin) {
+        intersect_flag = true;
+        return;
+      }
+      local_exact[t]++;
+      EK::Point_3 kp(p.x, p.y, p.z);
+      EK::Triangle_3 kt(EK::Point_3(v0.x, v0.y, v0.z),
+                        EK::Point_3(v1.x, v1.y, v1.z),
+                        EK::Point_3(v2.x, v2.y, v2.z));
+      if (CGAL::squared_distance(kp, kt) <= EK::FT(tol2)) {
         intersect_flag = true;
       };
       return;
     };
     geo_tree_ptr_->compute_bbox_facet_bbox_intersections(in_box, action);
-    if (intersect_flag) return true;
-  }
-  return false;
+    if (intersect_flag) found.store(true, std::memory_order_relaxed);
+  };
+  igl::parallel_for(
+      geo_vertex_ind.size(),
+      [&local_exact](size_t nt) { local_exact.resize(nt, 0); }, vertex_check,
+      [&local_exact](size_t t) {
+        if (local_exact[t] > 0)
+          spdlog::trace("thread {} exact fallback {}", t, local_exact[t]);
+      },
+      1000);
+  return found.load();
   // following is edge based, CGAL segment-segment distance is unstable.
   auto mindist = 1.;
   for (auto f = 0; f < pp->facets.nb(); f++) {
@@ -20,6 +20,13 @@ struct AABB {
   AABB(const RowMatd &V, const RowMati &F, bool enabled = true);
   bool intersects_triangle(const std::array<Vec3d, 3> &P,
                            bool use_freeze = false) const;
+  // packet version of `intersects_triangle`: the tree is traversed once for a
+  // group of queries, carrying an active mask per node.
+  // Returns the (sorted) indices of the intersecting queries. With
+  // `stop_at_first`, the traversal ends at the first found intersection.
+  std::vector<int> intersects_triangles(
+      const std::vector<std::array<Vec3d, 3>> &P,
+      const std::vector<bool> &use_freeze, bool stop_at_first = false) const;
   // if there are multiple intersection, the function will return 
   std::optional<Vec3d> segment_query(const Vec3d &start,
                                      const Vec3d &end) const;
@@ -36,6 +43,11 @@ struct AABB {
   bool numerical_self_intersection(double tol) const;
   bool self_intersections(std::vector<std::pair<int,int>>& pairs);
 
+  // leaf test shared by the single and the packet queries, `f` is a geogram
+  // (reordered) facet index.
+  bool facet_intersects_triangle(unsigned int f, const std::array<Vec3d, 3> &P,
+                                 bool use_freeze) const;
+
   std::shared_ptr<GEO::MeshFacetsAABB> geo_tree_ptr_;
   std::shared_ptr<GEO::Mesh> geo_polyhedron_ptr_;
   std::vector<int> geo_vertex_ind;
@@ -44,6 +56,14 @@ struct AABB {
   const bool enabled = true;
 };
 
+// trees shared by content: while a holder is alive, the same
+// (V, F, num_freeze) returns it instead of building again. The cache is keyed
+// by a hash of the content, a hit is confirmed coefficient by coefficient, and
+// only weak references are held. Disabled trees are not shared.
+std::shared_ptr<const AABB> shared_aabb(const RowMatd &V, const RowMati &F,
+                                        int num_freeze = 0,
+                                        bool enabled = true);
+
 } // namespace prism::geogram
 
 #endif
\ No newline at end of file
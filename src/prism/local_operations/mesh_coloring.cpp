@@ -1,48 +1,133 @@
 #include "mesh_coloring.hpp"
 #include <igl/adjacency_list.h>
-#include <iostream>
-void prism::local::vertex_coloring(const RowMati& F,
-                                   std::vector<std::vector<int>>& groups) {
-  // from github hankstag/progressive_embedding
-  int n = F.maxCoeff() + 1;
-  // meanless to color an empty mesh
-  assert(n > 0);
+#include <igl/parallel_for.h>
 
-  std::vector<std::vector<int>> N;  // Adjacency list
-  igl::adjacency_list(F, N);
-  // initialize color for each vertex
-  Eigen::VectorXd C;
-  C.setConstant(n, -1);
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+namespace {
+// splitmix64, deterministic priorities independent of the thread count.
+std::uint64_t coloring_priority(int v, unsigned seed) {
+  std::uint64_t z = (std::uint64_t(v) << 32) + seed + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
 
-  size_t vm = 0;  // max valence
-  for (auto l : N) vm = std::max(l.size(), vm);
+// colors the pending vertices (colors[v] == -1), honoring the colored ones.
+void jones_plassmann(const std::vector<std::vector<int>>& adj,
+                     std::vector<int> pending, std::vector<int>& colors,
+                     unsigned seed) {
+  std::vector<std::uint64_t> priority(adj.size(), 0);
+  std::vector<char> waiting(adj.size(), false);
+  for (auto v : pending) {
+    priority[v] = coloring_priority(v, seed);
+    waiting[v] = true;
+  }
+  auto higher = [&priority](int a, int b) {
+    return priority[a] != priority[b] ? priority[a] > priority[b] : a > b;
+  };
+  std::vector<char> selected(pending.size());
+  while (!pending.empty()) {
+    // local maxima of the uncolored, pairwise independent.
+    igl::parallel_for(
+        pending.size(),
+        [&](auto i) {
+          auto v = pending[i];
+          selected[i] = std::none_of(
+              adj[v].begin(), adj[v].end(),
+              [&](int n) { return waiting[n] && higher(n, v); });
+        },
+        size_t(1000));
+    std::vector<int> winners, rest;
+    for (auto i = 0; i < pending.size(); i++)
+      (selected[i] ? winners : rest).push_back(pending[i]);
+    igl::parallel_for(
+        winners.size(),
+        [&](auto i) {
+          auto v = winners[i];
+          std::vector<int> used;
+          for (auto n : adj[v])
+            if (colors[n] >= 0) used.push_back(colors[n]);
+          std::sort(used.begin(), used.end());
+          auto c = 0;
+          for (auto u : used) {
+            if (u > c) break;
+            if (u == c) c++;
+          }
+          colors[v] = c;
+        },
+        size_t(1000));
+    for (auto v : winners) waiting[v] = false;
+    pending = std::move(rest);
+    selected.resize(pending.size());
+  }
+}
+}  // namespace
 
-  // assign color 0 for vertex 0
-  C[0] = 0;
-  // for every 1 ring, mark the color that has been used
-  // in theory, it need (vm+1) colors at most
-  Eigen::VectorXi G;
-  G.setZero(vm + 1);
-  int nc = 1;  // # of color used
-  for (int i = 1; i < n; i++) {
-    for (int k = 0; k < N[i].size(); k++) {
-      if (C[N[i][k]] != -1) G(C[N[i][k]]) = 1;
-    }
-    for (int j = 0; j < G.rows(); j++) {
-      if (G(j) == 0) {
-        C[i] = j;
-        break;
-      }
-    }
-    G.setZero();
+int prism::local::graph_coloring(const std::vector<std::vector<int>>& adj,
+                                 const std::vector<bool>& active,
+                                 std::vector<int>& colors, unsigned seed) {
+  colors.assign(adj.size(), -1);
+  std::vector<int> pending;
+  for (auto v = 0; v < adj.size(); v++)
+    if (active.empty() || active[v]) pending.push_back(v);
+  jones_plassmann(adj, pending, colors, seed);
+  balance_coloring(adj, colors);
+  return colors.empty() ? 0 : *std::max_element(colors.begin(), colors.end()) + 1;
+}
+
+void prism::local::balance_coloring(const std::vector<std::vector<int>>& adj,
+                                    std::vector<int>& colors) {
+  std::vector<int> sizes;
+  for (auto c : colors) {
+    if (c < 0) continue;
+    if (c >= sizes.size()) sizes.resize(c + 1, 0);
+    sizes[c]++;
+  }
+  if (sizes.size() < 2) return;
+  auto target = (std::accumulate(sizes.begin(), sizes.end(), 0) +
+                 int(sizes.size()) - 1) /
+                int(sizes.size());
+  std::vector<bool> used(sizes.size());
+  for (auto v = 0; v < colors.size(); v++) {
+    auto c = colors[v];
+    if (c < 0 || sizes[c] <= target) continue;
+    std::fill(used.begin(), used.end(), false);
+    for (auto n : adj[v])
+      if (colors[n] >= 0) used[colors[n]] = true;
+    auto best = -1;
+    for (auto k = 0; k < sizes.size(); k++)
+      if (!used[k] && sizes[k] < target && (best < 0 || sizes[k] < sizes[best]))
+        best = k;
+    if (best < 0) continue;
+    sizes[c]--;
+    sizes[best]++;
+    colors[v] = best;
   }
+}
 
-  groups.resize(C.maxCoeff() + 1);
-  for (auto id = 0; id < C.rows(); id++) {
-    groups[C[id]].push_back(id);
+void prism::local::coloring_to_groups(const std::vector<int>& colors,
+                                      std::vector<std::vector<int>>& groups) {
+  groups.clear();
+  for (auto v = 0; v < colors.size(); v++) {
+    if (colors[v] < 0) continue;
+    if (colors[v] >= groups.size()) groups.resize(colors[v] + 1);
+    groups[colors[v]].push_back(v);
   }
 }
 
+void prism::local::vertex_coloring(const RowMati& F,
+                                   std::vector<std::vector<int>>& groups) {
+  // meanless to color an empty mesh
+  assert(F.size() > 0);
+  std::vector<std::vector<int>> N;  // Adjacency list
+  igl::adjacency_list(F, N);
+  std::vector<int> colors;
+  graph_coloring(N, {}, colors);
+  coloring_to_groups(colors, groups);
+}
+
 void prism::local::red_green_coloring(const RowMati& F, const RowMati& FF,
                         Eigen::VectorXi& colors) {
   int sum = 0;
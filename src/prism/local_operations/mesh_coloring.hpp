@@ -5,10 +5,27 @@
 
 namespace prism::local {
 
-// greedy graph coloring algorithm
-// [https://www.geeksforgeeks.org/graph-coloring-set-2-greedy-algorithm/]
+// vertex groups of the mesh F with no edge inside a group, from
+// graph_coloring below.
 void vertex_coloring(const RowMati& F, std::vector<std::vector<int>>& group);
 
+// Jones-Plassmann coloring of a graph given by adjacency lists: in parallel
+// rounds, the uncolored vertices with the highest (pseudo random, seeded)
+// priority among their uncolored neighbors take the smallest free color. The
+// classes are then balanced. Only the vertices with active[v] are colored
+// (all if empty), the others get -1. Returns the number of colors.
+int graph_coloring(const std::vector<std::vector<int>>& adj,
+                   const std::vector<bool>& active, std::vector<int>& colors,
+                   unsigned seed = 0);
+
+// move vertices from classes above the mean size to the smallest class
+// their neighbors allow.
+void balance_coloring(const std::vector<std::vector<int>>& adj,
+                      std::vector<int>& colors);
+
+void coloring_to_groups(const std::vector<int>& colors,
+                        std::vector<std::vector<int>>& groups);
+
 void red_green_coloring(const RowMati& F, const RowMati& FF,
                         Eigen::VectorXi& colors);
 
@@ -0,0 +1,107 @@
+#ifndef PRISM_LOCAL_OPERATIONS_REF_PATCH_HPP
+#define PRISM_LOCAL_OPERATIONS_REF_PATCH_HPP
+
+#include <optional>
+#include <set>
+
+#include "../PrismCage.hpp"
+#include "../cgal/triangle_triangle_intersection.hpp"
+
+namespace prism::local {
+// The tracked reference faces around a vertex, flattened onto the plane of
+// their summed normal. Only valid if no face flips there (a height field),
+// which is the usual case for a one-ring. Relocating the mid point is then a
+// walk in the plane to the face crossed by the pillar, and one exact
+// intersection with that face.
+struct RefPatch {
+  RefPatch(const PrismCage::RefSurf &ref, const std::set<int> &faces,
+           const Vec3d &hint)
+      : ref(ref), faces(faces) {
+    Vec3d normal(0, 0, 0);
+    for (auto f : faces) normal += face_normal(f);
+    if (normal.norm() == 0) return;
+    normal.normalize();
+    axis[0] = normal.cross(std::abs(normal[0]) < 0.9 ? Vec3d(1, 0, 0)
+                                                      : Vec3d(0, 1, 0))
+                  .normalized();
+    axis[1] = normal.cross(axis[0]);
+    for (auto f : faces)
+      if (face_normal(f).dot(normal) <= 0) return;
+    valid = true;
+    current = *faces.begin();
+    for (auto f : faces)
+      if (barycentric(f, hint).minCoeff() >= 0) {
+        current = f;
+        break;
+      }
+  }
+
+  // the intersection point if the walk finds it, otherwise nullopt: when the
+  // walk leaves the patch, gets stuck, or the exact test misses (e.g. the
+  // segment passes by an edge), the caller falls back to the full query.
+  std::optional<Vec3d> segment_query(const Vec3d &s, const Vec3d &t) {
+    for (auto step = 0; step <= faces.size(); step++) {
+      Vec3d n = face_normal(current);
+      auto denom = n.dot(t - s);
+      if (std::abs(denom) < 1e-15 * n.norm() * (t - s).norm()) return {};
+      Vec3d x = s + n.dot(Vec3d(ref.V.row(ref.F(current, 0))) - s) / denom *
+                        (t - s);
+      Eigen::Vector3d bc = barycentric(current, x);
+      int e;
+      if (bc.minCoeff(&e) >= -1e-10) {
+        auto [v0, v1, v2] = vertices(current);
+        return prism::cgal::segment_triangle_intersection({s, t},
+                                                          {v0, v1, v2});
+      }
+      auto next = neighbor(current, e);
+      if (next < 0) return {};
+      current = next;
+    }
+    return {};
+  }
+
+  bool valid = false;
+
+ private:
+  Vec3d face_normal(int f) const {
+    auto [v0, v1, v2] = vertices(f);
+    return (v1 - v0).cross(v2 - v0);
+  }
+  std::array<Vec3d, 3> vertices(int f) const {
+    return {ref.V.row(ref.F(f, 0)), ref.V.row(ref.F(f, 1)),
+            ref.V.row(ref.F(f, 2))};
+  }
+  Eigen::Vector2d flatten(const Vec3d &p) const {
+    return Eigen::Vector2d(p.dot(axis[0]), p.dot(axis[1]));
+  }
+  Eigen::Vector3d barycentric(int f, const Vec3d &p) const {
+    auto [v0, v1, v2] = vertices(f);
+    Eigen::Vector2d a = flatten(v0), b = flatten(v1), c = flatten(v2),
+                    q = flatten(p);
+    auto cross2 = [](const Eigen::Vector2d &u, const Eigen::Vector2d &v) {
+      return u[0] * v[1] - u[1] * v[0];
+    };
+    auto area = cross2(b - a, c - a);
+    return Eigen::Vector3d(cross2(b - q, c - q), cross2(c - q, a - q),
+                           cross2(a - q, b - q)) /
+           area;
+  }
+  // across the edge opposite to corner e, within the patch.
+  int neighbor(int f, int e) const {
+    auto v0 = ref.F(f, (e + 1) % 3), v1 = ref.F(f, (e + 2) % 3);
+    for (auto g : ref.VF[v0]) {
+      if (g == f || faces.find(g) == faces.end()) continue;
+      for (auto j : {0, 1, 2})
+        if (ref.F(g, j) == v1) return g;
+    }
+    return -1;
+  }
+
+  const PrismCage::RefSurf &ref;
+  const std::set<int> &faces;
+  std::array<Vec3d, 2> axis;
+  int current = -1;
+};
+}  // namespace prism::local
+
+#endif
@@ -19,6 +19,7 @@ struct RemeshOptions {
   double target_thickness = 0.01;
   double zig_thick = 1e-4;
   bool parallel = true;
+  bool parallel_feature = false;  // feature slide over independent chains
   bool use_polyshell = false; // zig remesh or snapper remesh
   double relax_quality_threshold = 20;
   double collapse_quality_threshold = 30;
@@ -1,5 +1,6 @@
 #include <igl/doublearea.h>
 #include <igl/facet_components.h>
+#include <igl/parallel_for.h>
 #include <igl/vertex_triangle_adjacency.h>
 #include <spdlog/fmt/bundled/ranges.h>
 #include <spdlog/fmt/ostr.h>
@@ -13,6 +14,9 @@
 #include "prism/phong/projection.hpp"
 #include <algorithm>
 #include <highfive/H5Easy.hpp>
+#include <limits>
+#include <numeric>
+#include <optional>
 #include <prism/cage_check.hpp>
 #include <queue>
 
@@ -46,15 +50,16 @@ namespace prism::local_validity {
 //     local control points to be assigned later
 // Return:
 //    flag == 0 is success.
-int attempt_feature_remesh(const PrismCage &pc,
-                           const std::vector<std::set<int>> &map_track,
-                           const prism::local::RemeshOptions &option,
-                           // specified infos below
-                           double old_quality,
-                           const std::vector<int> &old_fid,
-                           const std::vector<Vec3i> &moved_tris,
-                           std::vector<std::set<int>> &sub_trackee,
-                           std::vector<RowMatd> &local_cp) {
+// held_faces: taken out of the hash grids by the parallel slide, and tested
+// for intersection explicitly.
+int attempt_held_feature_remesh(const PrismCage &pc,
+                                const prism::local::RemeshOptions &option,
+                                double old_quality,
+                                const std::vector<int> &old_fid,
+                                const std::vector<Vec3i> &moved_tris,
+                                std::vector<std::set<int>> &sub_trackee,
+                                std::vector<RowMatd> &local_cp,
+                                const std::vector<int> *held_faces) {
   auto &base = pc.base, &top = pc.top, &mid = pc.mid;
   auto &F = pc.F;
   auto num_freeze = pc.ref.aabb->num_freeze;
@@ -83,6 +88,11 @@ int attempt_feature_remesh(const PrismCage &pc,
       dynamic_intersect_check(pc.base, pc.F, old_fid, moved_tris,
                               *pc.base_grid) &&
       dynamic_intersect_check(pc.top, pc.F, old_fid, moved_tris, *pc.top_grid);
+  if (ic && held_faces != nullptr)
+    ic = dynamic_intersect_check(pc.base, pc.F, old_fid, moved_tris,
+                                 *held_faces) &&
+         dynamic_intersect_check(pc.top, pc.F, old_fid, moved_tris,
+                                 *held_faces);
   if (!ic) return 2;
 
   spdlog::trace("old tris {}", old_tris);
@@ -102,6 +112,19 @@ int attempt_feature_remesh(const PrismCage &pc,
   return 0;
 }
 
+int attempt_feature_remesh(const PrismCage &pc,
+                           const std::vector<std::set<int>> &map_track,
+                           const prism::local::RemeshOptions &option,
+                           // specified infos below
+                           double old_quality,
+                           const std::vector<int> &old_fid,
+                           const std::vector<Vec3i> &moved_tris,
+                           std::vector<std::set<int>> &sub_trackee,
+                           std::vector<RowMatd> &local_cp) {
+  return attempt_held_feature_remesh(pc, option, old_quality, old_fid,
+                                     moved_tris, sub_trackee, local_cp,
+                                     nullptr);
+}
 }  // namespace prism::local_validity
 
 constexpr auto project_vertex_to_segment =
@@ -485,11 +508,14 @@ int feature_slide_pass(PrismCage &pc, RemeshOptions &option) {
   std::vector<std::vector<int>> VF, VFi;
   igl::vertex_triangle_adjacency(
       V.size(), Eigen::Map<RowMati>(F[0].data(), F.size(), 3), VF, VFi);
-  std::vector<int> rejections_steps(8, 0);
-  for (auto vid : verts_on_feat) {
-    auto nb = VF[vid], nbi = VFi[vid];
-    // only do sth when two feature
-    std::vector<decltype(meta_edges.begin())> nb_feat;
+
+  // (v2) -->--it0-->--(vid)-->--it1-->--v1, only when the two features at vid
+  // are from the same chain.
+  using MetaIt = decltype(meta_edges.begin());
+  auto chain_edges =
+      [&](int vid) -> std::optional<std::pair<MetaIt, MetaIt>> {
+    auto &nb = VF[vid], &nbi = VFi[vid];
+    std::vector<MetaIt> nb_feat;
     for (auto i = 0; i < nb.size(); i++) {
       auto v0 = vid, v1 = F[nb[i]][(nbi[i] + 1) % 3],
            v2 = F[nb[i]][(nbi[i] + 2) % 3];
@@ -498,20 +524,27 @@ int feature_slide_pass(PrismCage &pc, RemeshOptions &option) {
       it = meta_edges.find({v2, v0});
       if (it != meta_edges.end()) nb_feat.emplace_back(it);
     }
-    if (nb_feat.size() != 2) continue;
+    if (nb_feat.size() != 2) return {};
     auto it0 = nb_feat[0], it1 = nb_feat[1];
-    if (it0->second.first != it1->second.first) continue;  // different chain
-    int chain_id = it0->second.first;
+    if (it0->second.first != it1->second.first) return {};  // different chain
     if (it0->first.first == vid) std::swap(it0, it1);
-    // (v2) -->--it0-->--(vid)-->--it1-->--v1
     assert(it0->first.second == vid && it1->first.first == vid);
+    return std::pair(it0, it1);
+  };
+
+  // returns true if slided.
+  auto slide_vertex = [&](int vid, std::vector<int> &rejections_steps,
+                          const std::vector<int> *held_faces) -> bool {
+    auto nb_feat = chain_edges(vid);
+    if (!nb_feat) return false;
+    auto it0 = nb_feat->first, it1 = nb_feat->second;
     auto v1 = it1->first.second, v2 = it0->first.first;
     spdlog::trace("u1 {} <- u0 {} <- u2 {}", v1, vid, v2);
 
     std::vector<int> newseg = it0->second.second;
     newseg.insert(newseg.end(), it1->second.second.begin() + 1,
                   it1->second.second.end());
-    if (newseg.size() < 4) continue;  // no need to slide
+    if (newseg.size() < 4) return false;  // no need to slide
 
     auto slice_id = select_middle(inpV, newseg);  // invoked
 #ifndef NDEBUG
@@ -520,7 +553,7 @@ int feature_slide_pass(PrismCage &pc, RemeshOptions &option) {
       spdlog::dump_backtrace();
     }
 #endif
-    if (slice_id + 1 == it0->second.second.size()) continue;  // no shift
+    if (slice_id + 1 == it0->second.second.size()) return false;  // no shift
     std::vector<int> seg0(newseg.begin(), newseg.begin() + slice_id + 1);
     std::vector<int> seg1(newseg.begin() + slice_id, newseg.end());
     auto center_refid = seg1.front();
@@ -551,11 +584,11 @@ int feature_slide_pass(PrismCage &pc, RemeshOptions &option) {
       it0->second.second = std::move(seg0_r);
       it1->second.second = std::move(seg1_r);
     };
-    std::vector<int> old_fids = nb;
+    std::vector<int> old_fids = VF[vid];
     if (!expand_affected_shells(pc, FF, refVF, newseg, old_fids)) {
       rejections_steps[0]++;
       rollback();
-      continue;
+      return false;
     }
     std::vector<Vec3i> moved_tris;
     for (auto f : old_fids) {
@@ -573,21 +606,143 @@ int feature_slide_pass(PrismCage &pc, RemeshOptions &option) {
     it1->second.second = std::move(seg1);
     std::vector<std::set<int>> new_tracks;
     std::vector<RowMatd> local_cp;
-    auto flag = prism::local_validity::attempt_feature_remesh(
-        pc, pc.track_ref, option, old_quality, old_fids, moved_tris, new_tracks, local_cp);
+    auto flag = prism::local_validity::attempt_held_feature_remesh(
+        pc, option, old_quality, old_fids, moved_tris, new_tracks, local_cp,
+        held_faces);
     spdlog::trace("Attempt Feature Slide, {} pass: {}{}", vid, (flag == 0),
                   flag);
     if (flag != 0) {
       rollback();
       spdlog::trace("Rollback V");
       rejections_steps[flag]++;
-      continue;
+      return false;
     }
     spdlog::trace("Slide happening {}", vid);
-    global_ticks++;
     auto &new_fids = old_fids;
     assert(moved_tris.size() == new_tracks.size());
-    prism::local_validity::post_operation(pc, option, old_fids, new_fids, new_tracks, local_cp);
+    prism::local_validity::post_operation(pc, option, old_fids, new_fids,
+                                          new_tracks, local_cp,
+                                          held_faces != nullptr);
+    return true;
+  };
+
+  std::vector<int> rejections_steps(8, 0);
+  if (!option.parallel_feature || pc.base_grid == nullptr) {
+    for (auto vid : verts_on_feat)
+      if (slide_vertex(vid, rejections_steps, nullptr)) global_ticks++;
+    spdlog::info("Snapper Feature Slide. {}", global_ticks);
+    return global_ticks;
+  }
+
+  // Parallel over chains. A chain reads and writes the shells around its
+  // vertices, and the ones tracking the reference faces around its segments,
+  // plus one ring to cover the tracker expansion. Chains sharing such a face
+  // (e.g. at a common corner) or with overlapping (inflated) bounding boxes
+  // go in different groups, and the chains of a group run concurrently. Each
+  // chain goes through its vertices in order, as the serial pass.
+  std::map<int, std::vector<int>> chain_verts;
+  for (auto vid : verts_on_feat) {
+    auto nb_feat = chain_edges(vid);
+    if (nb_feat) chain_verts[nb_feat->first->second.first].push_back(vid);
+  }
+  pc.track_ref.resize(pc.F.size());  // not resized by the concurrent slides.
+  std::vector<std::vector<int>> ref_trackers(pc.ref.F.rows());
+  for (auto f = 0; f < pc.track_ref.size(); f++)
+    for (auto r : pc.track_ref[f]) ref_trackers[r].push_back(f);
+
+  std::vector<int> chains;
+  std::vector<std::vector<int>> footprint;
+  std::vector<std::pair<Vec3d, Vec3d>> boxes;
+  for (auto &[c, verts] : chain_verts) {
+    std::set<int> faces, ref_faces;
+    double reach = 0.;  // bound on the displacement of the vertices.
+    for (auto vid : verts) {
+      set_add_to(VF[vid], faces);
+      auto [it0, it1] = chain_edges(vid).value();
+      std::vector<MetaIt> segs{it0, it1};
+      // segments may grow into the outer segments of the slided neighbors.
+      if (auto nb = chain_edges(it0->first.first)) segs.push_back(nb->first);
+      if (auto nb = chain_edges(it1->first.second)) segs.push_back(nb->second);
+      for (auto it : segs)
+        for (auto r : it->second.second) {
+          set_add_to(refVF[r], ref_faces);
+          reach = std::max(reach, (inpV.row(r) - V[vid]).norm());
+        }
+    }
+    for (auto r : ref_faces) set_add_to(ref_trackers[r], faces);
+    std::vector<int> ring(faces.begin(), faces.end());
+    for (auto f : ring)
+      for (auto j = 0; j < 3; j++)
+        if (FF[f][j] >= 0) faces.insert(FF[f][j]);
+    Vec3d lower = Vec3d::Constant(std::numeric_limits<double>::max());
+    Vec3d upper = -lower;
+    for (auto f : faces)
+      for (auto v : F[f])
+        for (auto p : {pc.base[v], pc.mid[v], pc.top[v]}) {
+          lower = lower.cwiseMin(p);
+          upper = upper.cwiseMax(p);
+        }
+    chains.push_back(c);
+    footprint.emplace_back(faces.begin(), faces.end());
+    boxes.emplace_back(lower - Vec3d::Constant(reach),
+                       upper + Vec3d::Constant(reach));
+  }
+
+  // greedy grouping, larger chains first.
+  std::vector<int> order(chains.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return footprint[a].size() > footprint[b].size();
+  });
+  auto conflict = [&](int a, int b) {
+    auto &[la, ua] = boxes[a];
+    auto &[lb, ub] = boxes[b];
+    if ((la.array() <= ub.array()).all() && (lb.array() <= ua.array()).all())
+      return true;
+    return non_empty_intersect(footprint[a], footprint[b]);
+  };
+  std::vector<std::vector<int>> groups;
+  for (auto i : order) {
+    auto g = std::find_if(groups.begin(), groups.end(), [&](auto &group) {
+      return std::none_of(group.begin(), group.end(),
+                          [&](int j) { return conflict(i, j); });
+    });
+    if (g == groups.end()) {
+      groups.emplace_back(1, i);
+    } else {
+      g->push_back(i);
+    }
+  }
+  spdlog::debug("Feature slide: {} chains in {} groups", chains.size(),
+                groups.size());
+
+  for (auto &group : groups) {
+    for (auto i : group)
+      for (auto f : footprint[i]) {
+        pc.top_grid->remove_element(f);
+        pc.base_grid->remove_element(f);
+      }
+    std::vector<std::vector<int>> group_rejections(group.size(),
+                                                   std::vector<int>(8, 0));
+    std::vector<int> group_ticks(group.size(), 0);
+    igl::parallel_for(
+        group.size(),
+        [&](auto gi) {
+          auto i = group[gi];
+          for (auto vid : chain_verts[chains[i]])
+            if (slide_vertex(vid, group_rejections[gi], &footprint[i]))
+              group_ticks[gi]++;
+        },
+        size_t(1));
+    for (auto i : group) {
+      pc.top_grid->insert_triangles(pc.top, pc.F, footprint[i]);
+      pc.base_grid->insert_triangles(pc.base, pc.F, footprint[i]);
+    }
+    for (auto gi = 0; gi < group.size(); gi++) {
+      global_ticks += group_ticks[gi];
+      for (auto k = 0; k < 8; k++)
+        rejections_steps[k] += group_rejections[gi][k];
+    }
   }
   spdlog::info("Snapper Feature Slide. {}", global_ticks);
   return global_ticks;
@@ -89,15 +89,19 @@ bool intersect_check(const std::vector<Vec3d>& V,
   spdlog::trace("In IC 2x{}", tris.size());
   igl::Timer timer;
   timer.start();
+  std::vector<std::array<Vec3d, 3>> queries;
+  std::vector<bool> freeze_base, freeze_top;
+  queries.reserve(tris.size());
   for (auto [v0, v1, v2] : tris) {
     spdlog::trace("ic v {} {} {}", v0, v1, v2);
-    if (tree_base.intersects_triangle({V[v0], V[v1], V[v2]},
-                                      v0 < tree_base.num_freeze))
-      return false;
-    if (tree_top.intersects_triangle({V[v0], V[v1], V[v2]},
-                                     v0 < tree_top.num_freeze))
-      return false;
+    queries.push_back({V[v0], V[v1], V[v2]});
+    freeze_base.push_back(v0 < tree_base.num_freeze);
+    freeze_top.push_back(v0 < tree_top.num_freeze);
   }
+  if (!tree_base.intersects_triangles(queries, freeze_base, true).empty())
+    return false;
+  if (!tree_top.intersects_triangles(queries, freeze_top, true).empty())
+    return false;
   auto elapsed = timer.getElapsedTimeInMicroSec();
   spdlog::trace("IC true {}", elapsed);
   return true;
@@ -695,6 +699,8 @@ void localsmooth_pass(const PrismCage& pc,
   std::mt19937 mtg(rd());
   for (auto& gr : groups) {
     std::shuffle(gr.begin(), gr.end(), mtg);
+    // without `option.parallel`, the threshold is above the loop size, so
+    // igl runs the group serially.
     igl::parallel_for(
         gr.size(),
         [&gr, &pc = std::as_const(pc), &VF, &VFi,
@@ -704,7 +710,7 @@ void localsmooth_pass(const PrismCage& pc,
           smooth_single(pc, base_tree, top_tree, distortion_bound, gr[ii], VF,
                         VFi, skip_flag, V, F, track_ref);
         },
-        size_t(option.parallel ? 1 : gr.size()));
+        size_t(option.parallel ? 1 : gr.size() + 1));
   }
 }
 
@@ -17,6 +17,7 @@
 #include "prism/geogram/AABB.hpp"
 #include "prism/intersections.hpp"
 #include "prism/spatial-hash/AABB_hash.hpp"
+#include "ref_patch.hpp"
 #include "remesh_pass.hpp"
 #include "validity_checks.hpp"
 
@@ -130,9 +131,13 @@ int smooth_single(PrismCage &pc, int vid,
     std::set<int> total_trackee;
     for (auto f : VF[vid])
       total_trackee.insert(pc.track_ref[f].begin(), pc.track_ref[f].end());
+    prism::local::RefPatch patch(pc.ref, total_trackee, pc.mid[vid]);
     std::optional<Vec3d> mid_intersect;
     for (int i = 0; i < 20; i++) {
-      mid_intersect = query(relocations[0], relocations[2], total_trackee);
+      if (patch.valid)
+        mid_intersect = patch.segment_query(relocations[0], relocations[2]);
+      if (!mid_intersect)
+        mid_intersect = query(relocations[0], relocations[2], total_trackee);
       if (mid_intersect) break;
       relocations[0] = (pc.base[vid] + relocations[0]) / 2;
       relocations[2] = (pc.top[vid] + relocations[2]) / 2;
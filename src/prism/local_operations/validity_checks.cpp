@@ -60,6 +60,21 @@ double max_quality_on_tris(const std::vector<Vec3d> &base,
   return quality;
 }
 
+constexpr auto share_vertex_id = [](const auto &Fc, auto &f) {
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++)
+      if (Fc[i] == f[j])
+        return true;
+  return false; // TODO prove this complete, one vertex touch requires
+                // reduced collision check.
+};
+constexpr auto intersection = [](const auto &V, const auto &Fc, auto &f) {
+  auto &[p0, p1, p2] = Fc;
+  auto &[q0, q1, q2] = f;
+  return prism::predicates::triangle_triangle_overlap({V[p0], V[p1], V[p2]},
+                                                      {V[q0], V[q1], V[q2]});
+};
+
 bool dynamic_intersect_check(
     const std::vector<Vec3d> &base, const std::vector<Vec3i> &F,
     const std::vector<int>
@@ -71,20 +86,6 @@ bool dynamic_intersect_check(
       vec_removed.begin(),
       vec_removed.end()); // important, this has to be sorted or set for
                           // std::difference to work
-  constexpr auto share_vertex_id = [](const auto &Fc, auto &f) {
-    for (int i = 0; i < 3; i++)
-      for (int j = 0; j < 3; j++)
-        if (Fc[i] == f[j])
-          return true;
-    return false; // TODO prove this complete, one vertex touch requires
-                  // reduced collision check.
-  };
-  constexpr auto intersection = [](const auto &V, const auto &Fc, auto &f) {
-    auto &[p0, p1, p2] = Fc;
-    auto &[q0, q1, q2] = f;
-    return prism::predicates::triangle_triangle_overlap({V[p0], V[p1], V[p2]},
-                                                        {V[q0], V[q1], V[q2]});
-  };
   igl::Timer timer;
   timer.start();
   for (int i = 0; i < tris.size(); i++) {
@@ -126,6 +127,35 @@ bool dynamic_intersect_check(
   return true; // safe operation, no intersection
 }
 
+bool dynamic_intersect_check(const std::vector<Vec3d> &base,
+                             const std::vector<Vec3i> &F,
+                             const std::vector<int> &vec_removed,
+                             const std::vector<Vec3i> &tris,
+                             const std::vector<int> &candidates) {
+  std::set<int> removed(vec_removed.begin(), vec_removed.end());
+  for (auto f : tris) {
+    RowMat3d local;
+    for (auto k : {0, 1, 2})
+      local.row(k) = base[f[k]];
+    Vec3d lower = local.colwise().minCoeff(), upper = local.colwise().maxCoeff();
+    for (auto c : candidates) {
+      if (removed.find(c) != removed.end())
+        continue;
+      auto overlap = true;
+      for (auto d : {0, 1, 2}) {
+        auto [lo, hi] = std::minmax(
+            {base[F[c][0]][d], base[F[c][1]][d], base[F[c][2]][d]});
+        if (hi < lower[d] || lo > upper[d])
+          overlap = false;
+      }
+      if (overlap && (!share_vertex_id(F[c], f)) &&
+          intersection(base, F[c], f))
+        return false;
+    }
+  }
+  return true;
+}
+
 bool prism_positivity_with_numerical(const std::array<Vec3d, 6> &verts,
                                      const std::array<bool, 3> &constrained) {
   auto matV = Eigen::Map<const RowMatd>(verts[0].data(), 6, 3);
@@ -210,17 +240,22 @@ bool intersect_check(const std::vector<Vec3d> &base,
   spdlog::trace("In IC 2x{}", tris.size());
   igl::Timer timer;
   timer.start();
+  // base and top interleaved, queried in a single traversal.
+  std::vector<std::array<Vec3d, 3>> queries;
+  std::vector<bool> freeze;
+  queries.reserve(2 * tris.size());
+  freeze.reserve(2 * tris.size());
   for (auto [v0, v1, v2] : tris) {
-    if (tree.intersects_triangle({base[v0], base[v1], base[v2]},
-                                 v0 < tree.num_freeze)) {
-      spdlog::trace("base {} {} {}", v0, v1, v2);
-      return false;
-    }
-    if (tree.intersects_triangle({top[v0], top[v1], top[v2]},
-                                 v0 < tree.num_freeze)) {
-      spdlog::trace("top {} {} {}", v0, v1, v2);
-      return false;
-    }
+    queries.push_back({base[v0], base[v1], base[v2]});
+    queries.push_back({top[v0], top[v1], top[v2]});
+    freeze.insert(freeze.end(), 2, v0 < tree.num_freeze);
+  }
+  auto hits = tree.intersects_triangles(queries, freeze, true);
+  if (!hits.empty()) {
+    auto [v0, v1, v2] = tris[hits.front() / 2];
+    spdlog::trace("{} {} {} {}", hits.front() % 2 == 0 ? "base" : "top", v0,
+                  v1, v2);
+    return false;
   }
   auto elapsed = timer.getElapsedTimeInMicroSec();
   spdlog::trace("IC true {}", elapsed);
@@ -577,7 +612,7 @@ bool feature_handled_distort_check(const PrismCage &pc,
   for (auto i = 0; i < moved_tris.size(); i++) {
     auto &f = moved_tris[i];
     auto remain_track = combined_tracks;
-    for (auto j = 0; j < 3; j++) {
+    for (auto j = 0; j < 3 && pc.meta_edges.may_touch(f); j++) {
       auto v0 = f[j], v1 = f[(j + 1) % 3];
       auto it0 = pc.meta_edges.find({v0, v1});
       auto it1 = pc.meta_edges.find({v1, v0});
@@ -633,13 +668,13 @@ void prism::local_validity::post_operation(
     PrismCage &pc, const prism::local::RemeshOptions &option,
     const std::vector<int> &old_fids, const std::vector<int> &new_fids,
     const std::vector<std::set<int>> &new_tracks,
-    std::vector<RowMatd> &local_cp) {
+    std::vector<RowMatd> &local_cp, bool concurrent) {
   if (option.curve_checker.second.has_value())
     (std::any_cast<
         std::function<void(const std::vector<int> &, const std::vector<int> &,
                            const std::vector<RowMatd> &)>>(
         option.curve_checker.second))(old_fids, new_fids, local_cp);
-  if (pc.top_grid != nullptr) {
+  if (!concurrent && pc.top_grid != nullptr) {
     spdlog::trace("HashGrid remove");
     for (auto f : old_fids) {
       pc.top_grid->remove_element(f);
@@ -649,7 +684,7 @@ void prism::local_validity::post_operation(
     pc.base_grid->insert_triangles(pc.base, pc.F, new_fids);
   }
 
-  pc.track_ref.resize(pc.F.size());
+  if (!concurrent) pc.track_ref.resize(pc.F.size());
   for (int i = 0; i < new_tracks.size(); i++) {
     pc.track_ref[new_fids[i]] = new_tracks[i];
   }
@@ -63,6 +63,13 @@ bool dynamic_intersect_check(
         &vec_removed,  // proposed removal face_id to be ignored in the test.
     const std::vector<Vec3i> &tris,  // proposed addition triangles
     const prism::HashGrid &grid);
+// same test against the listed faces only, for faces held out of the grid.
+// tris are not tested among themselves.
+bool dynamic_intersect_check(const std::vector<Vec3d> &base,
+                             const std::vector<Vec3i> &F,
+                             const std::vector<int> &vec_removed,
+                             const std::vector<Vec3i> &tris,
+                             const std::vector<int> &candidates);
 
 int attempt_local_edit(
     const PrismCage &pc, const std::vector<std::set<int>> &map_track,
@@ -139,11 +146,14 @@ bool feature_handled_distort_check(const PrismCage &pc,
                                    const std::vector<Vec3i> &moved_tris,
                                    const std::vector<int> &old_fid,
                                    std::vector<std::set<int>> &sub_trackee);
+// with `concurrent`, the caller runs disjoint operations in parallel, keeps
+// the hash grids itself and does not change the number of faces, so only the
+// entries of `new_fids` are written.
 void post_operation(PrismCage &pc, const prism::local::RemeshOptions &option,
                     const std::vector<int> &old_fids,
                     const std::vector<int> &new_fids,
                     const std::vector<std::set<int>> &new_tracks,
-                    std::vector<RowMatd> &local_cp);
+                    std::vector<RowMatd> &local_cp, bool concurrent = false);
 }  // namespace prism::local_validity
 
 #endif
\ No newline at end of file
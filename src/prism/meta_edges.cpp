@@ -0,0 +1,65 @@
+#include "meta_edges.hpp"
+
+prism::MetaEdges::iterator prism::MetaEdges::find(const key_type &e) {
+  auto it = index_.find(pack(e));
+  return {&slots_, it == index_.end() ? slots_.size() : it->second};
+}
+
+prism::MetaEdges::const_iterator prism::MetaEdges::find(
+    const key_type &e) const {
+  auto it = index_.find(pack(e));
+  return {&slots_, it == index_.end() ? slots_.size() : it->second};
+}
+
+std::pair<prism::MetaEdges::iterator, bool> prism::MetaEdges::insert(
+    value_type &&v) {
+  auto [it, inserted] = index_.emplace(pack(v.first), 0);
+  if (!inserted) return {{&slots_, it->second}, false};
+  if (free_.empty()) {
+    it->second = slots_.size();
+    slots_.emplace_back();
+  } else {
+    it->second = free_.back();
+    free_.pop_back();
+  }
+  slots_[it->second].emplace(std::move(v));
+  count(slots_[it->second]->first, 1);
+  return {{&slots_, it->second}, true};
+}
+
+prism::MetaEdges::mapped_type &prism::MetaEdges::operator[](
+    const key_type &e) {
+  auto it = find(e);
+  if (it == end()) it = insert(value_type(e, mapped_type())).first;
+  return it->second;
+}
+
+void prism::MetaEdges::erase(iterator it) {
+  auto i = it.i_;
+  count(slots_[i]->first, -1);
+  index_.erase(pack(slots_[i]->first));
+  slots_[i].reset();
+  free_.push_back(i);
+}
+
+size_t prism::MetaEdges::erase(const key_type &e) {
+  auto it = find(e);
+  if (it == end()) return 0;
+  erase(it);
+  return 1;
+}
+
+void prism::MetaEdges::clear() {
+  slots_.clear();
+  free_.clear();
+  index_.clear();
+  valence_.clear();
+}
+
+void prism::MetaEdges::count(const key_type &e, int delta) {
+  for (auto v : {e.first, e.second}) {
+    if (v < 0) continue;
+    if (v >= int(valence_.size())) valence_.resize(v + 1, 0);
+    valence_[v] += delta;
+  }
+}
@@ -0,0 +1,128 @@
+#ifndef PRISM_META_EDGES_HPP
+#define PRISM_META_EDGES_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+namespace prism {
+// Feature edges of the middle surface: directed edge (v0, v1) to chain id
+// and the vertices of the segment on the reference. The interface follows
+// std::map for the passes, but lookups go through a hash of the packed 64-bit
+// edge id, and entries live in a pool of slots (reused after erase) which is
+// also the iteration order. Iterators are slot indices, so they survive
+// insertion and the erasure of other entries. Unlike std::map, end() is the
+// slot count and moves when an insertion grows the pool: compare against a
+// fresh end(), do not keep it across insertions.
+// The count of feature edges at each vertex lets triangles away from the
+// features skip the lookups.
+class MetaEdges {
+ public:
+  using key_type = std::pair<int, int>;
+  using mapped_type = std::pair<int, std::vector<int>>;
+  using value_type = std::pair<const key_type, mapped_type>;
+
+  template <bool Const>
+  class Iterator {
+    using Slots =
+        std::conditional_t<Const,
+                           const std::vector<std::optional<MetaEdges::value_type>>,
+                           std::vector<std::optional<MetaEdges::value_type>>>;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = MetaEdges::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<Const, const value_type &, value_type &>;
+    using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+
+    Iterator(Slots *slots, size_t i) : slots_(slots), i_(i) { skip(); }
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &it) : slots_(it.slots_), i_(it.i_) {}
+
+    reference operator*() const { return *(*slots_)[i_]; }
+    pointer operator->() const { return &*(*slots_)[i_]; }
+    Iterator &operator++() {
+      i_++;
+      skip();
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto it = *this;
+      ++(*this);
+      return it;
+    }
+    bool operator==(const Iterator &it) const { return i_ == it.i_; }
+    bool operator!=(const Iterator &it) const { return i_ != it.i_; }
+
+   private:
+    friend class MetaEdges;
+    friend class Iterator<true>;
+    void skip() {
+      while (i_ < slots_->size() && !(*slots_)[i_]) i_++;
+    }
+    Slots *slots_;
+    size_t i_;
+  };
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  MetaEdges() = default;
+  MetaEdges(const MetaEdges &) = default;
+  MetaEdges(MetaEdges &&) = default;
+  MetaEdges &operator=(MetaEdges &&) = default;
+  // the const keys in the slots forbid element-wise assignment of the pool.
+  MetaEdges &operator=(const MetaEdges &m) {
+    if (this != &m) *this = MetaEdges(m);
+    return *this;
+  }
+
+  iterator begin() { return {&slots_, 0}; }
+  iterator end() { return {&slots_, slots_.size()}; }
+  const_iterator begin() const { return {&slots_, 0}; }
+  const_iterator end() const { return {&slots_, slots_.size()}; }
+
+  iterator find(const key_type &e);
+  const_iterator find(const key_type &e) const;
+  // as std::map, an existing edge is left untouched.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+  std::pair<iterator, bool> insert(value_type &&v);
+  mapped_type &operator[](const key_type &e);
+  void erase(iterator it);
+  size_t erase(const key_type &e);
+  size_t size() const { return index_.size(); }
+  bool empty() const { return index_.empty(); }
+  void clear();
+
+  // number of feature edges at v, in either direction.
+  int valence(int v) const {
+    return (v >= 0 && v < int(valence_.size())) ? valence_[v] : 0;
+  }
+  // false if f has at most one vertex on the features, thus no feature edge.
+  bool may_touch(const Vec3i &f) const {
+    return (valence(f[0]) > 0) + (valence(f[1]) > 0) + (valence(f[2]) > 0) >= 2;
+  }
+
+ private:
+  static std::uint64_t pack(const key_type &e) {
+    return (std::uint64_t(std::uint32_t(e.first)) << 32) |
+           std::uint32_t(e.second);
+  }
+  void count(const key_type &e, int delta);
+  std::vector<std::optional<value_type>> slots_;
+  std::vector<size_t> free_;
+  std::unordered_map<std::uint64_t, size_t> index_;
+  std::vector<int> valence_;
+};
+}  // namespace prism
+
+#endif
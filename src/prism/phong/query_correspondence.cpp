@@ -58,7 +58,8 @@ bool prism::project_to_proxy_mesh(const std::array<Vec3d, 9> &stack,
 void prism::correspond_bc(const PrismCage &pc, const RowMatd &pxV,
                           const RowMati &pxF, const RowMatd &queryP,
                           Eigen::VectorXi &queryF, RowMatd &queryUV) {
-  prism::geogram::AABB pxtree(pxV, pxF);
+  auto pxtree_ptr = prism::geogram::shared_aabb(pxV, pxF);
+  auto &pxtree = *pxtree_ptr;
   GEO::Mesh geo_tet;
   std::unique_ptr<GEO::MeshCellsAABB> tetaabb;
   {
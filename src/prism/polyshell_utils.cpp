@@ -9,12 +9,12 @@
 #include <highfive/H5Easy.hpp>
 
 auto prism::local_validity::identify_zig(
-    const std::map<std::pair<int, int>, std::pair<int, std::vector<int>>>
-        &meta_edges,
+    const prism::MetaEdges &meta_edges,
     const Vec3i &f) -> std::tuple<int, int, std::vector<int>> {
   auto oppo_vid = -1;
   auto cid = -1;
   auto segs = std::vector<int>({});
+  if (!meta_edges.may_touch(f)) return std::tuple(oppo_vid, cid, segs);
   for (auto j = 0; j < 3; j++) {
     auto v0 = f[j], v1 = f[(j + 1) % 3];
     auto it0 = meta_edges.find({v0, v1});
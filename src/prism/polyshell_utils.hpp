@@ -7,9 +7,10 @@
 #include <map>
 
 #include "common.hpp"
+#include "meta_edges.hpp"
 struct PrismCage;
 namespace prism::local_validity {
-auto identify_zig(const std::map<std::pair<int, int>, std::pair<int, std::vector<int>>> &meta_edges,
+auto identify_zig(const prism::MetaEdges &meta_edges,
                   const Vec3i &f) -> std::tuple<int, int, std::vector<int>> ;
 
 auto zig_constructor(const PrismCage &pc, int v0, int v1, int v2,
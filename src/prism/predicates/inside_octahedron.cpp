@@ -53,6 +53,7 @@ void prism::determine_convex_octahedron(const std::array<Vec3d, 3>& base,
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <spdlog/spdlog.h>
 
+// reference for prism::OCT_FACES.
 std::vector<Vec3i> oct_faces_from_type(const std::array<bool, 3>& oct_type,
                                        bool degenerate) {
   std::vector<Vec3i> oct_faces;
@@ -86,14 +87,14 @@ std::vector<Vec3i> oct_faces_from_type(const std::array<bool, 3>& oct_type,
 bool prism::octa_convexity(const std::array<Vec3d, 3>& base,
                            const std::array<Vec3d, 3>& top,
                            const std::array<bool, 3>& oct_type) {
-  auto pos = [&](int v) { return v < 3 ? base[v] : top[v - 3]; };
-  auto num_faces = 8, num_verts = 6;
-  auto oct_faces = oct_faces_from_type(oct_type, false);
-  for (auto f : oct_faces) {
-    auto [v0, v1, v2] = f;
+  auto pos = [&](int v) -> const Vec3d & {
+    return v < 3 ? base[v] : top[v - 3];
+  };
+  for (auto &f : OCT_FACES[oct_type_index(oct_type, false)]) {
+    auto p0 = pos(f[0]).data(), p1 = pos(f[1]).data(),
+         p2 = pos(f[2]).data();
     for (auto j = 0; j < 6; j++) {
-      if (GEO::PCK::orient_3d(pos(v0).data(), pos(v1).data(), pos(v2).data(),
-                              pos(j).data()) > 0) {
+      if (GEO::PCK::orient_3d(p0, p1, p2, pos(j).data()) > 0) {
         spdlog::trace("j {} f {}", j, f);
         return false;
       }
@@ -107,14 +108,10 @@ bool prism::triangle_intersect_octahedron(const std::array<Vec3d, 3>& base,
                                           const std::array<bool, 3>& oct_type,
                                           const std::array<Vec3d, 3>& tri,
                                           bool degenerate) {
-  auto oct_faces = oct_faces_from_type(oct_type, degenerate);
-  std::array<Vec3d, 6> vecprism;
-  std::array<Vec3d, 3> vectriangle;
-  for (int i = 0; i < 3; i++) {
-    vectriangle[i] = Vec3d(tri[i][0], tri[i][1], tri[i][2]);
-    vecprism[i] = Vec3d(base[i][0], base[i][1], base[i][2]);
-    vecprism[i + 3] = Vec3d(top[i][0], top[i][1], top[i][2]);
-  }
+  auto pos = [&](int v) -> const Vec3d & {
+    return v < 3 ? base[v] : top[v - 3];
+  };
+  auto &oct_faces = OCT_FACES[oct_type_index(oct_type, degenerate)];
 
   // Note: the following is not robust on its own
   //  Bilinear patch are contained in their convex hull, but the overall
@@ -123,9 +120,9 @@ bool prism::triangle_intersect_octahedron(const std::array<Vec3d, 3>& base,
   for (int i = 0; i < 3; i++) {  // for each point of tri
     bool point_inside = true;
     for (auto& j : oct_faces) {  // if outside any face, the point is out.
-      if (GEO::PCK::orient_3d(vecprism[j[0]].data(), vecprism[j[1]].data(),
-                              vecprism[j[2]].data(),
-                              vectriangle[i].data()) > 0) {  // i outside face j
+      if (GEO::PCK::orient_3d(pos(j[0]).data(), pos(j[1]).data(),
+                              pos(j[2]).data(),
+                              tri[i].data()) > 0) {  // i outside face j
         point_inside = false;
         break;
       }
@@ -136,9 +133,9 @@ bool prism::triangle_intersect_octahedron(const std::array<Vec3d, 3>& base,
   }
 
   for (auto& j : oct_faces) {  // any face is intersecting
-    std::array<Vec3d, 3> vecfacet{vecprism[j[0]], vecprism[j[1]],
-                                  vecprism[j[2]]};
-    if (prism::predicates::triangle_triangle_overlap(vectriangle, vecfacet)) {
+    if (prism::predicates::triangle_triangle_overlap(
+            tri[0], tri[1], tri[2], pos(j[0]), pos(j[1]),
+            pos(j[2]))) {
       return true;
     }
   }
@@ -152,7 +149,7 @@ bool prism::singularless_triangle_intersect_octahedron(
   // will ignore 0 vs. 0
   // Triangle ABC, Pyramid AMN-APQ
   typedef ::CGAL::Exact_predicates_inexact_constructions_kernel K;
-  auto oct_faces = oct_faces_from_type(oct_type, true);
+  auto &oct_faces = OCT_FACES[oct_type_index(oct_type, true)];
   std::array<K::Point_3, 6> prism;
   std::array<K::Point_3, 3> triangle;
   for (int i = 0; i < 3; i++) {
@@ -219,15 +216,13 @@ bool prism::pointless_triangle_intersect_octahedron(
     }
   }
   assert(ignore_id >= 0);
+  auto pos = [&](int v) -> const Vec3d & {
+    return v < 3 ? base[v] : top[v - 3];
+  };
   auto singular = base[0]==top[0];
-  auto oct_faces = oct_faces_from_type(oct_type, singular);
-  std::array<Vec3d, 6> vecprism;
+  auto &oct_faces = OCT_FACES[oct_type_index(oct_type, singular)];
   auto& vectriangle = tri;
-  for (int i = 0; i < 3; i++) {
-    vecprism[i] = Vec3d(base[i][0], base[i][1], base[i][2]);
-    vecprism[i + 3] = Vec3d(top[i][0], top[i][1], top[i][2]);
-  }
-  
+
   // Step 1. Test Segment BC vs. Octahedron
   // Step 1.a B or C inside octa
   for (int i = 1; i < 3; i++) {
@@ -236,8 +231,8 @@ bool prism::pointless_triangle_intersect_octahedron(
       auto&t = TWELVE_TETRAS[j];
 
       if (prism::predicates::point_in_tetrahedron(
-              vectriangle[i], vecprism[t[0]], vecprism[t[1]], vecprism[t[2]],
-              vecprism[t[3]])) {
+              vectriangle[i], pos(t[0]), pos(t[1]), pos(t[2]),
+              pos(t[3]))) {
         point_inside =
             true;  // any point in any tetrahedron, then overlap must occur.
         return true;
@@ -247,15 +242,15 @@ bool prism::pointless_triangle_intersect_octahedron(
   // Step 1.b Segment BC intersect octa-faces adjacent to A
   // and Triangle ABC intersect octa-faces non-adjacent to A
   for (auto& j : oct_faces) {  // any face is intersecting
-    std::array<Vec3d, 3> vecfacet{vecprism[j[0]], vecprism[j[1]],
-                                  vecprism[j[2]]};
+    auto &f0 = pos(j[0]), &f1 = pos(j[1]), &f2 = pos(j[2]);
     if (j[0] == ignore_id || j[1] == ignore_id || j[2] == ignore_id) {
       if (prism::predicates::segment_triangle_overlap(
-              {vectriangle[1], vectriangle[2]}, vecfacet)) {
+              vectriangle[1], vectriangle[2], f0, f1, f2)) {
         return true;
       }
     } else {
-      if (prism::predicates::triangle_triangle_overlap(vectriangle, vecfacet)) {
+      if (prism::predicates::triangle_triangle_overlap(
+              vectriangle[0], vectriangle[1], vectriangle[2], f0, f1, f2)) {
         return true;
       }
     }
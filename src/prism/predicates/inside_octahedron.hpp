@@ -5,6 +5,62 @@
 
 #include "../common.hpp"
 namespace prism {
+// Faces of the octahedron (prism split by the diagonals of its quads), outward
+// and by vertex index (base 0-2, top 3-5). Indexed by oct_type_index. The
+// degenerate octahedron (base[0] == top[0]) has 6 faces, and 3 renamed to 0.
+struct OctFaces {
+  int size;
+  std::array<std::array<int, 3>, 8> faces;
+  constexpr const std::array<int, 3> *begin() const { return faces.data(); }
+  constexpr const std::array<int, 3> *end() const {
+    return faces.data() + size;
+  }
+  constexpr const std::array<int, 3> &operator[](int i) const {
+    return faces[i];
+  }
+};
+
+constexpr int oct_type_index(const std::array<bool, 3> &oct_type,
+                             bool degenerate) {
+  return oct_type[0] | (oct_type[1] << 1) | (oct_type[2] << 2) |
+         (degenerate << 3);
+}
+
+constexpr std::array<OctFaces, 16> OCT_FACES = [] {
+  std::array<OctFaces, 16> table{};
+  for (auto index = 0; index < 16; index++) {
+    auto &f = table[index].faces;
+    auto n = 0;
+    f[n++] = {0, 2, 1};  // bottom
+    f[n++] = {3, 4, 5};  // top
+    for (auto i = 0; i < 3; i++) {
+      auto i1 = (i + 1) % 3;
+      if ((index >> i) & 1) {
+        f[n++] = {i, i1, i + 3};
+        f[n++] = {i1, i1 + 3, i + 3};
+      } else {
+        f[n++] = {i, i1 + 3, i + 3};
+        f[n++] = {i, i1, i1 + 3};
+      }
+    }
+    if (index & 8) {  // drop the faces on the collapsed edge 0-3.
+      std::array<std::array<int, 3>, 8> g{};
+      auto m = 0;
+      for (auto k = 0; k < 7; k++) {
+        if (k == 2) continue;
+        g[m] = f[k];
+        for (auto &v : g[m])
+          if (v == 3) v = 0;
+        m++;
+      }
+      f = g;
+      n = m;
+    }
+    table[index].size = n;
+  }
+  return table;
+}();
+
 bool inside_convex_octahedron(const std::array<Vec3d, 3>& base,
                               const std::array<Vec3d, 3>& top, const Vec3d&);
 
@@ -48,30 +48,94 @@ bool prism::predicates::positive_prism_volume(
 #include <CGAL/MP_Float.h>
 #include <spdlog/fmt/bundled/ranges.h>
 #include <spdlog/fmt/ostr.h>
+
+#include <atomic>
+
+namespace {
+constexpr std::array<std::array<int, 4>, 3> reorder = {
+    {{1, 3, 0, 2}, {5, 7, 4, 6}, {10, 11, 8, 9}}};  // a,c, b1,b2
+// only the fallbacks are counted: they are rare and slow anyway, while a
+// shared counter on every call would contend in the parallel passes.
+std::atomic<long> nonlinear_exact{0};
+
+// the pillar i condition: a, c > 0 and not (b <= 0 and b^2 > 4ac).
+bool exact_nonlinear_pillar(const std::array<Vec3d, 6> &verts, int i) {
+  using Scalar = CGAL::MP_Float;
+  std::array<Scalar, 4> vols;
+  for (int j = 0; j < 4; j++) {
+    auto ti = reorder[i][j];
+    auto &tet = TWELVE_TETRAS[ti];
+    Eigen::Matrix<Scalar, 3, 3> local_verts;
+    for (int k = 1; k < 4; k++)
+      for (int l = 0; l < 3; l++)
+        local_verts(k - 1, l) =
+            Scalar(verts[tet[k]][l]) - Scalar(verts[tet[0]][l]);
+    vols[j] = local_verts.determinant();
+  }
+  auto [a, c, b1, b2] = vols;
+  auto b = b1 + b2;
+  if (a <= 0 || c <= 0) return false;
+  if (b <= 0 && b * b > 4 * a * c) return false;
+  return true;
+}
+
+// volume in double, with the orient3d error bound (Shewchuk's errboundA),
+// which also covers the rounding of the coordinate differences.
+std::pair<double, double> filtered_volume(const std::array<Vec3d, 6> &verts,
+                                          int ti) {
+  constexpr double eps = std::numeric_limits<double>::epsilon() / 2;
+  constexpr double errbound = (7.0 + 56.0 * eps) * eps;
+  auto &tet = TWELVE_TETRAS[ti];
+  Vec3d a = verts[tet[1]] - verts[tet[0]], b = verts[tet[2]] - verts[tet[0]],
+        c = verts[tet[3]] - verts[tet[0]];
+  auto bc = b[1] * c[2] - b[2] * c[1], ca = c[1] * a[2] - c[2] * a[1],
+       ab = a[1] * b[2] - a[2] * b[1];
+  auto det = a[0] * bc + b[0] * ca + c[0] * ab;
+  auto permanent =
+      (std::abs(b[1] * c[2]) + std::abs(b[2] * c[1])) * std::abs(a[0]) +
+      (std::abs(c[1] * a[2]) + std::abs(c[2] * a[1])) * std::abs(b[0]) +
+      (std::abs(a[1] * b[2]) + std::abs(a[2] * b[1])) * std::abs(c[0]);
+  return {det, errbound * permanent};
+}
+
+// 1 positive, 0 negative, -1 undecided by the filter.
+int filtered_nonlinear_pillar(const std::array<Vec3d, 6> &verts, int i) {
+  constexpr double eps = std::numeric_limits<double>::epsilon();
+  constexpr double safety = 1 + 16 * eps;  // rounding in the bounds.
+  std::array<double, 4> vol, err;
+  for (int j = 0; j < 4; j++)
+    std::tie(vol[j], err[j]) = filtered_volume(verts, reorder[i][j]);
+  auto [a, c, b1, b2] = vol;
+  auto [ea, ec, eb1, eb2] = err;
+  if (a < -ea || c < -ec) return 0;
+  if (a <= ea || c <= ec) return -1;
+  auto b = b1 + b2;
+  auto eb = safety * (eb1 + eb2 + eps * std::abs(b));
+  if (b > eb) return 1;
+  if (b >= -eb) return -1;
+  auto disc = b * b - 4 * a * c;
+  auto ed = safety * (eb * (2 * std::abs(b) + eb) +
+                      4 * (ea * c + ec * a + ea * ec) +
+                      3 * eps * (b * b + 4 * a * c));
+  if (disc > ed) return 0;
+  if (disc < -ed) return 1;
+  return -1;
+}
+}  // namespace
+
 bool prism::predicates::positive_nonlinear_prism(
     const std::array<Vec3d, 6> &verts, const std::array<bool, 3> &constrained) {
-  using Scalar = CGAL::MP_Float;
-  constexpr std::array<std::array<int, 4>, 3> reorder = {
-      {{1, 3, 0, 2}, {5, 7, 4, 6}, {10, 11, 8, 9}}};  // a,c, b1,b2
   for (int i = 0; i < 3; i++) {
     if (constrained[i]) continue;
-    std::array<Scalar, 4> vols;
-    for (int j = 0; j < 4; j++) {
-      auto ti = reorder[i][j];
-      auto &tet = TWELVE_TETRAS[ti];
-      Eigen::Matrix<Scalar, 3, 3> local_verts;
-      for (int k = 1; k < 4; k++)
-        for (int l = 0; l < 3; l++)
-          local_verts(k - 1, l) =
-              Scalar(verts[tet[k]][l]) - Scalar(verts[tet[0]][l]);
-      vols[j] = local_verts.determinant();
-    }
-    // spdlog::trace("vols {}", vols);
-    auto [a, c, b1, b2] = vols;
-    auto b = b1 + b2;
-    if (a <= 0 || c <= 0) return false;
-    // spdlog::trace("delta {}", b * b - 4 * a * c);
-    if (b <= 0 && b * b > 4 * a * c) return false;
+    auto filtered = filtered_nonlinear_pillar(verts, i);
+    if (filtered == 0) return false;
+    if (filtered == 1) continue;
+    nonlinear_exact.fetch_add(1, std::memory_order_relaxed);
+    if (!exact_nonlinear_pillar(verts, i)) return false;
   }
   return true;
-}
\ No newline at end of file
+}
+
+long prism::predicates::nonlinear_prism_exact_count() {
+  return nonlinear_exact.load(std::memory_order_relaxed);
+}
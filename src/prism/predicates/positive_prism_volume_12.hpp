@@ -9,7 +9,11 @@ bool positive_prism_volume(const std::array<Vec3d, 6>& verts,
 bool positive_prism_volume(const std::array<Vec3d, 6>& verts);
 
 // this is not yet an exact predicate.
+// A double filter with a static error bound decides the clear cases, MP_Float
+// only runs for the undecided pillars.
 bool positive_nonlinear_prism(const std::array<Vec3d, 6>& verts,
                               const std::array<bool, 3>& constrained);
+// pillars that fell back to MP_Float since the start.
+long nonlinear_prism_exact_count();
 }  // namespace prism::predicates
 #endif
\ No newline at end of file
@@ -459,11 +459,18 @@ int tri_tri_intersection_test_3d(const real p1[3], const real q1[3],
 
 bool prism::predicates::triangle_triangle_overlap(
     const std::array<Vec3d, 3> &tri0, const std::array<Vec3d, 3> &tri1) {
+  return triangle_triangle_overlap(tri0[0], tri0[1], tri0[2], tri1[0], tri1[1],
+                                   tri1[2]);
+}
+
+bool prism::predicates::triangle_triangle_overlap(
+    const Vec3d &p0, const Vec3d &p1, const Vec3d &p2, const Vec3d &q0,
+    const Vec3d &q1, const Vec3d &q2) {
   real src[3], trg[3];
   int cop[1];
-  int flag = tri_tri_intersection_test_3d(
-      tri0[0].data(), tri0[1].data(), tri0[2].data(), tri1[0].data(),
-      tri1[1].data(), tri1[2].data(), cop, src, trg);
+  int flag = tri_tri_intersection_test_3d(p0.data(), p1.data(), p2.data(),
+                                          q0.data(), q1.data(), q2.data(), cop,
+                                          src, trg);
   if (flag == -1) {
     assert(false);
   };
@@ -605,9 +612,13 @@ bool point_in_tri(const Vec2d &p, const std::tuple<Vec2d &, Vec2d &, Vec2d &> &t
 }  // namespace coplanar
 bool prism::predicates::segment_triangle_overlap(
     const std::array<Vec3d, 2> &seg, const std::array<Vec3d, 3> &tri) {
+  return segment_triangle_overlap(seg[0], seg[1], tri[0], tri[1], tri[2]);
+}
+
+bool prism::predicates::segment_triangle_overlap(const Vec3d &p, const Vec3d &q,
+                                                 const Vec3d &a, const Vec3d &b,
+                                                 const Vec3d &c) {
   using coplanar::to2d;
-  auto &[p, q] = seg;
-  auto &[a, b, c] = tri;
   GEO::Sign abcp = GEO::PCK::orient_3d(a.data(), b.data(), c.data(), p.data());
   GEO::Sign abcq = GEO::PCK::orient_3d(a.data(), b.data(), c.data(), q.data());
   if (abcp == 0) {  // project to 2d
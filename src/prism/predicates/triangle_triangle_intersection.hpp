@@ -9,6 +9,12 @@ bool triangle_triangle_overlap(const std::array<Vec3d, 3>& tri0,
                                     const std::array<Vec3d, 3>& tri1);
 bool segment_triangle_overlap(const std::array<Vec3d, 2>& seg,
                                     const std::array<Vec3d, 3>& tri1);
+// the same, with the points by reference.
+bool triangle_triangle_overlap(const Vec3d& p0, const Vec3d& p1,
+                               const Vec3d& p2, const Vec3d& q0,
+                               const Vec3d& q1, const Vec3d& q2);
+bool segment_triangle_overlap(const Vec3d& p, const Vec3d& q, const Vec3d& a,
+                              const Vec3d& b, const Vec3d& c);
 }  // namespace prism
 
 #endif
\ No newline at end of file
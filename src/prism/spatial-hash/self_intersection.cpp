@@ -1,5 +1,6 @@
 #include "self_intersection.hpp"
 
+#include <igl/parallel_for.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/ostr.h>
 
@@ -100,11 +101,8 @@ auto prism::spatial_hash::tetrashell_self_intersections(
   }
 
   auto cand = hg.self_candidates();
-  std::set<std::pair<int, int>> offend_pairs;
-  auto offend_handle =
-      prism::spatial_hash::find_offending_pairs(F, tetV, tetT, offend_pairs);
-  std::for_each(cand.begin(), cand.end(), offend_handle);
-  return offend_pairs;
+  auto pairs = prism::spatial_hash::offending_pairs(F, tetV, tetT, cand);
+  return std::set<std::pair<int, int>>(pairs.begin(), pairs.end());
 }
 
 std::function<void(const std::pair<int, int> &)>
@@ -135,4 +133,37 @@ prism::spatial_hash::find_offending_pairs(
     }
    
   };
-}
\ No newline at end of file
+}
+
+std::vector<std::pair<int, int>> prism::spatial_hash::offending_pairs(
+    const std::vector<Vec3i> &F, const std::vector<Vec3d> &tetV,
+    const std::vector<Vec4i> &tetT,
+    const std::vector<std::pair<int, int>> &candidates) {
+  std::vector<std::vector<std::pair<int, int>>> local_pairs;
+  std::vector<std::pair<int, int>> pairs;
+  igl::parallel_for(
+      candidates.size(),
+      [&local_pairs](size_t nt) { local_pairs.resize(nt); },
+      [&](size_t i, size_t t) {
+        auto [t0, t1] = candidates[i];
+        auto f0 = t0 / 3, f1 = t1 / 3;
+        if (f0 == f1) return;
+        if (f0 > f1) std::swap(f0, f1);
+        auto &found = local_pairs[t];
+        if (!found.empty() && found.back() == std::pair(f0, f1)) return;
+        int s0 = -1, s1 = -1;
+        if (share_vertex(F[f0], F[f1], s0, s1) > 0) return;
+        std::array<Vec3d, 4> local0, local1;
+        for (auto k : {0, 1, 2, 3}) local0[k] = tetV[tetT[t0][k]];
+        for (auto k : {0, 1, 2, 3}) local1[k] = tetV[tetT[t1][k]];
+        if (prism::predicates::tetrahedron_tetrahedron_overlap(local0, local1))
+          found.emplace_back(f0, f1);
+      },
+      [&local_pairs, &pairs](size_t t) {
+        pairs.insert(pairs.end(), local_pairs[t].begin(), local_pairs[t].end());
+      },
+      1000);
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  return pairs;
+}
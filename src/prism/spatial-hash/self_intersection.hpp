@@ -16,6 +16,13 @@ std::function<void(const std::pair<int, int> &)> find_offending_pairs(
     const std::vector<Vec3i> &F, const std::vector<Vec3d> &tetV,
     const std::vector<Vec4i> &tetT,
     std::set<std::pair<int, int>> &offend_pairs);
+
+// parallel version of `find_offending_pairs` over the whole candidate list,
+// with per thread buffers. Returns sorted, unique face pairs.
+std::vector<std::pair<int, int>> offending_pairs(
+    const std::vector<Vec3i> &F, const std::vector<Vec3d> &tetV,
+    const std::vector<Vec4i> &tetT,
+    const std::vector<std::pair<int, int>> &candidates);
 }  // namespace prism::spatial_hash
 
 #endif
\ No newline at end of file
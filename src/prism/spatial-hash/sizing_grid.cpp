@@ -0,0 +1,143 @@
+#include "sizing_grid.hpp"
+
+#include <igl/parallel_for.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+// corner c at (c&1, c>>1&1, c>>2), local coordinates in [0,1]^3.
+double trilinear(const std::array<double, 8> &value, const Vec3d &t) {
+  double result = 0.;
+  for (auto c = 0; c < 8; c++) {
+    double w = 1.;
+    for (auto d = 0; d < 3; d++) w *= ((c >> d) & 1) ? t[d] : 1 - t[d];
+    result += w * value[c];
+  }
+  return result;
+}
+}  // namespace
+
+prism::SizingGrid::SizingGrid(const std::function<double(const Vec3d &)> &field,
+                              const Vec3d &lower, const Vec3d &upper,
+                              int resolution, int max_depth, double rel_tol)
+    : lower_(lower) {
+  cell_ = std::max((upper - lower).maxCoeff(), 1e-10) / resolution;
+  for (auto d = 0; d < 3; d++)
+    dims_[d] = std::max(1, int(std::ceil((upper[d] - lower[d]) / cell_)));
+
+  // samples on the lattice of the finest level, shared by the neighbors.
+  const long unit = 1l << max_depth;
+  const Eigen::Matrix<long, 3, 1> extent = dims_.cast<long>() * unit +
+                                           Eigen::Matrix<long, 3, 1>::Ones();
+  using Lattice = Eigen::Matrix<long, 3, 1>;
+  auto key = [&extent](const Lattice &l) {
+    return l[0] + extent[0] * (l[1] + extent[1] * l[2]);
+  };
+  std::unordered_map<long, double> samples;
+  auto sample = [&](const std::vector<Lattice> &points) {
+    std::vector<Lattice> todo;
+    for (auto &l : points)
+      if (samples.emplace(key(l), 0.).second) todo.push_back(l);
+    std::vector<double> vals(todo.size());
+    igl::parallel_for(
+        todo.size(),
+        [&](int i) {
+          vals[i] = field(lower_ + todo[i].cast<double>().transpose() *
+                                        (cell_ / unit));
+        },
+        size_t(100));
+    for (auto i = 0; i < todo.size(); i++) samples[key(todo[i])] = vals[i];
+    num_samples_ += todo.size();
+  };
+  auto corners = [](const Lattice &origin, long span) {
+    std::array<Lattice, 8> result;
+    for (auto c = 0; c < 8; c++)
+      result[c] = origin + span * Lattice(c & 1, (c >> 1) & 1, c >> 2);
+    return result;
+  };
+
+  std::vector<std::pair<int, Lattice>> frontier;  // node, lattice origin.
+  std::vector<Lattice> points;
+  for (auto z = 0; z < dims_[2]; z++)
+    for (auto y = 0; y < dims_[1]; y++)
+      for (auto x = 0; x < dims_[0]; x++) {
+        frontier.emplace_back(nodes_.size(), unit * Lattice(x, y, z));
+        nodes_.emplace_back();
+        for (auto &l : corners(frontier.back().second, unit))
+          points.push_back(l);
+      }
+  sample(points);
+  for (auto &[n, origin] : frontier) {
+    auto cs = corners(origin, unit);
+    for (auto c = 0; c < 8; c++) nodes_[n].value[c] = samples[key(cs[c])];
+  }
+
+  for (auto depth = 0; depth < max_depth && !frontier.empty(); depth++) {
+    auto half = unit >> (depth + 1);
+    points.clear();
+    for (auto &[n, origin] : frontier)
+      for (auto i = 0; i < 27; i++)
+        points.push_back(origin + half * Lattice(i % 3, i / 3 % 3, i / 9));
+    sample(points);
+    std::vector<std::pair<int, Lattice>> next;
+    for (auto &[n, origin] : frontier) {
+      auto refine = false;
+      for (auto i = 0; i < 27 && !refine; i++) {
+        Lattice offset(i % 3, i / 3 % 3, i / 9);
+        auto f = samples[key(origin + half * offset)];
+        auto interp = trilinear(nodes_[n].value,
+                                 offset.cast<double>().transpose() / 2);
+        refine = std::abs(f - interp) > rel_tol * std::abs(f);
+      }
+      if (!refine) continue;
+      nodes_[n].child = nodes_.size();
+      for (auto c = 0; c < 8; c++) {
+        Node child;
+        auto child_origin = corners(origin, half)[c];
+        auto cs = corners(child_origin, half);
+        for (auto k = 0; k < 8; k++) child.value[k] = samples[key(cs[k])];
+        next.emplace_back(nodes_.size(), child_origin);
+        nodes_.push_back(child);
+      }
+    }
+    frontier = std::move(next);
+  }
+  spdlog::debug("SizingGrid: {} leaves from {} samples", num_leaves(),
+                num_samples_);
+}
+
+double prism::SizingGrid::operator()(const Vec3d &p) const {
+  Vec3d t = ((p - lower_) / cell_)
+                .cwiseMax(Vec3d::Zero())
+                .cwiseMin(dims_.cast<double>().transpose());
+  Eigen::Vector3i root = t.cast<int>().transpose().cwiseMin(
+      dims_ - Eigen::Vector3i::Ones());
+  t -= root.cast<double>().transpose();
+  auto n = root[0] + dims_[0] * (root[1] + dims_[1] * root[2]);
+  while (nodes_[n].child >= 0) {
+    auto c = 0;
+    for (auto d = 0; d < 3; d++) {
+      auto upper = t[d] >= 0.5;
+      c |= upper << d;
+      t[d] = 2 * t[d] - upper;
+    }
+    n = nodes_[n].child + c;
+  }
+  return trilinear(nodes_[n].value, t);
+}
+
+int prism::SizingGrid::num_leaves() const {
+  return std::count_if(nodes_.begin(), nodes_.end(),
+                       [](auto &n) { return n.child < 0; });
+}
+
+std::function<double(const Vec3d &)> prism::cached_sizing_field(
+    const std::function<double(const Vec3d &)> &field, const Vec3d &lower,
+    const Vec3d &upper, int resolution, int max_depth, double rel_tol) {
+  auto grid = std::make_shared<const SizingGrid>(field, lower, upper,
+                                                 resolution, max_depth,
+                                                 rel_tol);
+  return [grid](const Vec3d &p) { return (*grid)(p); };
+}
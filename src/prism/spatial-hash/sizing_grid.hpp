@@ -0,0 +1,47 @@
+#ifndef PRISM_SPATIAL_HASH_SIZING_GRID_HPP
+#define PRISM_SPATIAL_HASH_SIZING_GRID_HPP
+
+#include <functional>
+#include <memory>
+
+#include "../common.hpp"
+
+namespace prism {
+// A sizing field sampled once on a background grid of cubic cells over a box
+// (usually the reference bounding box, padded by the shell), each cell an
+// octree refined where trilinear interpolation of the corners misses the
+// field at the child nodes by more than rel_tol. Queries are trilinear in the
+// leaf, and clamped to the grid, [lower, lower + dims * cell], which may
+// extend past upper by less than a cell.
+// The field is sampled from several threads at once, so it must be safe to
+// call concurrently.
+class SizingGrid {
+ public:
+  SizingGrid(const std::function<double(const Vec3d &)> &field,
+             const Vec3d &lower, const Vec3d &upper, int resolution = 8,
+             int max_depth = 5, double rel_tol = 0.05);
+  double operator()(const Vec3d &p) const;
+  int num_leaves() const;
+  int num_samples() const { return num_samples_; }
+
+ private:
+  struct Node {
+    int child = -1;  // first of 8, x fastest.
+    std::array<double, 8> value;
+  };
+  std::vector<Node> nodes_;  // roots first.
+  Vec3d lower_;
+  Eigen::Vector3i dims_;
+  double cell_;
+  int num_samples_ = 0;
+};
+
+// field replaced by the grid, the callback shares it (e.g. between the shell
+// and the section RemeshOptions). As above, field is called concurrently.
+std::function<double(const Vec3d &)> cached_sizing_field(
+    const std::function<double(const Vec3d &)> &field, const Vec3d &lower,
+    const Vec3d &upper, int resolution = 8, int max_depth = 5,
+    double rel_tol = 0.05);
+}  // namespace prism
+
+#endif
@@ -16,6 +16,7 @@ using namespace pybind11::literals;
 extern void python_export_curve(py::module&);
 extern void python_export_spatial(py::module&);
 extern void python_export_prism(py::module&);
+extern void python_export_pipeline(py::module&);
 
 PYBIND11_MODULE(prism, m) {
   m.doc() = R"docstring(
@@ -36,4 +37,5 @@ PYBIND11_MODULE(prism, m) {
   python_export_spatial(m);
   python_export_prism(m);
   python_export_curve(m);
+  python_export_pipeline(m);
 }
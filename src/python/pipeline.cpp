@@ -0,0 +1,162 @@
+#include <pybind11/eigen.h>
+#include <pybind11/functional.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <iostream>
+#include <type_traits>
+////////////////////////////////////////////////////////////////////////////////
+#include <spdlog/spdlog.h>
+
+#include <cumin/curve_utils.hpp>
+#include <nlohmann/json.hpp>
+#include <pipeline_schedules.hpp>
+#include <prism/PrismCage.hpp>
+#include <prism/common.hpp>
+#include <prism/feature_utils.hpp>
+
+namespace py = pybind11;
+
+using namespace pybind11::literals;
+
+namespace {
+// the option groups are the same as the command line, so that a dict (e.g.
+// loaded from a json file) only needs to carry the overrides.
+nlohmann::json merged_config(const py::dict &overrides) {
+  auto config = default_pipeline_config();
+  auto str = py::module::import("json").attr("dumps")(overrides);
+  config.merge_patch(nlohmann::json::parse(str.cast<std::string>()));
+  return config;
+}
+
+// the python callback is only entered with the GIL, and the stages run
+// without. Returning None from the callback means continue.
+PipelineProgress make_progress(py::object cb, double min_interval) {
+  if (cb.is_none()) return PipelineProgress(nullptr, min_interval);
+  return PipelineProgress(
+      [cb](const std::string &stage, double fraction) {
+        py::gil_scoped_acquire acquire;
+        auto ret = cb(stage, fraction);
+        return ret.is_none() || ret.cast<bool>();
+      },
+      min_interval);
+}
+}  // namespace
+
+void python_export_pipeline(py::module &m) {
+  py::register_exception<PipelineCancelled>(m, "PipelineCancelled",
+                                            PyExc_RuntimeError);
+
+  m.def(
+      "pipeline_config",
+      [](const py::dict &overrides) {
+        auto config = merged_config(overrides);
+        return py::module::import("json").attr("loads")(config.dump());
+      },
+      "default pipeline options (as in cumin_bin), updated with `overrides`",
+      "overrides"_a = py::dict());
+
+  m.def(
+      "shell_initialize",
+      [](RowMatd V, RowMati F, std::optional<RowMati> feature_edges,
+         Eigen::VectorXi feature_corners, Eigen::VectorXi points_fid,
+         RowMatd points_bc, const py::dict &overrides) {
+        auto config = merged_config(overrides);
+        py::gil_scoped_release release;
+        put_in_unit_box(V);
+        if (!preconditions(V, F, "python",
+                           !config["control"]["danger_relax_precondition"]))
+          throw std::runtime_error("Input does not pass the preconditions.");
+        if (!feature_edges) {
+          feature_edges.emplace();
+          prism::mark_feature_edges(
+              V, F, config["feature"]["dihedral_threshold"].get<double>(),
+              *feature_edges);
+        }
+        auto pc = shell_initialize(V, F, *feature_edges, feature_corners,
+                                   points_fid, points_bc, config);
+        if (pc == nullptr)
+          throw std::runtime_error("Invalid feature specification.");
+        return pc;
+      },
+      R"(Initialize the shell in memory. V is scaled to the unit box, as in
+      cumin_bin. Without feature_edges, the features are marked with the
+      dihedral threshold.)",
+      "V"_a, "F"_a, "feature_edges"_a = py::none(),
+      "feature_corners"_a = Eigen::VectorXi(),
+      "points_fid"_a = Eigen::VectorXi(), "points_bc"_a = RowMatd(),
+      "config"_a = py::dict());
+
+  m.def(
+      "shell_schedule",
+      [](PrismCage &pc, std::vector<RowMatd> complete_cp,
+         const py::dict &overrides, py::object progress_cb,
+         double min_interval) {
+        auto config = merged_config(overrides);
+        if (complete_cp.empty()) config["control"]["reset_cp"] = true;
+        auto progress = make_progress(progress_cb, min_interval);
+        {
+          py::gil_scoped_release release;
+          shell_schedule(pc, complete_cp, config, "", progress);
+        }
+        return complete_cp;
+      },
+      R"(Collapse/split schedule with curving. The shell is modified in place,
+      and the updated control points are returned. `progress(stage, fraction)`
+      may return False to cancel, raising PipelineCancelled.)",
+      "cage"_a, "cp"_a = std::vector<RowMatd>(), "config"_a = py::dict(),
+      "progress"_a = py::none(), "min_interval"_a = 0.5);
+
+  m.def(
+      "surface_stage",
+      [](const PrismCage &pc, const std::vector<RowMatd> &complete_cp) {
+        RowMatd nodes;
+        RowMati cells;
+        bool certified;
+        {
+          py::gil_scoped_release release;
+          certified = surface_stage(pc, complete_cp, nodes, cells);
+        }
+        if (!certified)
+          throw std::runtime_error("Curved shell is not certified positive.");
+        return std::tuple(nodes, cells);
+      },
+      R"(certified high order triangles of the curved surface, without the
+      volume stages. Returns (nodes, cells) in gmsh node ordering.)",
+      "cage"_a, "cp"_a);
+
+  m.def(
+      "volume_stage",
+      [](PrismCage &pc, std::vector<RowMatd> complete_cp,
+         const py::dict &overrides, py::object progress_cb,
+         double min_interval) {
+        auto config = merged_config(overrides);
+        auto progress = make_progress(progress_cb, min_interval);
+        RowMatd nodes;
+        RowMati p4T;
+        {
+          py::gil_scoped_release release;
+          volume_stage(pc, complete_cp, config, nodes, p4T, progress);
+        }
+        return std::tuple(nodes, p4T);
+      },
+      "fill the volume and stitch the curved shell, returns (nodes, cells)",
+      "cage"_a, "cp"_a, "config"_a = py::dict(), "progress"_a = py::none(),
+      "min_interval"_a = 0.5);
+
+  m.def(
+      "cutet_optim",
+      [](RowMatd nodes, RowMati p4T, const py::dict &overrides,
+         py::object progress_cb, double min_interval) {
+        auto config = merged_config(overrides);
+        auto progress = make_progress(progress_cb, min_interval);
+        {
+          py::gil_scoped_release release;
+          cutet_optim(nodes, p4T, config["cutet"], progress);
+        }
+        return std::tuple(nodes, p4T);
+      },
+      "optimize the high order tetrahedra, returns (nodes, cells)",
+      "nodes"_a, "cells"_a, "config"_a = py::dict(), "progress"_a = py::none(),
+      "min_interval"_a = 0.5);
+}
@@ -15,6 +15,13 @@ namespace py = pybind11;
 
 using namespace pybind11::literals;
 
+namespace {
+// read-only handle on a tree from the shared cache, which are const.
+struct ConstAABB {
+  std::shared_ptr<const prism::geogram::AABB> tree;
+};
+}  // namespace
+
 void python_export_spatial(py::module& m) {
   // AABB
   py::class_<igl::AABB<Eigen::MatrixXd, 2> > AABB2(m, "AABB2", "using igl::AABB for 2D case, not very robust.");
@@ -76,21 +83,23 @@ void python_export_spatial(py::module& m) {
         return std::make_tuple(Fid, BC);
       });
 
-  py::class_<prism::geogram::AABB> AABB(m, "AABB");
-  AABB.def(py::init<const Eigen::MatrixXd&, const Eigen::MatrixXi&>())
+  py::class_<ConstAABB> AABB(m, "AABB");
+  AABB.def(py::init([](const Eigen::MatrixXd& V, const Eigen::MatrixXi& F) {
+        return ConstAABB{prism::geogram::shared_aabb(V, F)};
+      }))
       .def("intersects_triangle",
-           [](const prism::geogram::AABB& self, const Vec3d& P0, const Vec3d& P1,
+           [](const ConstAABB& self, const Vec3d& P0, const Vec3d& P1,
               const Vec3d& P2) {
-             return self.intersects_triangle({P0, P1, P2});
+             return self.tree->intersects_triangle({P0, P1, P2});
            })
       .def("segment_query",
-           [](const prism::geogram::AABB& self, const Vec3d& P0, const Vec3d& P1) {
-             return self.segment_query(P0, P1);
+           [](const ConstAABB& self, const Vec3d& P0, const Vec3d& P1) {
+             return self.tree->segment_query(P0, P1);
            })
-      .def("segment_hit", [](const prism::geogram::AABB& self, const Vec3d& P0,
+      .def("segment_hit", [](const ConstAABB& self, const Vec3d& P0,
                              const Vec3d& P1, bool ray = false) {
         prism::Hit hit;
-        bool result = self.segment_hit(P0, P1, hit);
+        bool result = self.tree->segment_hit(P0, P1, hit);
         if (result)
           return std::tuple(hit.id, hit.u, hit.v, hit.t);
         else
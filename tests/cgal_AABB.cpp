@@ -102,3 +102,63 @@ TEST_CASE("aabb singularity") {
   }
   CHECK(num_inter == 62);
 }
+
+TEST_CASE("packet triangle queries") {
+  // a 20x20 grid in the unit square, queried by random triangles, more than
+  // one packet.
+  constexpr int n = 20;
+  RowMatd V((n + 1) * (n + 1), 3);
+  RowMati F(2 * n * n, 3);
+  for (int i = 0; i <= n; i++)
+    for (int j = 0; j <= n; j++)
+      V.row(i * (n + 1) + j) << double(i) / n, double(j) / n, 0.;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      auto v = i * (n + 1) + j;
+      F.row(2 * (i * n + j)) << v, v + n + 1, v + 1;
+      F.row(2 * (i * n + j) + 1) << v + 1, v + n + 1, v + n + 2;
+    }
+  prism::geogram::AABB tree(V, F);
+
+  srand(0);
+  std::vector<std::array<Vec3d, 3>> queries(150);
+  std::vector<int> expected;
+  for (int q = 0; q < queries.size(); q++) {
+    for (auto &p : queries[q]) p = (Vec3d::Random() + Vec3d::Ones()) / 2;
+    for (auto &p : queries[q]) p[2] -= 0.5;
+    if (tree.intersects_triangle(queries[q])) expected.push_back(q);
+  }
+  CHECK_FALSE(expected.empty());
+  CHECK(tree.intersects_triangles(queries, {}) == expected);
+  auto first = tree.intersects_triangles(queries, {}, true);
+  REQUIRE(first.size() == 1);
+  CHECK(std::binary_search(expected.begin(), expected.end(), first[0]));
+}
+
+TEST_CASE("shared aabb") {
+  RowMatd V(4, 3);
+  V << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+  RowMati F(4, 3);
+  F << 0, 1, 3, 1, 2, 3, 0, 3, 2, 0, 2, 1;
+  auto tree = prism::geogram::shared_aabb(V, F);
+  CHECK_EQ(prism::geogram::shared_aabb(V, F), tree);
+  CHECK_NE(prism::geogram::shared_aabb(V, F, 1), tree);
+  CHECK_EQ(tree->geo_face_ind.size(), 4);
+
+  RowMatd moved = V;
+  moved(3, 2) = 2;
+  auto other = prism::geogram::shared_aabb(moved, F);
+  CHECK_NE(other, tree);
+  Vec3d a(0.1, 0.1, 1.5), b(0.1, 0.1, 3);
+  CHECK_FALSE(tree->segment_query(a, b).has_value());
+  CHECK(other->segment_query(a, b).has_value());
+
+  // two sign flips cancel in the hash, the content check must catch it.
+  RowMatd flipped = V;
+  flipped(1, 0) = -1;
+  flipped(2, 1) = -1;
+  CHECK_NE(prism::geogram::shared_aabb(flipped, F), tree);
+  RowMati turned = F;
+  turned.row(0) << 0, 3, 1;
+  CHECK_NE(prism::geogram::shared_aabb(V, turned), tree);
+}
@@ -37,6 +37,231 @@ TEST_CASE("cute-mips") {
   CHECK_LT(val1, val);
 }
 
+#include "cumin/high_order_optimization.hpp"
+#include "cumin/inversion_check.hpp"
+TEST_CASE("quality-statistics") {
+  prism::curve::magic_matrices(3, 3);
+  RowMati codecs_o4(35, 4);
+  vec2eigen(codecs_gen(4, 3), codecs_o4);
+  RowMatd lagr(70, 3);
+  lagr.topRows(35) = codecs_o4.rightCols(3).cast<double>() / 3;
+  lagr.bottomRows(35) = lagr.topRows(35);
+  lagr.bottomRows(35).col(0) *= -1;  // mirrored, inverted copy
+  RowMati p4T(2, 35);
+  for (auto j = 0; j < 35; j++) {
+    p4T(0, j) = j;
+    p4T(1, j) = j + 35;
+  }
+  auto stats = prism::curve::quality_statistics(lagr, p4T, 5, 1);
+  CHECK_EQ(stats.certified, std::vector<int>{1, 0});
+  auto &vd = prism::curve::magic_matrices().volume_data;
+  CHECK_EQ(prism::curve::tetrahedra_inversion_check(
+               lagr, p4T, vd.vol_codec, vd.vol_jac_codec,
+               vd.vol_bern_from_lagr, vd.vol_jac_bern_from_lagr, 1),
+           std::vector<bool>{true, false});
+  CHECK_EQ(stats.mips[0], doctest::Approx(504));
+  CHECK_EQ(stats.mips[1], 1e100);
+  CHECK_EQ(stats.jac_ratio[0], doctest::Approx(1.));
+  CHECK_LT(stats.jac_ratio[1], 0);
+  CHECK_EQ(stats.mips_hist.counts, std::vector<int>{0, 0, 0, 0, 2});
+  CHECK_EQ(stats.ratio_hist.counts, std::vector<int>{1, 0, 0, 0, 1});
+  CHECK_EQ(stats.worst_mips, std::vector<int>{1});
+  CHECK_EQ(stats.worst_ratio, std::vector<int>{1});
+}
+
+#include <random>
+TEST_CASE("batched-inversion-check") {
+  prism::curve::magic_matrices(3, 3);
+  auto &vd = prism::curve::magic_matrices().volume_data;
+  RowMati codecs_o4(35, 4);
+  vec2eigen(codecs_gen(4, 3), codecs_o4);
+  RowMatd ref = codecs_o4.rightCols(3).cast<double>() / 3;
+  // tets with their own nodes: a random affine map, then a perturbation of
+  // growing amplitude, so that both outcomes occur.
+  int num = 150;
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> unif(-1., 1.);
+  RowMatd lagr(35 * num, 3);
+  RowMati p4T(num, 35);
+  for (auto t = 0; t < num; t++) {
+    Eigen::Matrix3d A = Eigen::Matrix3d::Identity();
+    for (auto k = 0; k < 9; k++) A(k / 3, k % 3) += 0.3 * unif(gen);
+    auto amp = 0.5 * t / num;
+    for (auto j = 0; j < 35; j++) {
+      p4T(t, j) = 35 * t + j;
+      Vec3d p = ref.row(j) * A.transpose();
+      for (auto k = 0; k < 3; k++) lagr(35 * t + j, k) = p[k] + amp * unif(gen);
+    }
+  }
+
+  std::vector<bool> expected(num);
+  for (auto t = 0; t < num; t++)
+    expected[t] = prism::curve::tetrahedron_inversion_check(
+        lagr.middleRows(35 * t, 35));
+  CHECK(std::count(expected.begin(), expected.end(), true) > 0);
+  CHECK(std::count(expected.begin(), expected.end(), false) > 0);
+  // full panels, and a block size leaving a partial last panel.
+  for (auto block : {64, 7}) {
+    auto flags = prism::curve::tetrahedra_inversion_check(
+        lagr, p4T, vd.vol_codec, vd.vol_jac_codec, vd.vol_bern_from_lagr,
+        vd.vol_jac_bern_from_lagr, block);
+    REQUIRE_EQ(flags.size(), size_t(num));
+    for (auto t = 0; t < num; t++) CHECK_EQ(flags[t], expected[t]);
+  }
+
+  auto energy = prism::curve::energy_evaluation(lagr, p4T, vd.vec_dxyz);
+  for (auto t = 0; t < num; t++) {
+    auto [val, _] = mips_energy(lagr.middleRows(35 * t, 35), vd.vec_dxyz);
+    CHECK_EQ(energy[t], doctest::Approx(val));
+  }
+}
+
+TEST_CASE("energy-cache") {
+  prism::curve::magic_matrices(3, 3);
+  RowMati codecs_o4(35, 4);
+  vec2eigen(codecs_gen(4, 3), codecs_o4);
+  RowMatd lagr(70, 3);
+  lagr.topRows(35) = codecs_o4.rightCols(3).cast<double>() / 3;
+  lagr.bottomRows(35) = lagr.topRows(35) * 2;  // MIPS is scale invariant
+  RowMati p4T(2, 35);
+  for (auto j = 0; j < 35; j++) {
+    p4T(0, j) = j;
+    p4T(1, j) = j + 35;
+  }
+  prism::curve::EnergyCache energy(lagr, p4T);
+  CHECK_EQ(energy.size(), 2);
+  CHECK_EQ(energy.maxCoeff(), doctest::Approx(504));
+  CHECK_EQ(energy.verify(lagr, p4T), 0.);
+
+  energy.set(1, 600.);
+  CHECK_EQ(energy.mean(), doctest::Approx(552));
+  CHECK_EQ(energy.maxCoeff(), 600.);
+  energy.remove(1);
+  CHECK_EQ(energy.size(), 1);
+  CHECK_EQ(energy.maxCoeff(), doctest::Approx(504));
+  energy.set(3, 10.);  // appended slot
+  CHECK_EQ(energy.minCoeff(), 10.);
+  energy.compact({false, true, true, false});
+  CHECK_EQ(energy.size(), 2);
+  CHECK_EQ(energy[1], 10.);
+  CHECK_EQ(prism::curve::EnergyCache().mean(), 0.);
+}
+
+#include "cumin/cutet_mesh.hpp"
+TEST_CASE("cutet-mesh-adjacency") {
+  // two linear tets sharing a face, elevated to P2 indices only.
+  RowMatd lagr = RowMatd::Zero(5, 3);
+  RowMati p4T(2, 10);
+  p4T.setZero();
+  p4T.row(0).head(4) << 0, 1, 2, 3;
+  p4T.row(1).head(4) << 1, 2, 3, 4;
+  prism::curve::CuTetMesh<2> mesh(lagr, p4T);
+  prism::curve::CuTetMesh<2>::Shell shell;
+  mesh.edge_shell(1, 2, shell);
+  CHECK_EQ(shell.size(), 2);
+  mesh.edge_shell(0, 4, shell);
+  CHECK(shell.empty());
+
+  auto &conn = mesh.conn_tets;
+  for (auto t = 10; t < 40; t++) conn.push_back(4, t);  // outgrow the slack
+  conn.erase(4, 1);
+  CHECK_EQ(conn[4].size(), 30);
+  CHECK_EQ(conn[4][0], 10);
+  CHECK_EQ(conn[3].size(), 2);
+  mesh.resize_vertices(6);
+  conn.push_back(5, 0);
+  CHECK_EQ(conn[5].size(), 1);
+  CHECK_THROWS(prism::curve::CuTetMesh<3>(lagr, p4T));
+}
+
+#include <functional>
+#include <map>
+TEST_CASE("cutet-swap-ring") {
+  // five linear P4 tets around a long edge (v1, v2), with a perturbed
+  // pentagon as link: all five triangulations improve on the shell, with
+  // different energies.
+  auto &vd = prism::curve::magic_matrices(3, 3).volume_data;
+  REQUIRE_EQ(vd.vol_codec.rows(), 35);
+  const auto n = 5;
+  std::vector<Vec3d> pts = {Vec3d(0, 0, 2), Vec3d(0, 0, -2)};
+  std::vector<double> rad = {1, 1.1, 0.9, 1.05, 0.95},
+                      ang = {0, 1.3, 2.4, 3.8, 5.0};
+  for (auto i = 0; i < n; i++)
+    pts.emplace_back(rad[i] * cos(ang[i]), rad[i] * sin(ang[i]), 0);
+
+  // linear MIPS, with the first vertex as apex of the reference. -1 if
+  // inverted.
+  auto linear_mips = [&](int p, int a, int b, int c) {
+    Eigen::Matrix3d J;
+    J << pts[a] - pts[p], pts[b] - pts[p], pts[c] - pts[p];
+    if (J.determinant() <= 0) return -1.;
+    return J.squaredNorm() * J.inverse().squaredNorm();
+  };
+  auto oriented = [&](int p, int a, int b, int c) {
+    return linear_mips(p, a, b, c) > 0 ? std::array<int, 4>{p, a, b, c}
+                                       : std::array<int, 4>{p, c, b, a};
+  };
+
+  std::vector<std::array<int, 4>> tets;
+  for (auto i = 0; i < n; i++)
+    tets.push_back(oriented(0, 1, 2 + i, 2 + (i + 1) % n));
+  // elevate to P4, sharing the nodes by their vertex multiset.
+  std::map<std::vector<int>, int> node_ids;
+  std::vector<Vec3d> nodes;
+  RowMati p4T(tets.size(), 35);
+  for (auto t = 0; t < tets.size(); t++)
+    for (auto c = 0; c < 35; c++) {
+      std::vector<int> key;
+      Vec3d x = Vec3d::Zero();
+      for (auto k = 0; k < 4; k++) {
+        key.insert(key.end(), vd.vol_codec(c, k), tets[t][k]);
+        x += vd.vol_codec(c, k) / 4. * pts[tets[t][k]];
+      }
+      std::sort(key.begin(), key.end());
+      auto [it, inserted] = node_ids.emplace(key, nodes.size());
+      if (inserted) nodes.push_back(x);
+      p4T(t, c) = it->second;
+    }
+  RowMatd lagr(nodes.size(), 3);
+  for (auto i = 0; i < nodes.size(); i++) lagr.row(i) = nodes[i];
+
+  // brute force over the triangulations of the link pentagon.
+  std::vector<double> brute;
+  std::function<void(std::vector<std::array<int, 2>>, double)> enumerate =
+      [&](std::vector<std::array<int, 2>> polys, double worst) {
+        if (polys.empty()) return brute.push_back(worst);
+        auto [i, j] = polys.back();
+        polys.pop_back();
+        if (j - i < 2) return enumerate(polys, worst);
+        for (auto k = i + 1; k < j; k++) {
+          auto sub = polys;
+          sub.push_back({i, k});
+          sub.push_back({k, j});
+          auto e = worst;
+          for (auto apex : {0, 1}) {
+            auto t = oriented(apex, 2 + i, 2 + k, 2 + j);
+            e = std::max(e, linear_mips(t[0], t[1], t[2], t[3]));
+          }
+          enumerate(sub, e);
+        }
+      };
+  enumerate({{0, n - 1}}, 0.);
+  std::sort(brute.begin(), brute.end());
+  REQUIRE_EQ(brute.size(), 5);
+  auto before = prism::curve::EnergyCache(lagr, p4T).maxCoeff();
+  REQUIRE_LT(brute.back(), before);
+  REQUIRE_LT(brute[0], brute[1]);
+
+  CHECK_EQ(prism::curve::cutet_swap(lagr, p4T, 10.), 1);
+  CHECK_EQ(p4T.rows(), 2 * n - 4);
+  auto valid = prism::curve::tetrahedra_inversion_check(
+      lagr, p4T, vd.vol_codec, vd.vol_jac_codec, vd.vol_bern_from_lagr,
+      vd.vol_jac_bern_from_lagr, 1);
+  CHECK(std::all_of(valid.begin(), valid.end(), [](bool b) { return b; }));
+  CHECK_EQ(prism::curve::EnergyCache(lagr, p4T).maxCoeff(),
+           doctest::Approx(brute[0]));
+}
+
 auto get_l2b = [](std::string filename) {
   H5Easy::File file1("../python/curve/data/" + filename);
   return H5Easy::load<RowMatd>(file1, "l2b");
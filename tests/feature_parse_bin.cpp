@@ -31,6 +31,7 @@
 namespace prism::curve {
 void localcurve_pass(PrismCage &pc, const prism::local::RemeshOptions &option);
 }
+namespace {
 auto post_collapse = [](auto &complete_cp) {
   complete_cp.erase(std::remove_if(complete_cp.begin(), complete_cp.end(),
                                    [](auto &c) { return c(0, 0) == -1; }),
@@ -68,8 +69,10 @@ auto reverse_feature_order = [](PrismCage &pc,
     std::swap(crt[i], crt[i + 1]);
   }
 };
+}  // namespace
 
 #include "prism/energy/prism_quality.hpp"
+namespace {
 double total_energy(const std::vector<Vec3d> &V, const std::vector<Vec3i> &F) {
   std::set<int> low_quality_vertices;
   double total_quality = 0;
@@ -84,6 +87,7 @@ double total_energy(const std::vector<Vec3d> &V, const std::vector<Vec3i> &F) {
                total_quality / F.size(), max_quality);
   return max_quality;
 };
+}  // namespace
 
 //std::tuple<RowMatd, RowMatd, RowTenXd<3UL>, std::array<RowMatd, 2UL>,
 //           std::tuple<RowMatd, RowMati, Vec3i,
@@ -92,6 +96,7 @@ double total_energy(const std::vector<Vec3d> &V, const std::vector<Vec3i> &F) {
 std::tuple<RowMatd, RowMatd, std::vector<RowMatd>, std::array<RowMatd, 2UL>, std::tuple<RowMatd, RowMati, Vec3i, std::array<std::vector<int>, 3UL>, std::vector<int>>> magic_matrices(int tri_order, int level);
 
 #include <prism/intersections.hpp>
+namespace {
 auto max_distance_error = [](const PrismCage &pc,
                              const std::vector<RowMatd> &cp) {
   prism::geogram::AABB tree(pc.ref.V, pc.ref.F);
@@ -132,4 +137,292 @@ auto max_distance_error = [](const PrismCage &pc,
         inpV.row(v0) * (1 - u - v) + inpV.row(v1) * u + inpV.row(v2) * v;
   }
   spdlog::info((high_order_pos - ray_hit_pos).rowwise().norm().maxCoeff());
-};
\ No newline at end of file
+};
+}  // namespace
+
+#include <igl/edges.h>
+#include <igl/upsample.h>
+#include <pipeline_schedules.hpp>
+TEST_CASE("feature-slide-parallel") {
+  prism::geo::init_geogram();
+  spdlog::set_level(spdlog::level::warn);
+  RowMatd V(6, 3);
+  V << 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1;
+  RowMati F(8, 3);
+  F << 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5;
+  igl::upsample(V, F, 4);
+  // four independent chains, straight lines of edges on the flat octahedron:
+  // z = 1/2 in the faces (0,2,4) and (1,3,4), z = -1/2 in (0,3,5) and (2,1,5).
+  std::vector<Vec3d> lines{
+      {1, 1, 0.5}, {-1, -1, 0.5}, {1, -1, -0.5}, {-1, 1, -0.5}};
+  auto on_line = [&V](int v, const Vec3d &l) {
+    return V(v, 2) == l[2] && V(v, 0) * l[0] >= 0 && V(v, 1) * l[1] >= 0;
+  };
+  RowMati E;
+  igl::edges(F, E);
+  std::vector<int> edges;
+  std::map<int, int> valence;
+  for (auto i = 0; i < E.rows(); i++)
+    for (auto &l : lines)
+      if (on_line(E(i, 0), l) && on_line(E(i, 1), l)) {
+        edges.insert(edges.end(), {E(i, 0), E(i, 1)});
+        valence[E(i, 0)]++;
+        valence[E(i, 1)]++;
+      }
+  RowMati feature_edges = Eigen::Map<RowMati>(edges.data(), edges.size() / 2, 2);
+  std::vector<int> ends;
+  for (auto [v, k] : valence)
+    if (k == 1) ends.push_back(v);
+  REQUIRE_EQ(feature_edges.rows(), 32);
+  REQUIRE_EQ(ends.size(), 8);
+  Eigen::VectorXi corners = Eigen::Map<Eigen::VectorXi>(ends.data(), ends.size());
+  V.rowwise().normalize();
+  put_in_unit_box(V);
+
+  // collapse (serial) to get uneven segments, then slide.
+  auto config = default_pipeline_config();
+  auto slide = [&](bool parallel) {
+    auto pc = shell_initialize(V, F, feature_edges, corners, Eigen::VectorXi(),
+                               RowMatd(), config);
+    REQUIRE(pc != nullptr);
+    pc->ref.inpV = pc->ref.V;
+    prism::local::RemeshOptions option(pc->mid.size(), 0.1);
+    option.dynamic_hashgrid = true;
+    option.distortion_bound = config["shell"]["distortion_bound"];
+    option.target_thickness = config["shell"]["target_thickness"];
+    option.collapse_quality_threshold = 30;
+    option.relax_quality_threshold = 30;
+    option.parallel = false;
+    prism::local::feature_collapse_pass(*pc, option);
+    option.relax_quality_threshold = 0;
+    option.parallel_feature = parallel;
+    auto ticks = prism::local::feature_slide_pass(*pc, option);
+    return std::pair(std::move(pc), ticks);
+  };
+  auto [serial, serial_ticks] = slide(false);
+  auto [concurrent, concurrent_ticks] = slide(true);
+  CHECK_GT(serial_ticks, 0);
+  CHECK_EQ(concurrent_ticks, serial_ticks);
+  CHECK(concurrent->mid == serial->mid);
+  CHECK(concurrent->base == serial->base);
+  CHECK(concurrent->top == serial->top);
+  CHECK(concurrent->ref.V == serial->ref.V);
+  CHECK(concurrent->track_ref == serial->track_ref);
+  REQUIRE_EQ(concurrent->meta_edges.size(), serial->meta_edges.size());
+  for (auto &[e, d] : serial->meta_edges) {
+    auto it = concurrent->meta_edges.find(e);
+    REQUIRE(it != concurrent->meta_edges.end());
+    CHECK(it->second == d);
+  }
+}
+
+#include <map>
+#include <prism/meta_edges.hpp>
+#include <random>
+TEST_CASE("meta-edges-vs-map") {
+  prism::MetaEdges meta;
+  std::map<std::pair<int, int>, std::pair<int, std::vector<int>>> ref;
+  auto same = [&]() {
+    if (meta.size() != ref.size()) return false;
+    size_t cnt = 0;
+    for (auto &[e, d] : meta) {
+      auto it = ref.find(e);
+      if (it == ref.end() || it->second != d) return false;
+      cnt++;
+    }
+    return cnt == ref.size();
+  };
+  std::mt19937 gen(0);
+  for (auto step = 0; step < 20000; step++) {
+    std::pair<int, int> e(gen() % 30, gen() % 30);
+    switch (gen() % 4) {
+      case 0: {
+        auto [it, inserted] =
+            meta.emplace(e, std::pair(step, std::vector{step}));
+        auto [it_ref, inserted_ref] =
+            ref.emplace(e, std::pair(step, std::vector{step}));
+        REQUIRE_EQ(inserted, inserted_ref);
+        REQUIRE_EQ(it->second, it_ref->second);
+        break;
+      }
+      case 1:
+        REQUIRE_EQ(meta.erase(e), ref.erase(e));
+        break;
+      case 2: {
+        auto it = meta.find(e);
+        REQUIRE_EQ(it == meta.end(), ref.find(e) == ref.end());
+        break;
+      }
+      default:
+        meta[e].first = -step;
+        ref[e].first = -step;
+    }
+    if (step % 1000 == 0) REQUIRE(same());
+  }
+  REQUIRE(same());
+  for (auto v = 0; v < 30; v++) {
+    auto val = 0;
+    for (auto &[e, d] : ref) val += (e.first == v) + (e.second == v);
+    CHECK_EQ(meta.valence(v), val);
+  }
+
+  // erase during iteration, as the passes do.
+  for (auto it = meta.begin(); it != meta.end();) {
+    auto cur = it++;
+    if (cur->first.first % 2 == 0) {
+      ref.erase(cur->first);
+      meta.erase(cur);
+    }
+  }
+  CHECK(same());
+
+  // copies are independent, as with std::map.
+  prism::MetaEdges copy;
+  copy[{-1, -1}].first = 1;
+  copy = meta;
+  REQUIRE_EQ(copy.size(), meta.size());
+  for (auto &[e, d] : meta) CHECK(copy.find(e)->second == d);
+  copy.erase(copy.begin());
+  CHECK_EQ(copy.size() + 1, meta.size());
+  CHECK(same());
+
+  // freed slots are reused first, in place in the iteration order.
+  auto first = meta.begin()->first;
+  meta.erase(first);
+  auto [it, inserted] =
+      meta.emplace(std::pair(100, 101), std::pair(0, std::vector<int>()));
+  CHECK(inserted);
+  CHECK(meta.begin() == it);
+  CHECK_EQ(meta.valence(100), 1);
+  CHECK(meta.may_touch(Vec3i{100, 101, 7}));
+  CHECK_FALSE(meta.may_touch(Vec3i{100, 200, 300}));
+}
+
+#include <numeric>
+#include <set>
+TEST_CASE("feature-pre-split") {
+  auto normal = [](const RowMatd &V, const RowMati &F, int f) {
+    Vec3d a = V.row(F(f, 1)) - V.row(F(f, 0)),
+          b = V.row(F(f, 2)) - V.row(F(f, 0));
+    return Vec3d(a.cross(b));
+  };
+  auto positions = [](const RowMatd &V, const RowMati &F,
+                      const Eigen::VectorXi &fid, const RowMatd &bc) {
+    RowMatd pos = RowMatd::Zero(fid.size(), 3);
+    for (auto p = 0; p < fid.size(); p++)
+      for (auto k = 0; k < 3; k++)
+        pos.row(p) += bc(p, k) * V.row(F(fid[p], k));
+    return pos;
+  };
+  auto same_orientation = [&](const RowMatd &V, const RowMati &F,
+                              const RowMatd &V0, const RowMati &F0,
+                              const std::vector<int> &parent) {
+    for (auto f = 0; f < F.rows(); f++)
+      if (normal(V, F, f).dot(normal(V0, F0, parent[f])) <= 0) return false;
+    return true;
+  };
+
+  SUBCASE("ears") {
+    // the top faces have two ear edges, two bottom faces one.
+    RowMatd V(6, 3);
+    V << 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1;
+    RowMati F(8, 3);
+    F << 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5;
+    RowMati feature_edges(3, 2);
+    feature_edges << 0, 2, 2, 1, 4, 3;
+    auto V0 = V;
+    auto F0 = F;
+    std::vector<int> parent(F.rows());
+    std::iota(parent.begin(), parent.end(), 0);
+    prism::FaceSplit split;
+    prism::split_feature_ears(V, F, feature_edges, parent, split);
+    std::vector<int> children;
+    for (auto f = 0; f < F0.rows(); f++)
+      children.push_back(split.offset[f + 1] - split.offset[f]);
+    CHECK_EQ(children, std::vector<int>{3, 3, 3, 3, 1, 1, 2, 2});
+    CHECK(same_orientation(V, F, V0, F0, parent));
+
+    Eigen::VectorXi fid(F0.rows());
+    RowMatd bc(F0.rows(), 3);
+    for (auto f = 0; f < F0.rows(); f++) {
+      fid[f] = f;
+      bc.row(f) << 0.2 + 0.05 * f, 0.3, 0.5 - 0.05 * f;
+    }
+    auto before = positions(V0, F0, fid, bc);
+    prism::remap_points(split, fid, bc);
+    CHECK_LT((positions(V, F, fid, bc) - before).cwiseAbs().maxCoeff(), 1e-12);
+    CHECK_GE(bc.minCoeff(), 0.);
+  }
+
+  SUBCASE("red-green") {
+    // a subdivided octahedron on the unit sphere, the +z pole pulled out so
+    // that only the faces near it have edges above the threshold.
+    RowMatd V(6, 3);
+    V << 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1;
+    V /= 2;
+    RowMati oct(8, 3);
+    oct << 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,  //
+        2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5;
+    std::map<std::pair<int, int>, int> mid;
+    auto midpoint = [&](int a, int b) {
+      auto [it, inserted] =
+          mid.emplace(std::pair(std::min(a, b), std::max(a, b)), V.rows());
+      if (inserted) {
+        V.conservativeResize(V.rows() + 1, 3);
+        V.row(it->second) = (V.row(a) + V.row(b)).normalized() / 2;
+      }
+      return it->second;
+    };
+    RowMati F(32, 3);
+    for (auto f = 0; f < 8; f++) {
+      auto a = oct(f, 0), b = oct(f, 1), c = oct(f, 2);
+      auto ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      F.row(4 * f) << a, ab, ca;
+      F.row(4 * f + 1) << b, bc, ab;
+      F.row(4 * f + 2) << c, ca, bc;
+      F.row(4 * f + 3) << ab, bc, ca;
+    }
+    V.row(4) << 0, 0, 0.9;
+    RowMati feature_edges(2, 2);
+    feature_edges << 4, mid.at({0, 4}), mid.at({0, 4}), 0;
+    auto V0 = V;
+    auto F0 = F;
+    std::vector<int> parent(F.rows());
+    std::iota(parent.begin(), parent.end(), 0);
+    Eigen::VectorXi fid(F.rows());
+    RowMatd bc(F.rows(), 3);
+    for (auto f = 0; f < F.rows(); f++) {
+      fid[f] = f;
+      bc.row(f) << 0.2 + 0.01 * f, 0.3, 0.5 - 0.01 * f;
+    }
+    auto before = positions(V, F, fid, bc);
+    auto pole_edge = feature_edges.row(0).eval();
+    prism::feature_pre_split(V, F, feature_edges, 0.6, parent, fid, bc);
+
+    // as the serial red-green split: red faces (3 marked edges) around the
+    // pole give 4 children, green ones (1 marked edge) 2.
+    std::vector<int> children(F0.rows(), 0);
+    for (auto p : parent) children[p]++;
+    CHECK_EQ(children, std::vector<int>{1, 1, 4, 2, 1, 1, 4, 2, 1, 1, 4, 2,
+                                        1, 1, 4, 2, 1, 1, 1, 1, 1, 1, 1, 1,
+                                        1, 1, 1, 1, 1, 1, 1, 1});
+    CHECK_EQ(V.rows(), 26);
+    CHECK(same_orientation(V, F, V0, F0, parent));
+    CHECK_LT((positions(V, F, fid, bc) - before).cwiseAbs().maxCoeff(), 1e-12);
+    // the pole edge is split at its midpoint, the other feature edge kept.
+    REQUIRE_EQ(feature_edges.rows(), 3);
+    std::set<std::pair<int, int>> edges;
+    for (auto e = 0; e < feature_edges.rows(); e++)
+      edges.emplace(std::min(feature_edges(e, 0), feature_edges(e, 1)),
+                    std::max(feature_edges(e, 0), feature_edges(e, 1)));
+    CHECK(edges.count({0, pole_edge[1]}));
+    auto m = -1;
+    for (auto v = 0; v < V.rows(); v++)
+      if ((V.row(v) - (V0.row(pole_edge[0]) + V0.row(pole_edge[1])) / 2)
+              .norm() < 1e-12)
+        m = v;
+    REQUIRE_NE(m, -1);
+    CHECK(edges.count({std::min(m, pole_edge[0]), std::max(m, pole_edge[0])}));
+    CHECK(edges.count({std::min(m, pole_edge[1]), std::max(m, pole_edge[1])}));
+  }
+}
@@ -26,4 +26,18 @@ TEST_CASE("numerical self intersection") {
     spdlog::info("{}: self {}", filename, tol);
     REQUIRE_GT(tol, 1e-5);
   }
-}
\ No newline at end of file
+}
+TEST_CASE("numerical self intersection two tetra") {
+  // two tetrahedra surfaces, with a gap of 1e-4 along z.
+  RowMatd V(8, 3);
+  V << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1,  //
+      0.2, 0.2, -1e-4, 1, 0, -1, 0, 1, -1, 0, 0, -1;
+  RowMati F(8, 3);
+  F << 0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3,  //
+      4, 5, 6, 4, 7, 5, 4, 6, 7, 5, 7, 6;
+  prism::geogram::AABB tree(V, F);
+  CHECK_FALSE(tree.numerical_self_intersection(1e-5));
+  CHECK_FALSE(tree.numerical_self_intersection(0.99e-4));
+  CHECK(tree.numerical_self_intersection(1.01e-4));
+  CHECK(tree.numerical_self_intersection(1e-3));
+}
@@ -0,0 +1,86 @@
+#include <doctest.h>
+#include <igl/boundary_facets.h>
+#include <igl/is_edge_manifold.h>
+#include <igl/upsample.h>
+#include <igl/volume.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <pipeline_schedules.hpp>
+#include <prism/PrismCage.hpp>
+#include <prism/common.hpp>
+#include <prism/geogram/geogram_utils.hpp>
+
+namespace {
+// subdivided octahedron, projected on the unit sphere.
+void sphere(int levels, RowMatd &V, RowMati &F) {
+  V.resize(6, 3);
+  V << 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1;
+  F.resize(8, 3);
+  F << 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5;
+  igl::upsample(V, F, levels);
+  V.rowwise().normalize();
+}
+}  // namespace
+
+TEST_CASE("section-stage-resolutions") {
+  prism::geo::init_geogram();
+  spdlog::set_level(spdlog::level::warn);
+  RowMatd V;
+  RowMati F;
+  sphere(2, V, F);
+  put_in_unit_box(V);
+  PrismCage pc(V, F, 0.2, 1e-2);
+
+  auto config = default_pipeline_config();
+  config["section"]["iterations"] = 2;
+  // the resolutions run concurrently, each with serial passes.
+  auto sections = section_stage(pc, {0.4, 0.1}, config);
+  REQUIRE_EQ(sections.size(), 2);
+  for (auto &[sV, sF] : sections) {
+    REQUIRE_GT(sF.rows(), 0);
+    CHECK_LT(sF.maxCoeff(), sV.rows());
+    CHECK(igl::is_edge_manifold(sF));
+  }
+  CHECK_LT(sections[0].second.rows(), sections[1].second.rows());
+}
+
+TEST_CASE("tetshell-fill-core") {
+  prism::geo::init_geogram();
+  spdlog::set_level(spdlog::level::warn);
+  RowMatd base;
+  RowMati F;
+  sphere(1, base, F);
+  RowMatd ext = 0.7 * base;  // the inward extrusion.
+  Eigen::MatrixXd V;
+  Eigen::MatrixXi T;
+  REQUIRE(tetshell_fill_core(ext, base, F, V, T));
+  REQUIRE_GE(V.rows(), base.rows());
+  CHECK(V.topRows(base.rows()) == base);
+
+  // the core is bounded by the base triangles, and nothing else.
+  Eigen::MatrixXi BF;
+  igl::boundary_facets(T, BF);
+  auto sorted_faces = [](const auto &M) {
+    std::vector<std::array<int, 3>> faces(M.rows());
+    for (auto i = 0; i < M.rows(); i++) {
+      faces[i] = {M(i, 0), M(i, 1), M(i, 2)};
+      std::sort(faces[i].begin(), faces[i].end());
+    }
+    std::sort(faces.begin(), faces.end());
+    return faces;
+  };
+  CHECK(sorted_faces(BF) == sorted_faces(F));
+
+  // consistently oriented, filling the enclosed volume.
+  Eigen::VectorXd vol;
+  igl::volume(V, T, vol);
+  CHECK((vol.minCoeff() > 0 || vol.maxCoeff() < 0));
+  double enclosed = 0;
+  for (auto i = 0; i < F.rows(); i++) {
+    Vec3d a = base.row(F(i, 0)), b = base.row(F(i, 1)), c = base.row(F(i, 2));
+    enclosed += a.dot(b.cross(c)) / 6.;
+  }
+  CHECK_EQ(vol.cwiseAbs().sum(), doctest::Approx(enclosed));
+}
@@ -49,6 +49,19 @@ TEST_CASE("volume-pos") {
        STANDARD_PRISM[0], STANDARD_PRISM[1], STANDARD_PRISM[2]}));
 }
 
+TEST_CASE("nonlinear-prism-filter") {
+  auto exact = prism::predicates::nonlinear_prism_exact_count();
+  CHECK(prism::predicates::positive_nonlinear_prism(STANDARD_PRISM,
+                                                    {false, false, false}));
+  CHECK_EQ(prism::predicates::nonlinear_prism_exact_count(), exact);
+
+  auto degenerate = STANDARD_PRISM;
+  degenerate[3] = degenerate[0];  // zero pillar, left to MP_Float.
+  CHECK_FALSE(prism::predicates::positive_nonlinear_prism(
+      degenerate, {false, false, false}));
+  CHECK_GT(prism::predicates::nonlinear_prism_exact_count(), exact);
+}
+
 TEST_CASE("triangle intersect prism") {
   prism::geo::init_geogram();
   SUBCASE("Sanity, First Vertex is Center") {
@@ -446,6 +459,65 @@ TEST_CASE("tetrahedron predicate") {
 std::vector<Vec3i> oct_faces_from_type(const std::array<bool, 3> &oct_type,
                                        bool degenerate);
 
+#include <random>
+TEST_CASE("octahedron-tables") {
+  prism::geo::init_geogram();
+  for (auto index = 0; index < 16; index++) {
+    std::array<bool, 3> oct_type{bool(index & 1), bool(index & 2),
+                                 bool(index & 4)};
+    auto degenerate = bool(index & 8);
+    REQUIRE_EQ(prism::oct_type_index(oct_type, degenerate), index);
+    auto faces = oct_faces_from_type(oct_type, degenerate);
+    auto &table = prism::OCT_FACES[index];
+    REQUIRE_EQ(table.size, faces.size());
+    for (auto i = 0; i < faces.size(); i++)
+      for (auto j = 0; j < 3; j++) CHECK_EQ(table[i][j], faces[i][j]);
+  }
+
+  // the allocation free kernel against the face list reference.
+  auto reference = [](auto &base, auto &top, auto &oct_type, auto &tri,
+                      bool degenerate) {
+    std::array<Vec3d, 6> verts{base[0], base[1], base[2],
+                               top[0],  top[1],  top[2]};
+    auto faces = oct_faces_from_type(oct_type, degenerate);
+    for (auto &p : tri) {
+      auto inside = std::none_of(faces.begin(), faces.end(), [&](auto &f) {
+        return GEO::PCK::orient_3d(verts[f[0]].data(), verts[f[1]].data(),
+                                   verts[f[2]].data(), p.data()) > 0;
+      });
+      if (inside) return true;
+    }
+    return std::any_of(faces.begin(), faces.end(), [&](auto &f) {
+      return prism::predicates::triangle_triangle_overlap(
+          tri, {verts[f[0]], verts[f[1]], verts[f[2]]});
+    });
+  };
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> u(-0.3, 0.3);
+  for (auto it = 0; it < 10000; it++) {
+    std::array<Vec3d, 3> base{Vec3d(0, 0, 0), Vec3d(1, 0, 0), Vec3d(0, 1, 0)};
+    std::array<Vec3d, 3> top{Vec3d(0, 0, 1), Vec3d(1, 0, 1), Vec3d(0, 1, 1)};
+    for (auto &p : base) p += Vec3d(u(gen), u(gen), u(gen));
+    for (auto &p : top) p += Vec3d(u(gen), u(gen), u(gen));
+    auto degenerate = (it % 5 == 0);
+    if (degenerate) top[0] = base[0];
+    if (it % 7 == 0) {  // on a coarse lattice, for exact coplanarity.
+      for (auto &p : base) p = (p * 4).array().round() / 4;
+      for (auto &p : top) p = (p * 4).array().round() / 4;
+    }
+    std::array<bool, 3> oct_type;
+    prism::determine_convex_octahedron(base, top, oct_type, degenerate);
+    std::array<Vec3d, 3> tri;
+    for (auto &p : tri)
+      p = Vec3d(0.3 + 2 * u(gen), 0.3 + 2 * u(gen), 0.5 + 3 * u(gen));
+    if (it % 3 == 0) tri[0] = (it % 2 == 0) ? base[1] : top[2];
+    CHECK_EQ(
+        prism::triangle_intersect_octahedron(base, top, oct_type, tri,
+                                             degenerate),
+        reference(base, top, oct_type, tri, degenerate));
+  }
+}
+
 
 #include <prism/PrismCage.hpp>
 #include <prism/geogram/AABB.hpp>
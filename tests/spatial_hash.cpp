@@ -177,3 +177,31 @@ TEST_CASE("spatial hash integrated") {
   PrismCage pc(V, F, 0.2, 0.1, PrismCage::SeparateType::kShell);
   pc.serialize("temp.h5");
 }
+
+#include <atomic>
+#include <prism/spatial-hash/sizing_grid.hpp>
+TEST_CASE("sizing grid") {
+  auto linear = [](const Vec3d &p) { return 1 + p[0] + 2 * p[1] - p[2]; };
+  prism::SizingGrid flat(linear, Vec3d(0, 0, 0), Vec3d(1, 2, 3), 2);
+  CHECK_EQ(flat.num_leaves(), 4);  // trilinear is exact, no refinement.
+  CHECK_EQ(flat(Vec3d(0.3, 1.7, 2.2)), doctest::Approx(2.5));
+  CHECK_EQ(flat(Vec3d(-1, 0, 0)), doctest::Approx(1.));  // clamped
+
+  std::atomic<int> calls{0};  // sampled in parallel
+  auto bumpy = [&calls](const Vec3d &p) {
+    calls++;
+    return 0.04 + 0.1 * p.squaredNorm() + 0.02 * std::sin(6 * p[1]);
+  };
+  auto sizing = prism::cached_sizing_field(bumpy, Vec3d(-1, -1, -1),
+                                           Vec3d(1, 1, 1), 8, 5, 0.05);
+  int built = calls;
+  double err = 0;
+  for (auto x = -1.; x <= 1.; x += 0.13)
+    for (auto y = -1.; y <= 1.; y += 0.17)
+      for (auto z = -1.; z <= 1.; z += 0.19) {
+        Vec3d p(x, y, z);
+        err = std::max(err, std::abs(sizing(p) - bumpy(p)) / bumpy(p));
+      }
+  CHECK_LT(err, 0.1);
+  CHECK_LT(built, 100000);
+}
@@ -242,4 +242,129 @@ TEST_CASE("param smoothing") {
       // what if it goes to a different prism? allow it for now.
     }
   igl::write_triangle_mesh("temp.obj", V, F);
-}
\ No newline at end of file
+}
+#include <prism/local_operations/mesh_coloring.hpp>
+TEST_CASE("balanced-coloring") {
+  // 8-connected grid graph.
+  int n = 20;
+  std::vector<std::vector<int>> adj(n * n);
+  for (auto i = 0; i < n; i++)
+    for (auto j = 0; j < n; j++)
+      for (auto di : {-1, 0, 1})
+        for (auto dj : {-1, 0, 1}) {
+          auto a = i + di, b = j + dj;
+          if ((di == 0 && dj == 0) || a < 0 || b < 0 || a >= n || b >= n)
+            continue;
+          adj[i * n + j].push_back(a * n + b);
+        }
+  auto valid = [&adj](auto &colors) {
+    for (auto v = 0; v < adj.size(); v++)
+      for (auto u : adj[v])
+        if (colors[u] == colors[v]) return false;
+    return true;
+  };
+  std::vector<int> colors;
+  auto num = prism::local::graph_coloring(adj, {}, colors);
+  CHECK(valid(colors));
+  std::vector<std::vector<int>> groups;
+  prism::local::coloring_to_groups(colors, groups);
+  REQUIRE_EQ(groups.size(), num);
+  for (auto &g : groups) CHECK_LE(g.size(), (n * n + num - 1) / num);
+
+  std::vector<int> again;
+  prism::local::graph_coloring(adj, {}, again);
+  CHECK_EQ(again, colors);  // seeded priorities, deterministic
+}
+
+#include <prism/energy/prism_quality.hpp>
+TEST_CASE("closed-form-quality") {
+  std::array<Vec3d, 6> corners{Vec3d(0, 0, 0),      Vec3d(1, 0.1, 0),
+                               Vec3d(0.4, 0.8, 0.1), Vec3d(0.1, 0, 1),
+                               Vec3d(1, 0, 1.2),     Vec3d(0.5, 0.9, 1)};
+  Vec3d dimscale(1.5, 1.5, 0.8);
+  auto check = [](auto &ad, auto &value, auto &grad, auto &hess) {
+    CHECK_EQ(value, doctest::Approx(ad.getValue()));
+    for (int i = 0; i < 3; i++) {
+      CHECK_EQ(grad[i], doctest::Approx(ad.getGradient()[i]));
+      for (int j = 0; j < 3; j++)
+        CHECK_EQ(hess(i, j), doctest::Approx(ad.getHessian()(i, j)));
+    }
+  };
+  for (auto qt : {prism::energy::QualityType::MIPS_3D,
+                  prism::energy::QualityType::SYMMETRIC_DIRICHLET})
+    for (int v = 0; v < 6; v++) {
+      auto ad = prism::energy::prism_full_quality(corners, dimscale, qt, v);
+      auto [value, grad, hess] =
+          prism::energy::prism_quality_derivatives(corners, dimscale, qt, v);
+      check(ad, value, grad, hess);
+    }
+  std::array<Vec3d, 3> tri{corners[0], corners[1], corners[5]};
+  for (int v = 0; v < 3; v++) {
+    auto ad = prism::energy::triangle_quality(tri, v);
+    auto [value, grad, hess] = prism::energy::triangle_quality_derivatives(tri, v);
+    check(ad, value, grad, hess);
+  }
+}
+
+#include <prism/cgal/triangle_triangle_intersection.hpp>
+#include <prism/local_operations/ref_patch.hpp>
+#include <random>
+TEST_CASE("ref-patch-walk") {
+  // a bumpy height field, with alternating diagonals.
+  const int n = 8;
+  PrismCage::RefSurf ref;
+  ref.V.resize((n + 1) * (n + 1), 3);
+  for (auto i = 0; i <= n; i++)
+    for (auto j = 0; j <= n; j++) {
+      double x = double(i) / n, y = double(j) / n;
+      ref.V.row(i * (n + 1) + j) << x, y, 0.15 * sin(3 * x) * cos(2 * y);
+    }
+  ref.F.resize(2 * n * n, 3);
+  for (auto i = 0; i < n; i++)
+    for (auto j = 0; j < n; j++) {
+      auto a = i * (n + 1) + j, b = a + n + 1, c = b + 1, d = a + 1;
+      auto f = 2 * (i * n + j);
+      if ((i + j) % 2 == 0) {
+        ref.F.row(f) << a, b, c;
+        ref.F.row(f + 1) << a, c, d;
+      } else {
+        ref.F.row(f) << a, b, d;
+        ref.F.row(f + 1) << b, c, d;
+      }
+    }
+  igl::vertex_triangle_adjacency(ref.V, ref.F, ref.VF, ref.VFi);
+  std::set<int> faces;
+  for (auto f = 0; f < ref.F.rows(); f++) faces.insert(f);
+
+  auto linear = [&](const Vec3d &s, const Vec3d &t) -> std::optional<Vec3d> {
+    for (auto f : faces) {
+      auto hit = prism::cgal::segment_triangle_intersection(
+          {s, t}, {ref.V.row(ref.F(f, 0)), ref.V.row(ref.F(f, 1)),
+                   ref.V.row(ref.F(f, 2))});
+      if (hit) return hit;
+    }
+    return {};
+  };
+
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> pos(0.02, 0.98), tilt(-0.3, 0.3);
+  auto walked_cnt = 0, total = 200;
+  for (auto k = 0; k < total; k++) {
+    Vec3d mid(pos(gen), pos(gen), 0), dir(tilt(gen), tilt(gen), 1);
+    if (k % 10 == 0) mid << (k / 10 % n) / double(n), 0.5, 0;  // on edges
+    Vec3d s = mid - 0.5 * dir, t = mid + 0.5 * dir;
+    prism::local::RefPatch patch(ref, faces, mid);
+    REQUIRE(patch.valid);
+    auto walked = patch.segment_query(s, t);
+    auto expected = linear(s, t);
+    if (!walked) continue;  // the full query decides.
+    REQUIRE(expected);
+    CHECK_LT((walked.value() - expected.value()).norm(), 1e-10);
+    walked_cnt++;
+  }
+  CHECK_GT(walked_cnt, total * 3 / 4);
+
+  Vec3d out(1.5, 0.5, 0);  // leaves the patch
+  prism::local::RefPatch patch(ref, faces, Vec3d(0.9, 0.5, 0));
+  CHECK_FALSE(patch.segment_query(out - Vec3d(0, 0, 1), out + Vec3d(0, 0, 1)));
+}